@@ -0,0 +1,408 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "AudioCatalog.hpp"
+#include "AudioVerify.hpp"
+#include "WaveHeader.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+struct catalog_job {
+	const std::vector<std::string> *files;
+	std::atomic<size_t> *next_file;
+	std::vector<audio_catalog_entry_t> entries;
+	std::vector<std::string> paths;
+	size_t n_rejected;
+	size_t n_truncated;
+};
+
+typedef struct catalog_job catalog_job_t;
+
+static void catalog_walk(const std::string &dir, std::vector<std::string> *files);
+static void catalog_index_proc(catalog_job_t *job);
+static bool catalog_index_file(const char *filein_dir, audio_catalog_entry_t *entry, std::string *path);
+static std::int64_t stat_mtime_ns(const struct stat *filein_stat);
+
+bool audio_catalog_build(const std::vector<std::string> &roots, const char *catalog_dir, unsigned int n_threads, audio_catalog_build_result_t *result)
+{
+	std::vector<std::string> files;
+	std::vector<catalog_job_t> jobs;
+	std::vector<std::thread> workers;
+	std::vector<audio_catalog_entry_t> entries;
+	std::vector<std::string> paths;
+	std::vector<size_t> order;
+	std::atomic<size_t> next_file{0u};
+	audio_catalog_header_t header;
+	std::string tmp_dir = std::string(catalog_dir) + ".tmp";
+	std::FILE *fileout = nullptr;
+	std::uint64_t path_offset = 0u;
+	size_t n_job = 0u;
+	size_t n_entry = 0u;
+	size_t n_entries = 0u;
+	struct stat root_stat;
+
+	if(result != nullptr) memset(result, 0, sizeof(audio_catalog_build_result_t));
+
+	for(n_entry = 0u; n_entry < roots.size(); n_entry++)
+	{
+		if(stat(roots[n_entry].c_str(), &root_stat) != 0) continue;
+
+		if(S_ISDIR(root_stat.st_mode)) catalog_walk(roots[n_entry], &files);
+		else if(file_ext_check(roots[n_entry].c_str())) files.push_back(roots[n_entry]);
+	}
+
+	if(n_threads == 0u) n_threads = std::thread::hardware_concurrency();
+	if(n_threads == 0u) n_threads = 1u;
+	if(((size_t) n_threads) > files.size()) n_threads = (files.size() > 0u) ? ((unsigned int) files.size()) : 1u;
+
+	//Every thread takes the next file in line, results are merged afterwards
+	jobs.resize(n_threads);
+	for(n_job = 0u; n_job < jobs.size(); n_job++)
+	{
+		jobs[n_job].files = &files;
+		jobs[n_job].next_file = &next_file;
+		jobs[n_job].n_rejected = 0u;
+		jobs[n_job].n_truncated = 0u;
+	}
+
+	for(n_job = 0u; n_job < jobs.size(); n_job++) workers.push_back(std::thread(catalog_index_proc, &jobs[n_job]));
+	for(n_job = 0u; n_job < workers.size(); n_job++) workers[n_job].join();
+
+	for(n_job = 0u; n_job < jobs.size(); n_job++)
+	{
+		entries.insert(entries.end(), jobs[n_job].entries.begin(), jobs[n_job].entries.end());
+		paths.insert(paths.end(), jobs[n_job].paths.begin(), jobs[n_job].paths.end());
+
+		if(result != nullptr)
+		{
+			result->n_rejected += jobs[n_job].n_rejected;
+			result->n_truncated += jobs[n_job].n_truncated;
+		}
+	}
+
+	//Sorted by hash for the binary search. The same file reached twice (overlapping roots) is kept once.
+	order.resize(entries.size());
+	for(n_entry = 0u; n_entry < order.size(); n_entry++) order[n_entry] = n_entry;
+
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		if(entries[a].path_hash != entries[b].path_hash) return (entries[a].path_hash < entries[b].path_hash);
+		return (paths[a] < paths[b]);
+	});
+
+	order.erase(std::unique(order.begin(), order.end(), [&](size_t a, size_t b) { return (paths[a] == paths[b]); }), order.end());
+	n_entries = order.size();
+
+	memset(&header, 0, sizeof(audio_catalog_header_t));
+	memcpy(header.magic, AUDIO_CATALOG_MAGIC, 8u);
+	header.version = AUDIO_CATALOG_VERSION;
+	header.entry_size = (std::uint32_t) sizeof(audio_catalog_entry_t);
+	header.n_entries = (std::uint64_t) n_entries;
+	header.paths_offset = (std::uint64_t) (sizeof(audio_catalog_header_t) + n_entries*sizeof(audio_catalog_entry_t));
+
+	for(n_entry = 0u; n_entry < n_entries; n_entry++)
+	{
+		entries[order[n_entry]].path_offset = path_offset;
+		path_offset += (std::uint64_t) (paths[order[n_entry]].size() + 1u);
+	}
+
+	header.paths_size = path_offset;
+
+	fileout = std::fopen(tmp_dir.c_str(), "wb");
+	if(fileout == nullptr) return false;
+
+	std::fwrite(&header, sizeof(audio_catalog_header_t), 1u, fileout);
+	for(n_entry = 0u; n_entry < n_entries; n_entry++) std::fwrite(&entries[order[n_entry]], sizeof(audio_catalog_entry_t), 1u, fileout);
+	for(n_entry = 0u; n_entry < n_entries; n_entry++) std::fwrite(paths[order[n_entry]].c_str(), 1u, paths[order[n_entry]].size() + 1u, fileout);
+
+	if(std::fclose(fileout) != 0)
+	{
+		std::remove(tmp_dir.c_str());
+		return false;
+	}
+
+	if(std::rename(tmp_dir.c_str(), catalog_dir) != 0)
+	{
+		std::remove(tmp_dir.c_str());
+		return false;
+	}
+
+	if(result != nullptr)
+	{
+		result->n_files = files.size();
+		result->n_indexed = n_entries;
+	}
+
+	return true;
+}
+
+//Symbolic links to directories are not followed, so the walk can not loop
+static void catalog_walk(const std::string &dir, std::vector<std::string> *files)
+{
+	DIR *dirp = opendir(dir.c_str());
+	struct dirent *dent = nullptr;
+	struct stat filein_stat;
+	std::string filein_dir = "";
+	bool is_dir = false;
+
+	if(dirp == nullptr) return;
+
+	while((dent = readdir(dirp)) != nullptr)
+	{
+		if((strcmp(dent->d_name, ".") == 0) || (strcmp(dent->d_name, "..") == 0)) continue;
+
+		filein_dir = dir + "/" + dent->d_name;
+
+		//d_type saves a stat per file, where the file system fills it in
+		if(dent->d_type == DT_UNKNOWN) is_dir = ((lstat(filein_dir.c_str(), &filein_stat) == 0) && S_ISDIR(filein_stat.st_mode));
+		else is_dir = (dent->d_type == DT_DIR);
+
+		if(is_dir) catalog_walk(filein_dir, files);
+		else if(file_ext_check(filein_dir.c_str())) files->push_back(filein_dir);
+	}
+
+	closedir(dirp);
+	return;
+}
+
+static void catalog_index_proc(catalog_job_t *job)
+{
+	audio_catalog_entry_t entry;
+	std::string path = "";
+	size_t n_file = 0u;
+
+	while((n_file = job->next_file->fetch_add(1u)) < job->files->size())
+	{
+		if(!catalog_index_file((*job->files)[n_file].c_str(), &entry, &path))
+		{
+			job->n_rejected++;
+			continue;
+		}
+
+		if(entry.flags & AUDIO_CATALOG_TRUNCATED) job->n_truncated++;
+
+		job->entries.push_back(entry);
+		job->paths.push_back(path);
+	}
+
+	return;
+}
+
+static bool catalog_index_file(const char *filein_dir, audio_catalog_entry_t *entry, std::string *path)
+{
+	audio_playback_params_t params;
+	struct stat filein_stat;
+	char real_dir[PATH_MAX];
+	int format = -1;
+	int fd = -1;
+
+	if(realpath(filein_dir, real_dir) == nullptr) return false;
+
+	fd = file_open(real_dir);
+	if(fd < 0) return false;
+
+	if((fstat(fd, &filein_stat) != 0) || !S_ISREG(filein_stat.st_mode))
+	{
+		file_close(fd);
+		return false;
+	}
+
+	params.audio_dev_desc = nullptr;
+	params.filein_dir = real_dir;
+
+	format = file_get_params(fd, &params);
+	file_close(fd);
+
+	if(format < 0) return false;
+
+	//Recorders that stop abruptly leave a data size larger than the file
+	memset(entry, 0, sizeof(audio_catalog_entry_t));
+	if(params.audio_data_end > (__offset) filein_stat.st_size)
+	{
+		params.audio_data_end = (__offset) filein_stat.st_size;
+		entry->flags |= AUDIO_CATALOG_TRUNCATED;
+	}
+
+	if(params.audio_data_begin >= params.audio_data_end) return false;
+
+	*path = real_dir;
+
+	entry->path_hash = hash64(path->c_str(), path->size(), 0u);
+	entry->mtime_ns = stat_mtime_ns(&filein_stat);
+	entry->file_size = (std::int64_t) filein_stat.st_size;
+	entry->audio_data_begin = (std::int64_t) params.audio_data_begin;
+	entry->audio_data_end = (std::int64_t) params.audio_data_end;
+	entry->n_frames = audio_data_frames(&params, format);
+	entry->sample_rate = params.sample_rate;
+	entry->n_channels = params.n_channels;
+	entry->block_align = params.block_align;
+	entry->samples_per_block = params.samples_per_block;
+	entry->format = (std::int16_t) format;
+	if(params.big_endian) entry->flags |= AUDIO_CATALOG_BIG_ENDIAN;
+	entry->loop_begin_frame = params.loop_begin_frame;
+	entry->loop_end_frame = params.loop_end_frame;
+	entry->loop_count = (std::int32_t) params.loop_count;
+
+	return true;
+}
+
+static std::int64_t stat_mtime_ns(const struct stat *filein_stat)
+{
+	return ((std::int64_t) filein_stat->st_mtim.tv_sec)*1000000000 + ((std::int64_t) filein_stat->st_mtim.tv_nsec);
+}
+
+AudioCatalog::AudioCatalog(void)
+{
+}
+
+AudioCatalog::~AudioCatalog(void)
+{
+	this->close();
+}
+
+bool AudioCatalog::open(const char *catalog_dir)
+{
+	struct stat catalog_stat;
+	const audio_catalog_header_t *header = nullptr;
+	void *map = nullptr;
+	int fd = -1;
+
+	this->close();
+
+	fd = ::open(catalog_dir, O_RDONLY);
+	if(fd < 0)
+	{
+		this->error_msg = "Audio Catalog: could not open catalog file.";
+		return false;
+	}
+
+	if((fstat(fd, &catalog_stat) != 0) || (((size_t) catalog_stat.st_size) < sizeof(audio_catalog_header_t)))
+	{
+		this->error_msg = "Audio Catalog: catalog file is not valid.";
+		::close(fd);
+		return false;
+	}
+
+	map = mmap(nullptr, (size_t) catalog_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if(map == MAP_FAILED)
+	{
+		this->error_msg = "Audio Catalog: could not map catalog file.";
+		return false;
+	}
+
+	this->map = (std::uint8_t*) map;
+	this->map_size = (size_t) catalog_stat.st_size;
+	header = (const audio_catalog_header_t*) map;
+
+	//Everything the lookups rely on is checked once, here
+	if((memcmp(header->magic, AUDIO_CATALOG_MAGIC, 8u) != 0) || (header->version != AUDIO_CATALOG_VERSION) || (header->entry_size != sizeof(audio_catalog_entry_t))
+		|| (header->n_entries > ((this->map_size - sizeof(audio_catalog_header_t))/sizeof(audio_catalog_entry_t)))
+		|| (header->paths_offset != (sizeof(audio_catalog_header_t) + header->n_entries*sizeof(audio_catalog_entry_t)))
+		|| (header->paths_size > (this->map_size - header->paths_offset))
+		|| ((header->paths_size > 0u) && (this->map[header->paths_offset + header->paths_size - 1u] != '\0')))
+	{
+		this->error_msg = "Audio Catalog: catalog file is not valid.";
+		this->close();
+		return false;
+	}
+
+	this->header = header;
+	this->entries = (const audio_catalog_entry_t*) &this->map[sizeof(audio_catalog_header_t)];
+	this->paths = (const char*) &this->map[header->paths_offset];
+	return true;
+}
+
+void AudioCatalog::close(void)
+{
+	if(this->map != nullptr) munmap(this->map, this->map_size);
+
+	this->map = nullptr;
+	this->map_size = 0u;
+	this->header = nullptr;
+	this->entries = nullptr;
+	this->paths = nullptr;
+	return;
+}
+
+const audio_catalog_entry_t *AudioCatalog::find(const char *filein_dir)
+{
+	char real_dir[PATH_MAX];
+	std::uint64_t path_hash = 0u;
+	size_t len = 0u;
+	size_t n_begin = 0u;
+	size_t n_end = 0u;
+	size_t n_mid = 0u;
+
+	if((this->header == nullptr) || (filein_dir == nullptr)) return nullptr;
+	if(realpath(filein_dir, real_dir) == nullptr) return nullptr;
+
+	len = strlen(real_dir);
+	path_hash = hash64(real_dir, len, 0u);
+
+	//First entry with this hash
+	n_end = (size_t) this->header->n_entries;
+	while(n_begin < n_end)
+	{
+		n_mid = n_begin + (n_end - n_begin)/2u;
+
+		if(this->entries[n_mid].path_hash < path_hash) n_begin = n_mid + 1u;
+		else n_end = n_mid;
+	}
+
+	for(; (n_begin < this->header->n_entries) && (this->entries[n_begin].path_hash == path_hash); n_begin++)
+	{
+		if(this->entries[n_begin].path_offset >= this->header->paths_size) continue;
+		if(strcmp(&this->paths[this->entries[n_begin].path_offset], real_dir) == 0) return &this->entries[n_begin];
+	}
+
+	return nullptr;
+}
+
+int AudioCatalog::getParams(const char *filein_dir, audio_playback_params_t *params)
+{
+	const audio_catalog_entry_t *entry = this->find(filein_dir);
+	struct stat filein_stat;
+
+	if((entry == nullptr) || (params == nullptr)) return -1;
+
+	//One stat instead of an open, a read and a parse. A file that changed is parsed again.
+	if(stat(filein_dir, &filein_stat) != 0) return -1;
+	if((((std::int64_t) filein_stat.st_size) != entry->file_size) || (stat_mtime_ns(&filein_stat) != entry->mtime_ns)) return -1;
+
+	params->audio_data_begin = (__offset) entry->audio_data_begin;
+	params->audio_data_end = (__offset) entry->audio_data_end;
+	params->sample_rate = entry->sample_rate;
+	params->n_channels = entry->n_channels;
+	params->block_align = entry->block_align;
+	params->samples_per_block = entry->samples_per_block;
+	params->big_endian = ((entry->flags & AUDIO_CATALOG_BIG_ENDIAN) != 0u);
+	params->loop_begin_frame = entry->loop_begin_frame;
+	params->loop_end_frame = entry->loop_end_frame;
+	params->loop_count = (int) entry->loop_count;
+
+	return (int) entry->format;
+}
+
+size_t AudioCatalog::getEntryCount(void)
+{
+	if(this->header == nullptr) return 0u;
+
+	return (size_t) this->header->n_entries;
+}
+
+std::string AudioCatalog::getLastErrorMessage(void)
+{
+	return this->error_msg;
+}
@@ -0,0 +1,111 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef AUDIOCATALOG_HPP
+#define AUDIOCATALOG_HPP
+
+#include "globaldef.h"
+#include "AudioPlayback.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Binary catalog of audio file headers, so a large library is parsed once instead of at every launch.
+ * The file is a header, an array of fixed size entries sorted by path hash, and a table of NUL terminated paths.
+ * Paths are canonical (realpath). It is used in place through mmap: a lookup is a binary search, with no parsing.
+ * Every entry keeps the size and modification time of the file it was read from, files changed since are not served.
+ * All integers are little endian, in the layout of the structs below.
+ */
+
+#define AUDIO_CATALOG_MAGIC "WAVCATLG"
+#define AUDIO_CATALOG_VERSION 3u
+
+//The header claims more audio data than the file holds: audio_data_end was clipped to the file size
+#define AUDIO_CATALOG_TRUNCATED 0x1u
+//RIFX file, audio_playback_params_t big_endian
+#define AUDIO_CATALOG_BIG_ENDIAN 0x2u
+
+struct audio_catalog_header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t entry_size; //sizeof(audio_catalog_entry_t)
+	std::uint64_t n_entries;
+	std::uint64_t paths_offset; //Path table, from the beginning of the file
+	std::uint64_t paths_size;
+};
+
+typedef struct audio_catalog_header audio_catalog_header_t;
+
+struct audio_catalog_entry {
+	std::uint64_t path_hash; //hash64 of the canonical path
+	std::uint64_t path_offset; //Into the path table
+	std::int64_t mtime_ns;
+	std::int64_t file_size;
+	std::int64_t audio_data_begin;
+	std::int64_t audio_data_end;
+	std::uint64_t n_frames; //Duration
+	std::uint32_t sample_rate;
+	std::uint16_t n_channels;
+	std::uint16_t block_align;
+	std::uint16_t samples_per_block;
+	std::int16_t format; //PB_ format code
+	std::uint32_t flags;
+	std::uint64_t loop_begin_frame; //Loop stored in the file, as in audio_playback_params_t
+	std::uint64_t loop_end_frame;
+	std::int32_t loop_count;
+	std::uint32_t reserved; //Zero
+};
+
+typedef struct audio_catalog_entry audio_catalog_entry_t;
+
+struct audio_catalog_build_result {
+	size_t n_files; //Files with a supported extension found
+	size_t n_indexed;
+	size_t n_rejected; //Unreadable, unsupported format, or no audio data within the file
+	size_t n_truncated; //Indexed, with AUDIO_CATALOG_TRUNCATED
+};
+
+typedef struct audio_catalog_build_result audio_catalog_build_result_t;
+
+/*
+ * Walks every directory in roots (files are taken as they are), parses the headers with n_threads threads
+ * (0: one per core) and writes the catalog to catalog_dir, replacing it atomically.
+ */
+bool audio_catalog_build(const std::vector<std::string> &roots, const char *catalog_dir, unsigned int n_threads, audio_catalog_build_result_t *result);
+
+class AudioCatalog {
+	public:
+		AudioCatalog(void);
+		~AudioCatalog(void);
+
+		bool open(const char *catalog_dir);
+		void close(void);
+
+		//nullptr if the file is not in the catalog
+		const audio_catalog_entry_t *find(const char *filein_dir);
+		/*
+		 * Fills params (except audio_dev_desc and filein_dir) from the catalog, if the file has not changed since it was indexed.
+		 * Returns the PB_ format code, or -1 if the file must be parsed instead.
+		 */
+		int getParams(const char *filein_dir, audio_playback_params_t *params);
+
+		size_t getEntryCount(void);
+		std::string getLastErrorMessage(void);
+
+	private:
+		std::uint8_t *map = nullptr;
+		size_t map_size = 0u;
+
+		const audio_catalog_header_t *header = nullptr;
+		const audio_catalog_entry_t *entries = nullptr;
+		const char *paths = nullptr;
+
+		std::string error_msg = "";
+};
+
+#endif //AUDIOCATALOG_HPP
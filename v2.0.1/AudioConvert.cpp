@@ -0,0 +1,668 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "AudioConvert.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//SSSE3 kernels are built for SSSE3 whatever the CXXFLAGS, and only run when the CPU has it
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <tmmintrin.h>
+#define CONVERT_SSSE3
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static inline std::int32_t s24_from_bytes(const std::uint8_t *bytes)
+{
+	std::int32_t sample = ((bytes[2] << 16) | (bytes[1] << 8) | (bytes[0]));
+
+	if(sample & 0x00800000) sample |= 0xff800000;
+
+	return sample;
+}
+
+static inline std::int32_t s24_from_bytes_be(const std::uint8_t *bytes)
+{
+	return ((std::int32_t) (((std::uint32_t) bytes[0] << 24) | ((std::uint32_t) bytes[1] << 16) | ((std::uint32_t) bytes[2] << 8))) >> 8;
+}
+
+static inline std::int16_t s16_from_bytes_be(const std::uint8_t *bytes)
+{
+	return (std::int16_t) ((bytes[0] << 8) | bytes[1]);
+}
+
+static inline std::int16_t s16_saturate(std::int32_t sample)
+{
+	if(sample > 32767) return 32767;
+	if(sample < -32768) return -32768;
+	return (std::int16_t) sample;
+}
+
+#if defined(CONVERT_SSSE3)
+static inline bool cpu_has_ssse3(void)
+{
+#if defined(__SSSE3__)
+	return true;
+#else
+	static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+	return has_ssse3;
+#endif
+}
+#endif
+
+void convert_8bit1ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	size_t n_frame = 0u;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi8((char) 0x80);
+	__m128i in_vec;
+	__m128i lo;
+	__m128i hi;
+
+	//Flipping the top bit removes the bias, placing the byte in the high half of a 16bit lane scales it.
+	for(n_frame = 0u; (n_frame + 16u) <= n_frames; n_frame += 16u)
+	{
+		in_vec = _mm_xor_si128(_mm_loadu_si128((const __m128i*) &in[n_frame]), bias);
+		lo = _mm_unpacklo_epi8(zero, in_vec);
+		hi = _mm_unpackhi_epi8(zero, in_vec);
+
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame], _mm_unpacklo_epi16(lo, lo));
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame + 8u], _mm_unpackhi_epi16(lo, lo));
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame + 16u], _mm_unpacklo_epi16(hi, hi));
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame + 24u], _mm_unpackhi_epi16(hi, hi));
+	}
+#elif defined(__ARM_NEON)
+	int16x8x2_t samples;
+
+	for(n_frame = 0u; (n_frame + 8u) <= n_frames; n_frame += 8u)
+	{
+		samples.val[0] = vshll_n_s8(vreinterpret_s8_u8(veor_u8(vld1_u8(&in[n_frame]), vdup_n_u8(0x80))), 8);
+		samples.val[1] = samples.val[0];
+		vst2q_s16(&out[2u*n_frame], samples);
+	}
+#endif
+
+	for(; n_frame < n_frames; n_frame++)
+	{
+		out[2u*n_frame] = (std::int16_t) ((in[n_frame] ^ 0x80) << 8);
+		out[2u*n_frame + 1u] = out[2u*n_frame];
+	}
+
+	return;
+}
+
+void convert_8bit2ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	const size_t n_samples = 2u*n_frames;
+	size_t n_sample = 0u;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi8((char) 0x80);
+	__m128i in_vec;
+
+	for(n_sample = 0u; (n_sample + 16u) <= n_samples; n_sample += 16u)
+	{
+		in_vec = _mm_xor_si128(_mm_loadu_si128((const __m128i*) &in[n_sample]), bias);
+
+		_mm_storeu_si128((__m128i*) &out[n_sample], _mm_unpacklo_epi8(zero, in_vec));
+		_mm_storeu_si128((__m128i*) &out[n_sample + 8u], _mm_unpackhi_epi8(zero, in_vec));
+	}
+#elif defined(__ARM_NEON)
+	for(n_sample = 0u; (n_sample + 8u) <= n_samples; n_sample += 8u)
+	{
+		vst1q_s16(&out[n_sample], vshll_n_s8(vreinterpret_s8_u8(veor_u8(vld1_u8(&in[n_sample]), vdup_n_u8(0x80))), 8));
+	}
+#endif
+
+	for(; n_sample < n_samples; n_sample++) out[n_sample] = (std::int16_t) ((in[n_sample] ^ 0x80) << 8);
+
+	return;
+}
+
+void convert_16bit1ch_s16_2ch(std::int16_t *out, const std::int16_t *in, size_t n_frames)
+{
+	size_t n_frame = 0u;
+
+	for(n_frame = 0u; n_frame < n_frames; n_frame++)
+	{
+		out[2u*n_frame] = in[n_frame];
+		out[2u*n_frame + 1u] = in[n_frame];
+	}
+
+	return;
+}
+
+void convert_24bit1ch_s24_2ch(std::int32_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	size_t n_frame = 0u;
+
+	for(n_frame = 0u; n_frame < n_frames; n_frame++)
+	{
+		out[2u*n_frame] = s24_from_bytes(&in[3u*n_frame]);
+		out[2u*n_frame + 1u] = out[2u*n_frame];
+	}
+
+	return;
+}
+
+void convert_24bit2ch_s24_2ch(std::int32_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	size_t n_sample = 0u;
+	const size_t n_samples = 2u*n_frames;
+
+	for(n_sample = 0u; n_sample < n_samples; n_sample++) out[n_sample] = s24_from_bytes(&in[3u*n_sample]);
+
+	return;
+}
+
+void convert_24bit1ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	size_t n_frame = 0u;
+
+	for(n_frame = 0u; n_frame < n_frames; n_frame++)
+	{
+		//The top two bytes of a little-endian 24bit sample are a valid 16bit sample.
+		out[2u*n_frame] = (std::int16_t) (in[3u*n_frame + 1u] | (in[3u*n_frame + 2u] << 8));
+		out[2u*n_frame + 1u] = out[2u*n_frame];
+	}
+
+	return;
+}
+
+void convert_24bit2ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	size_t n_sample = 0u;
+	const size_t n_samples = 2u*n_frames;
+
+	for(n_sample = 0u; n_sample < n_samples; n_sample++) out[n_sample] = (std::int16_t) (in[3u*n_sample + 1u] | (in[3u*n_sample + 2u] << 8));
+
+	return;
+}
+
+#if defined(__SSE2__)
+//Swaps the bytes of 8 16bit samples
+static inline __m128i bswap16_sse2(__m128i samples)
+{
+	return _mm_or_si128(_mm_slli_epi16(samples, 8), _mm_srli_epi16(samples, 8));
+}
+#endif
+
+#if defined(CONVERT_SSSE3)
+/*
+ * Big-endian 24bit samples, 3 bytes each from the first 12 bytes of a 16 byte load.
+ * S24_MASK places each sample in the top 3 bytes of a 32bit lane (the arithmetic shift by 8 then sign extends it),
+ * S16_MASK places the top two bytes of each sample in the low 4 16bit lanes.
+ */
+static const std::int8_t BE24_S24_MASK[16] = {-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9};
+static const std::int8_t BE24_S16_MASK[16] = {1, 0, 4, 3, 7, 6, 10, 9, -1, -1, -1, -1, -1, -1, -1, -1};
+
+//The SSSE3 loops return the frames (or samples) they converted, the callers finish the rest
+
+SSSE3_TARGET static size_t convert_24bit1ch_be_s24_2ch_ssse3(std::int32_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	const __m128i mask = _mm_loadu_si128((const __m128i*) BE24_S24_MASK);
+	__m128i samples;
+	size_t n_frame = 0u;
+
+	//Each load reads 4 bytes past the 4 samples it converts
+	for(n_frame = 0u; (n_frame + 6u) <= n_frames; n_frame += 4u)
+	{
+		samples = _mm_srai_epi32(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &in[3u*n_frame]), mask), 8);
+
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame], _mm_unpacklo_epi32(samples, samples));
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame + 4u], _mm_unpackhi_epi32(samples, samples));
+	}
+
+	return n_frame;
+}
+
+SSSE3_TARGET static size_t convert_be24_s24_ssse3(std::int32_t *out, const std::uint8_t *in, size_t n_samples)
+{
+	const __m128i mask = _mm_loadu_si128((const __m128i*) BE24_S24_MASK);
+	size_t n_sample = 0u;
+
+	for(n_sample = 0u; (n_sample + 6u) <= n_samples; n_sample += 4u) _mm_storeu_si128((__m128i*) &out[n_sample], _mm_srai_epi32(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &in[3u*n_sample]), mask), 8));
+
+	return n_sample;
+}
+
+SSSE3_TARGET static size_t convert_24bit1ch_be_s16_2ch_ssse3(std::int16_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	const __m128i mask = _mm_loadu_si128((const __m128i*) BE24_S16_MASK);
+	__m128i samples;
+	size_t n_frame = 0u;
+
+	//Two loads of 4 samples make 8, the second one reads 4 bytes past the last of them
+	for(n_frame = 0u; (n_frame + 10u) <= n_frames; n_frame += 8u)
+	{
+		samples = _mm_unpacklo_epi64(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &in[3u*n_frame]), mask), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &in[3u*n_frame + 12u]), mask));
+
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame], _mm_unpacklo_epi16(samples, samples));
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame + 8u], _mm_unpackhi_epi16(samples, samples));
+	}
+
+	return n_frame;
+}
+
+SSSE3_TARGET static size_t convert_be24_s16_ssse3(std::int16_t *out, const std::uint8_t *in, size_t n_samples)
+{
+	const __m128i mask = _mm_loadu_si128((const __m128i*) BE24_S16_MASK);
+	size_t n_sample = 0u;
+
+	for(n_sample = 0u; (n_sample + 10u) <= n_samples; n_sample += 8u)
+	{
+		_mm_storeu_si128((__m128i*) &out[n_sample], _mm_unpacklo_epi64(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &in[3u*n_sample]), mask), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) &in[3u*n_sample + 12u]), mask)));
+	}
+
+	return n_sample;
+}
+#endif
+
+void convert_16bit1ch_be_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	size_t n_frame = 0u;
+
+#if defined(__SSE2__)
+	__m128i samples;
+
+	for(n_frame = 0u; (n_frame + 8u) <= n_frames; n_frame += 8u)
+	{
+		samples = bswap16_sse2(_mm_loadu_si128((const __m128i*) &in[2u*n_frame]));
+
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame], _mm_unpacklo_epi16(samples, samples));
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame + 8u], _mm_unpackhi_epi16(samples, samples));
+	}
+#elif defined(__ARM_NEON)
+	int16x8x2_t samples;
+
+	for(n_frame = 0u; (n_frame + 8u) <= n_frames; n_frame += 8u)
+	{
+		samples.val[0] = vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(&in[2u*n_frame])));
+		samples.val[1] = samples.val[0];
+		vst2q_s16(&out[2u*n_frame], samples);
+	}
+#endif
+
+	for(; n_frame < n_frames; n_frame++)
+	{
+		out[2u*n_frame] = s16_from_bytes_be(&in[2u*n_frame]);
+		out[2u*n_frame + 1u] = out[2u*n_frame];
+	}
+
+	return;
+}
+
+void convert_16bit2ch_be_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	convert_s16_be_s16(out, in, 2u*n_frames);
+	return;
+}
+
+void convert_s16_be_s16(std::int16_t *out, const std::uint8_t *in, size_t n_samples)
+{
+	size_t n_sample = 0u;
+
+#if defined(__SSE2__)
+	for(n_sample = 0u; (n_sample + 8u) <= n_samples; n_sample += 8u) _mm_storeu_si128((__m128i*) &out[n_sample], bswap16_sse2(_mm_loadu_si128((const __m128i*) &in[2u*n_sample])));
+#elif defined(__ARM_NEON)
+	for(n_sample = 0u; (n_sample + 8u) <= n_samples; n_sample += 8u) vst1q_s16(&out[n_sample], vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(&in[2u*n_sample]))));
+#endif
+
+	for(; n_sample < n_samples; n_sample++) out[n_sample] = s16_from_bytes_be(&in[2u*n_sample]);
+
+	return;
+}
+
+void convert_24bit1ch_be_s24_2ch(std::int32_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	size_t n_frame = 0u;
+
+#if defined(CONVERT_SSSE3)
+	if(cpu_has_ssse3()) n_frame = convert_24bit1ch_be_s24_2ch_ssse3(out, in, n_frames);
+#endif
+
+	for(; n_frame < n_frames; n_frame++)
+	{
+		out[2u*n_frame] = s24_from_bytes_be(&in[3u*n_frame]);
+		out[2u*n_frame + 1u] = out[2u*n_frame];
+	}
+
+	return;
+}
+
+void convert_24bit2ch_be_s24_2ch(std::int32_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	const size_t n_samples = 2u*n_frames;
+	size_t n_sample = 0u;
+
+#if defined(CONVERT_SSSE3)
+	if(cpu_has_ssse3()) n_sample = convert_be24_s24_ssse3(out, in, n_samples);
+#endif
+
+	for(; n_sample < n_samples; n_sample++) out[n_sample] = s24_from_bytes_be(&in[3u*n_sample]);
+
+	return;
+}
+
+void convert_24bit1ch_be_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	size_t n_frame = 0u;
+
+#if defined(CONVERT_SSSE3)
+	if(cpu_has_ssse3()) n_frame = convert_24bit1ch_be_s16_2ch_ssse3(out, in, n_frames);
+#endif
+
+	for(; n_frame < n_frames; n_frame++)
+	{
+		//The top two bytes of a big-endian 24bit sample come first
+		out[2u*n_frame] = s16_from_bytes_be(&in[3u*n_frame]);
+		out[2u*n_frame + 1u] = out[2u*n_frame];
+	}
+
+	return;
+}
+
+void convert_24bit2ch_be_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames)
+{
+	const size_t n_samples = 2u*n_frames;
+	size_t n_sample = 0u;
+
+#if defined(CONVERT_SSSE3)
+	if(cpu_has_ssse3()) n_sample = convert_be24_s16_ssse3(out, in, n_samples);
+#endif
+
+	for(; n_sample < n_samples; n_sample++) out[n_sample] = s16_from_bytes_be(&in[3u*n_sample]);
+
+	return;
+}
+
+static std::int16_t g711_alaw_decode(std::uint8_t code)
+{
+	std::int32_t sample = 0;
+	std::int32_t segment = 0;
+
+	code ^= 0x55;
+	sample = (code & 0x0f) << 4;
+	segment = (code & 0x70) >> 4;
+
+	if(segment == 0) sample += 8;
+	else sample = (sample + 0x108) << (segment - 1);
+
+	return (std::int16_t) ((code & 0x80) ? sample : -sample);
+}
+
+static std::int16_t g711_ulaw_decode(std::uint8_t code)
+{
+	std::int32_t sample = 0;
+
+	code = ~code;
+	sample = (((code & 0x0f) << 3) + 0x84) << ((code & 0x70) >> 4);
+
+	return (std::int16_t) ((code & 0x80) ? (0x84 - sample) : (sample - 0x84));
+}
+
+const std::int16_t *g711_table(bool alaw)
+{
+	static std::int16_t alaw_table[256];
+	static std::int16_t ulaw_table[256];
+
+	static const bool init = []() {
+		for(int n_code = 0; n_code < 256; n_code++)
+		{
+			alaw_table[n_code] = g711_alaw_decode((std::uint8_t) n_code);
+			ulaw_table[n_code] = g711_ulaw_decode((std::uint8_t) n_code);
+		}
+
+		return true;
+	}();
+
+	(void) init;
+
+	if(alaw) return alaw_table;
+	return ulaw_table;
+}
+
+#if defined(CONVERT_SSSE3)
+//Decodes 8 G.711 codes into 8 S16 samples
+SSSE3_TARGET static inline __m128i g711_decode_ssse3(const std::uint8_t *in, bool alaw)
+{
+	const __m128i zero = _mm_setzero_si128();
+	//pshufb index with the high byte of each lane set to 0x80, so that lane's high byte becomes zero
+	const __m128i lane_lo = _mm_set1_epi16((short) 0x8000);
+	__m128i code = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) in), zero);
+	__m128i segment;
+	__m128i sample;
+	__m128i sign;
+
+	if(alaw)
+	{
+		code = _mm_xor_si128(code, _mm_set1_epi16(0x55));
+		segment = _mm_and_si128(_mm_srli_epi16(code, 4), _mm_set1_epi16(0x07));
+
+		//segment 0: (mant << 4) + 8; segment n: ((mant << 4) + 0x108) << (n - 1)
+		sample = _mm_slli_epi16(_mm_and_si128(code, _mm_set1_epi16(0x0f)), 4);
+		sample = _mm_add_epi16(sample, _mm_sub_epi16(_mm_set1_epi16(0x108), _mm_and_si128(_mm_cmpeq_epi16(segment, zero), _mm_set1_epi16(0x100))));
+		sample = _mm_mullo_epi16(sample, _mm_shuffle_epi8(_mm_setr_epi8(1, 1, 2, 4, 8, 16, 32, 64, 0, 0, 0, 0, 0, 0, 0, 0), _mm_or_si128(segment, lane_lo)));
+
+		//Set sign bit means a positive sample
+		sign = _mm_cmpeq_epi16(_mm_and_si128(code, _mm_set1_epi16(0x80)), zero);
+	}
+	else
+	{
+		code = _mm_xor_si128(code, _mm_set1_epi16(0xff));
+		segment = _mm_and_si128(_mm_srli_epi16(code, 4), _mm_set1_epi16(0x07));
+
+		//(((mant << 3) + 0x84) << segment) - 0x84
+		sample = _mm_add_epi16(_mm_slli_epi16(_mm_and_si128(code, _mm_set1_epi16(0x0f)), 3), _mm_set1_epi16(0x84));
+		sample = _mm_mullo_epi16(sample, _mm_shuffle_epi8(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char) 128, 0, 0, 0, 0, 0, 0, 0, 0), _mm_or_si128(segment, lane_lo)));
+		sample = _mm_sub_epi16(sample, _mm_set1_epi16(0x84));
+
+		//Set sign bit (after inversion) means a negative sample
+		sign = _mm_cmpeq_epi16(_mm_and_si128(code, _mm_set1_epi16(0x80)), _mm_set1_epi16(0x80));
+	}
+
+	return _mm_sub_epi16(_mm_xor_si128(sample, sign), sign);
+}
+
+SSSE3_TARGET static size_t convert_g711_1ch_s16_2ch_ssse3(std::int16_t *out, const std::uint8_t *in, size_t n_frames, bool alaw)
+{
+	__m128i samples;
+	size_t n_frame = 0u;
+
+	for(n_frame = 0u; (n_frame + 8u) <= n_frames; n_frame += 8u)
+	{
+		samples = g711_decode_ssse3(&in[n_frame], alaw);
+
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame], _mm_unpacklo_epi16(samples, samples));
+		_mm_storeu_si128((__m128i*) &out[2u*n_frame + 8u], _mm_unpackhi_epi16(samples, samples));
+	}
+
+	return n_frame;
+}
+
+SSSE3_TARGET static size_t convert_g711_s16_ssse3(std::int16_t *out, const std::uint8_t *in, size_t n_samples, bool alaw)
+{
+	size_t n_sample = 0u;
+
+	for(n_sample = 0u; (n_sample + 8u) <= n_samples; n_sample += 8u) _mm_storeu_si128((__m128i*) &out[n_sample], g711_decode_ssse3(&in[n_sample], alaw));
+
+	return n_sample;
+}
+#endif
+
+void convert_g711_1ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames, bool alaw)
+{
+	const std::int16_t *table = g711_table(alaw);
+	size_t n_frame = 0u;
+
+#if defined(CONVERT_SSSE3)
+	if(cpu_has_ssse3()) n_frame = convert_g711_1ch_s16_2ch_ssse3(out, in, n_frames, alaw);
+#endif
+
+	for(; n_frame < n_frames; n_frame++)
+	{
+		out[2u*n_frame] = table[in[n_frame]];
+		out[2u*n_frame + 1u] = out[2u*n_frame];
+	}
+
+	return;
+}
+
+void convert_g711_2ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames, bool alaw)
+{
+	const std::int16_t *table = g711_table(alaw);
+	const size_t n_samples = 2u*n_frames;
+	size_t n_sample = 0u;
+
+#if defined(CONVERT_SSSE3)
+	if(cpu_has_ssse3()) n_sample = convert_g711_s16_ssse3(out, in, n_samples, alaw);
+#endif
+
+	for(; n_sample < n_samples; n_sample++) out[n_sample] = table[in[n_sample]];
+
+	return;
+}
+
+static const std::int16_t IMAADPCM_STEP_TABLE[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const std::int8_t IMAADPCM_INDEX_TABLE[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static inline std::int16_t imaadpcm_decode_nibble(std::uint8_t nibble, std::int32_t *predictor, std::int32_t *step_index)
+{
+	std::int32_t step = IMAADPCM_STEP_TABLE[*step_index];
+	std::int32_t diff = step >> 3;
+
+	if(nibble & 4u) diff += step;
+	if(nibble & 2u) diff += step >> 1;
+	if(nibble & 1u) diff += step >> 2;
+
+	if(nibble & 8u) *predictor -= diff;
+	else *predictor += diff;
+
+	if(*predictor > 32767) *predictor = 32767;
+	else if(*predictor < -32768) *predictor = -32768;
+
+	*step_index += IMAADPCM_INDEX_TABLE[nibble];
+	if(*step_index < 0) *step_index = 0;
+	else if(*step_index > 88) *step_index = 88;
+
+	return (std::int16_t) *predictor;
+}
+
+size_t decode_imaadpcm_block(std::int16_t *out, const std::uint8_t *in, size_t n_bytes, unsigned int n_channels)
+{
+	std::int32_t predictor = 0;
+	std::int32_t step_index = 0;
+	size_t n_groups = 0u;
+	size_t n_group = 0u;
+	size_t n_byte = 0u;
+	size_t n_frame = 0u;
+	unsigned int n_channel = 0u;
+	const std::uint8_t *data = nullptr;
+
+	if(n_bytes < 4u*n_channels) return 0u;
+
+	//Data is laid out in groups of 4 bytes (8 samples) per channel, channels interleaved group by group
+	n_groups = (n_bytes - 4u*n_channels)/(4u*n_channels);
+
+	for(n_channel = 0u; n_channel < n_channels; n_channel++)
+	{
+		predictor = (std::int16_t) (in[4u*n_channel] | (in[4u*n_channel + 1u] << 8));
+		step_index = in[4u*n_channel + 2u];
+		if(step_index > 88) step_index = 88;
+
+		out[n_channel] = (std::int16_t) predictor;
+
+		n_frame = 1u;
+		for(n_group = 0u; n_group < n_groups; n_group++)
+		{
+			data = &in[4u*n_channels + 4u*(n_group*n_channels + n_channel)];
+
+			for(n_byte = 0u; n_byte < 4u; n_byte++)
+			{
+				out[n_channels*n_frame + n_channel] = imaadpcm_decode_nibble(data[n_byte] & 0x0f, &predictor, &step_index);
+				n_frame++;
+				out[n_channels*n_frame + n_channel] = imaadpcm_decode_nibble(data[n_byte] >> 4, &predictor, &step_index);
+				n_frame++;
+			}
+		}
+	}
+
+	return 8u*n_groups + 1u;
+}
+
+void mix_s16_sat(std::int16_t *acc, const std::int16_t *in, size_t n_samples, std::int16_t gain)
+{
+	size_t n_sample = 0u;
+
+#if defined(__SSE2__)
+	const __m128i gain_vec = _mm_set1_epi16(gain);
+#if !defined(__SSSE3__)
+	const __m128i round_vec = _mm_set1_epi32(0x4000);
+#endif
+	__m128i in_vec;
+	__m128i acc_vec;
+
+	for(n_sample = 0u; (n_sample + 8u) <= n_samples; n_sample += 8u)
+	{
+		in_vec = _mm_loadu_si128((const __m128i*) &in[n_sample]);
+		acc_vec = _mm_loadu_si128((const __m128i*) &acc[n_sample]);
+
+		if(gain != MIX_GAIN_UNITY)
+		{
+#if defined(__SSSE3__)
+			in_vec = _mm_mulhrs_epi16(in_vec, gain_vec);
+#else
+			__m128i lo = _mm_mullo_epi16(in_vec, gain_vec);
+			__m128i hi = _mm_mulhi_epi16(in_vec, gain_vec);
+			__m128i prod_lo = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round_vec), 15);
+			__m128i prod_hi = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round_vec), 15);
+			in_vec = _mm_packs_epi32(prod_lo, prod_hi);
+#endif
+		}
+
+		_mm_storeu_si128((__m128i*) &acc[n_sample], _mm_adds_epi16(acc_vec, in_vec));
+	}
+#elif defined(__ARM_NEON)
+	const int16x8_t gain_vec = vdupq_n_s16(gain);
+	int16x8_t in_vec;
+
+	for(n_sample = 0u; (n_sample + 8u) <= n_samples; n_sample += 8u)
+	{
+		in_vec = vld1q_s16(&in[n_sample]);
+		if(gain != MIX_GAIN_UNITY) in_vec = vqrdmulhq_s16(in_vec, gain_vec);
+
+		vst1q_s16(&acc[n_sample], vqaddq_s16(vld1q_s16(&acc[n_sample]), in_vec));
+	}
+#endif
+
+	for(; n_sample < n_samples; n_sample++)
+	{
+		if(gain != MIX_GAIN_UNITY) acc[n_sample] = s16_saturate(acc[n_sample] + ((in[n_sample]*gain + 0x4000) >> 15));
+		else acc[n_sample] = s16_saturate(acc[n_sample] + in[n_sample]);
+	}
+
+	return;
+}
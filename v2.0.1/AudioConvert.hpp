@@ -0,0 +1,77 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef AUDIOCONVERT_HPP
+#define AUDIOCONVERT_HPP
+
+#include "globaldef.h"
+#include <cstdint>
+
+/*
+ * Sample conversion kernels shared by the playback classes and the mixer.
+ * Every kernel converts n_frames frames from the file layout (input) to the device layout (output).
+ * Device layouts are always stereo interleaved: S16_LE in 16bit containers or S24_LE in 32bit containers.
+ */
+
+//8bit WAVE samples are unsigned, biased by 128
+void convert_8bit1ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames);
+void convert_8bit2ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames);
+
+void convert_16bit1ch_s16_2ch(std::int16_t *out, const std::int16_t *in, size_t n_frames);
+
+void convert_24bit1ch_s24_2ch(std::int32_t *out, const std::uint8_t *in, size_t n_frames);
+void convert_24bit2ch_s24_2ch(std::int32_t *out, const std::uint8_t *in, size_t n_frames);
+
+void convert_24bit1ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames);
+void convert_24bit2ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames);
+
+/*
+ * Big-endian (RIFX) 16bit and 24bit samples. The byte swap is part of the conversion: SSE2 shifts (16bit) or SSSE3
+ * pshufb (24bit) on x86, vrev16 (16bit) on ARM. The SSSE3 kernels are built without -mssse3 and picked at run time
+ * (__builtin_cpu_supports), with a scalar fallback on CPUs without SSSE3.
+ * convert_16bit2ch_be_s16_2ch and convert_s16_be_s16 may convert in place (out == in).
+ */
+
+void convert_16bit1ch_be_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames);
+void convert_16bit2ch_be_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames);
+//Any number of channels, n_samples samples
+void convert_s16_be_s16(std::int16_t *out, const std::uint8_t *in, size_t n_samples);
+
+void convert_24bit1ch_be_s24_2ch(std::int32_t *out, const std::uint8_t *in, size_t n_frames);
+void convert_24bit2ch_be_s24_2ch(std::int32_t *out, const std::uint8_t *in, size_t n_frames);
+
+void convert_24bit1ch_be_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames);
+void convert_24bit2ch_be_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames);
+
+/*
+ * G.711 decoding. Table lookup, or table-free SSSE3 decoding (pshufb for the segment shift) on CPUs with SSSE3,
+ * checked at run time like the big-endian kernels.
+ * alaw selects A-law (format tag 6), otherwise mu-law (format tag 7).
+ */
+
+const std::int16_t *g711_table(bool alaw);
+
+void convert_g711_1ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames, bool alaw);
+void convert_g711_2ch_s16_2ch(std::int16_t *out, const std::uint8_t *in, size_t n_frames, bool alaw);
+
+/*
+ * IMA ADPCM decoding of one WAVE block (format tag 0x11) into interleaved S16 with n_channels channels.
+ * n_bytes may be shorter than a full block at the end of the data. Returns the number of frames decoded.
+ */
+
+size_t decode_imaadpcm_block(std::int16_t *out, const std::uint8_t *in, size_t n_bytes, unsigned int n_channels);
+
+/*
+ * Mixing kernel: acc[n] = saturate(acc[n] + in[n]*gain).
+ * gain is Q15 fixed point (0x7fff ~ 1.0). MIX_GAIN_UNITY skips the multiplication.
+ */
+
+#define MIX_GAIN_UNITY 0x7fff
+
+void mix_s16_sat(std::int16_t *acc, const std::int16_t *in, size_t n_samples, std::int16_t gain);
+
+#endif //AUDIOCONVERT_HPP
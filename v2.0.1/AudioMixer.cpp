@@ -0,0 +1,664 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "AudioMixer.hpp"
+#include "WaveHeader.hpp"
+#include <chrono>
+
+AudioMixer::AudioMixer(const char *audio_dev_desc) : AudioPlayback(nullptr)
+{
+	if(audio_dev_desc != nullptr) this->audio_dev_desc = audio_dev_desc;
+}
+
+AudioMixer::~AudioMixer(void)
+{
+	size_t n_stream = 0u;
+
+	this->filein_close();
+	this->audio_hw_deinit();
+	this->buffer_free();
+
+	for(n_stream = 0u; n_stream < this->stream_requests.size(); n_stream++) this->stream_close(&this->stream_requests[n_stream]);
+	for(n_stream = 0u; n_stream < this->stream_queue.size(); n_stream++) this->stream_close(&this->stream_queue[n_stream]);
+}
+
+bool AudioMixer::addStream(audio_playback_params_t *params, int format, float gain)
+{
+	audio_mixer_stream_t stream;
+
+	if(params == nullptr) return false;
+	if(params->filein_dir == nullptr) return false;
+	if(this->audio_dev_desc.empty()) return false;
+
+	if(this->streams.empty() && !this->continuous) this->sample_rate = params->sample_rate;
+	else if(params->sample_rate != this->sample_rate)
+	{
+		this->error_msg = "Audio Mixer: all streams must have the same sample rate.";
+		return false;
+	}
+
+	if(!this->stream_init(&stream, params, format, gain)) return false;
+
+	this->streams.push_back(stream);
+	this->status = STATUS_INITIALIZED;
+	return true;
+}
+
+size_t AudioMixer::getStreamCount(void)
+{
+	return this->streams.size();
+}
+
+void AudioMixer::setContinuous(bool continuous)
+{
+	this->continuous = continuous;
+	return;
+}
+
+bool AudioMixer::setSampleRate(std::uint32_t sample_rate)
+{
+	if(sample_rate == 0u) return false;
+	if(this->audio_dev_desc.empty()) return false;
+
+	this->sample_rate = sample_rate;
+	this->status = STATUS_INITIALIZED;
+	return true;
+}
+
+bool AudioMixer::playStream(audio_playback_params_t *params, int format, float gain)
+{
+	audio_mixer_stream_t stream;
+
+	if(params == nullptr) return false;
+	if(!this->stream_init(&stream, params, format, gain)) return false;
+
+	if(params->sample_rate != this->sample_rate)
+	{
+		this->error_msg = "Audio Mixer: stream sample rate does not match the device.";
+		return false;
+	}
+
+	//Opened here, so the playback thread does not wait on the filesystem
+	if(!this->stream_open(&stream))
+	{
+		this->error_msg = "Audio Mixer: could not open stream file.";
+		return false;
+	}
+
+	return this->stream_request(&stream, false);
+}
+
+bool AudioMixer::queueStream(audio_playback_params_t *params, int format, float gain)
+{
+	audio_mixer_stream_t stream;
+
+	if(params == nullptr) return false;
+	if(!this->stream_init(&stream, params, format, gain)) return false;
+
+	if(params->sample_rate != this->sample_rate)
+	{
+		this->error_msg = "Audio Mixer: stream sample rate does not match the device.";
+		return false;
+	}
+
+	if(!this->stream_open(&stream))
+	{
+		this->error_msg = "Audio Mixer: could not open stream file.";
+		return false;
+	}
+
+	return this->stream_request(&stream, true);
+}
+
+bool AudioMixer::playClip(std::shared_ptr<const audio_clip_t> clip, float gain)
+{
+	audio_mixer_stream_t stream;
+
+	if(!this->stream_init_clip(&stream, clip, gain)) return false;
+
+	return this->stream_request(&stream, false);
+}
+
+bool AudioMixer::queueClip(std::shared_ptr<const audio_clip_t> clip, float gain)
+{
+	audio_mixer_stream_t stream;
+
+	if(!this->stream_init_clip(&stream, clip, gain)) return false;
+
+	return this->stream_request(&stream, true);
+}
+
+void AudioMixer::stopStreams(void)
+{
+	size_t n_stream = 0u;
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
+
+	for(n_stream = 0u; n_stream < this->stream_requests.size(); n_stream++) this->stream_close(&this->stream_requests[n_stream]);
+	for(n_stream = 0u; n_stream < this->stream_queue.size(); n_stream++) this->stream_close(&this->stream_queue[n_stream]);
+
+	this->stream_requests.clear();
+	this->stream_queue.clear();
+	this->stream_flush = true;
+	this->stream_seek = -1;
+	this->n_queued = 0u;
+
+	this->stream_pending = true;
+	this->stream_cond.notify_all();
+	return;
+}
+
+void AudioMixer::seekStream(std::uint64_t n_frame)
+{
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
+
+	this->stream_seek = (std::int64_t) n_frame;
+	this->stream_pending = true;
+	this->stream_cond.notify_all();
+	return;
+}
+
+void AudioMixer::shutdown(void)
+{
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
+
+	this->shutdown_request = true;
+	this->stream_pending = true;
+	this->stream_cond.notify_all();
+	return;
+}
+
+size_t AudioMixer::getActiveStreamCount(void)
+{
+	return this->n_active;
+}
+
+size_t AudioMixer::getQueuedStreamCount(void)
+{
+	return this->n_queued;
+}
+
+bool AudioMixer::stream_init(audio_mixer_stream_t *stream, audio_playback_params_t *params, int format, float gain)
+{
+	if(params->filein_dir == nullptr) return false;
+
+	switch(format)
+	{
+		case PB_16BIT1CH:
+			stream->frame_size = 2u;
+			break;
+
+		case PB_16BIT2CH:
+			stream->frame_size = 4u;
+			break;
+
+		case PB_24BIT1CH:
+			stream->frame_size = 3u;
+			break;
+
+		case PB_24BIT2CH:
+			stream->frame_size = 6u;
+			break;
+
+		default:
+			this->error_msg = "Audio Mixer: stream format not supported.";
+			return false;
+	}
+
+	if(gain < 0.0f) gain = 0.0f;
+	if(gain > 1.0f) gain = 1.0f;
+
+	stream->filein_dir = params->filein_dir;
+	stream->filein = -1;
+	stream->format = format;
+	stream->big_endian = params->big_endian;
+	stream->filein_pos = params->audio_data_begin;
+	stream->audio_data_begin = params->audio_data_begin;
+	stream->audio_data_end = params->audio_data_end;
+	stream->gain = (std::int16_t) (gain*32767.0f + 0.5f);
+	stream->bufferin = nullptr;
+	this->readahead_reset(&stream->readahead, stream->filein_pos);
+	stream->clip = nullptr;
+
+	return true;
+}
+
+bool AudioMixer::stream_init_clip(audio_mixer_stream_t *stream, std::shared_ptr<const audio_clip_t> clip, float gain)
+{
+	if(clip == nullptr) return false;
+
+	if(clip->sample_rate != this->sample_rate)
+	{
+		this->error_msg = "Audio Mixer: stream sample rate does not match the device.";
+		return false;
+	}
+
+	if(gain < 0.0f) gain = 0.0f;
+	if(gain > 1.0f) gain = 1.0f;
+
+	//Clips are S16_LE stereo, positions are byte offsets into the clip
+	stream->filein_dir = clip->filein_dir;
+	stream->filein = -1;
+	stream->format = PB_16BIT2CH;
+	stream->big_endian = false;
+	stream->frame_size = 4u;
+	stream->filein_pos = 0;
+	stream->audio_data_begin = 0;
+	stream->audio_data_end = (__offset) (clip->n_frames*stream->frame_size);
+	stream->gain = (std::int16_t) (gain*32767.0f + 0.5f);
+	stream->bufferin = nullptr;
+	this->readahead_reset(&stream->readahead, stream->filein_pos);
+	stream->clip = clip;
+
+	return true;
+}
+
+//Hands an initialized stream over to the playback thread. queue selects queueing over replacing.
+bool AudioMixer::stream_request(audio_mixer_stream_t *stream, bool queue)
+{
+	size_t n_stream = 0u;
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
+
+	if(queue)
+	{
+		this->stream_queue.push_back(*stream);
+		this->n_queued = this->stream_queue.size();
+
+		this->stream_pending = true;
+		this->stream_cond.notify_all();
+		return true;
+	}
+
+	for(n_stream = 0u; n_stream < this->stream_requests.size(); n_stream++) this->stream_close(&this->stream_requests[n_stream]);
+	for(n_stream = 0u; n_stream < this->stream_queue.size(); n_stream++) this->stream_close(&this->stream_queue[n_stream]);
+
+	this->stream_requests.clear();
+	this->stream_queue.clear();
+	this->stream_requests.push_back(*stream);
+	this->stream_flush = true;
+	this->stream_seek = -1;
+	this->n_queued = 0u;
+
+	this->stream_pending = true;
+	this->stream_cond.notify_all();
+	return true;
+}
+
+bool AudioMixer::stream_open(audio_mixer_stream_t *stream)
+{
+	if(stream->clip != nullptr) return true;
+
+	stream->filein = open(stream->filein_dir.c_str(), O_RDONLY);
+	if(stream->filein < 0) return false;
+
+	stream->filein_pos = stream->audio_data_begin;
+	this->readahead_reset(&stream->readahead, stream->filein_pos);
+	return true;
+}
+
+void AudioMixer::stream_close(audio_mixer_stream_t *stream)
+{
+	if(stream->filein >= 0)
+	{
+		this->readahead_drop(stream->filein);
+		close(stream->filein);
+		stream->filein = -1;
+	}
+
+	if(stream->bufferin != nullptr)
+	{
+		this->buffer_release(stream->bufferin);
+		stream->bufferin = nullptr;
+	}
+
+	stream->clip = nullptr;
+	return;
+}
+
+void AudioMixer::stream_buffer_malloc(audio_mixer_stream_t *stream)
+{
+	//16bit stereo streams are read straight into mixbuf
+	if(stream->format == PB_16BIT2CH) return;
+
+	if(stream->bufferin == nullptr) stream->bufferin = this->buffer_acquire(this->BUFFER_SIZE_FRAMES*stream->frame_size);
+	return;
+}
+
+bool AudioMixer::filein_open(void)
+{
+	size_t n_stream = 0u;
+
+	for(n_stream = 0u; n_stream < this->streams.size(); n_stream++)
+	{
+		if(!this->stream_open(&this->streams[n_stream]))
+		{
+			this->filein_close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void AudioMixer::filein_close(void)
+{
+	size_t n_stream = 0u;
+
+	for(n_stream = 0u; n_stream < this->streams.size(); n_stream++)
+	{
+		if(this->streams[n_stream].filein < 0) continue;
+
+		this->readahead_drop(this->streams[n_stream].filein);
+		close(this->streams[n_stream].filein);
+		this->streams[n_stream].filein = -1;
+	}
+
+	return;
+}
+
+bool AudioMixer::audio_hw_init(void)
+{
+	if(!this->audio_hw_open(SND_PCM_FORMAT_S16_LE)) return false;
+
+	this->BUFFER_SIZE_SAMPLES = 2u*this->BUFFER_SIZE_FRAMES;
+	this->BUFFER_SIZE_BYTES = 2u*this->BUFFER_SIZE_SAMPLES;
+
+	return true;
+}
+
+void AudioMixer::buffer_malloc(void)
+{
+	size_t n_stream = 0u;
+
+	if(this->mixbuf == nullptr) this->mixbuf = (std::int16_t*) this->buffer_acquire(this->BUFFER_SIZE_BYTES);
+	if(this->bufferout_0 == nullptr) this->bufferout_0 = this->buffer_acquire(this->BUFFER_SIZE_BYTES);
+	if(this->bufferout_1 == nullptr) this->bufferout_1 = this->buffer_acquire(this->BUFFER_SIZE_BYTES);
+
+	for(n_stream = 0u; n_stream < this->streams.size(); n_stream++) this->stream_buffer_malloc(&this->streams[n_stream]);
+
+	return;
+}
+
+void AudioMixer::buffer_free(void)
+{
+	size_t n_stream = 0u;
+
+	for(n_stream = 0u; n_stream < this->streams.size(); n_stream++)
+	{
+		if(this->streams[n_stream].bufferin == nullptr) continue;
+
+		this->buffer_release(this->streams[n_stream].bufferin);
+		this->streams[n_stream].bufferin = nullptr;
+	}
+
+	if(this->mixbuf != nullptr)
+	{
+		this->buffer_release(this->mixbuf);
+		this->mixbuf = nullptr;
+	}
+
+	if(this->bufferout_0 != nullptr)
+	{
+		this->buffer_release(this->bufferout_0);
+		this->bufferout_0 = nullptr;
+	}
+
+	if(this->bufferout_1 != nullptr)
+	{
+		this->buffer_release(this->bufferout_1);
+		this->bufferout_1 = nullptr;
+	}
+
+	this->loadout_buf = nullptr;
+	this->playout_buf = nullptr;
+	return;
+}
+
+void AudioMixer::buffer_load(void)
+{
+	size_t n_stream = 0u;
+	bool active = false;
+
+	if(this->stream_pending && !this->stream_apply())
+	{
+		this->stop = true;
+		return;
+	}
+
+	if(this->continuous) this->stream_purge();
+
+	for(n_stream = 0u; n_stream < this->streams.size(); n_stream++)
+	{
+		if(this->streams[n_stream].filein_pos < this->streams[n_stream].audio_data_end)
+		{
+			active = true;
+			break;
+		}
+	}
+
+	if(!active && this->continuous) active = this->stream_wait();
+
+	if(!active)
+	{
+		this->stop = true;
+		return;
+	}
+
+	memset(this->loadout_buf, 0, this->BUFFER_SIZE_BYTES);
+
+	for(n_stream = 0u; n_stream < this->streams.size(); n_stream++)
+	{
+		const std::int16_t *mixin = this->stream_load(&this->streams[n_stream]);
+		if(mixin == nullptr) continue;
+
+		mix_s16_sat((std::int16_t*) this->loadout_buf, mixin, this->BUFFER_SIZE_SAMPLES, this->streams[n_stream].gain);
+	}
+
+	return;
+}
+
+//Returns the S16_LE stereo period to mix, or nullptr if the stream has ended
+const std::int16_t *AudioMixer::stream_load(audio_mixer_stream_t *stream)
+{
+	size_t period_bytes = this->BUFFER_SIZE_FRAMES*stream->frame_size;
+	size_t n_bytes = period_bytes;
+	ssize_t n_read = 0;
+	void *readout = stream->bufferin;
+
+	if(stream->filein_pos >= stream->audio_data_end) return nullptr;
+
+	if((stream->audio_data_end - stream->filein_pos) < ((__offset) n_bytes)) n_bytes = (size_t) (stream->audio_data_end - stream->filein_pos);
+
+	//Cached clips are already in device format: full periods are mixed in place
+	if(stream->clip != nullptr)
+	{
+		const std::uint8_t *clip_pos = ((const std::uint8_t*) stream->clip->samples.data()) + stream->filein_pos;
+
+		stream->filein_pos += (__offset) n_bytes;
+		if(n_bytes == period_bytes) return (const std::int16_t*) clip_pos;
+
+		memcpy(this->mixbuf, clip_pos, n_bytes);
+		memset(((std::uint8_t*) this->mixbuf) + n_bytes, 0, period_bytes - n_bytes);
+		return this->mixbuf;
+	}
+
+	if(stream->format == PB_16BIT2CH) readout = this->mixbuf;
+
+	n_read = this->stats_pread(stream->filein, readout, n_bytes, stream->filein_pos);
+	if(n_read < 0) n_read = 0;
+
+	if(((size_t) n_read) < period_bytes) memset(((std::uint8_t*) readout) + n_read, 0, period_bytes - ((size_t) n_read));
+
+	//Short read means the file is shorter than its header claims. The stream ends here.
+	if(((size_t) n_read) < n_bytes) stream->filein_pos = stream->audio_data_end;
+	else stream->filein_pos += (__offset) n_bytes;
+
+	if(this->readahead_window > 0u) this->readahead_advise(stream->filein, &stream->readahead, stream->filein_pos, stream->audio_data_end, stream->filein_pos);
+
+	if(stream->big_endian)
+	{
+		switch(stream->format)
+		{
+			case PB_16BIT1CH:
+				convert_16bit1ch_be_s16_2ch(this->mixbuf, (const std::uint8_t*) readout, this->BUFFER_SIZE_FRAMES);
+				break;
+
+			case PB_16BIT2CH:
+				convert_16bit2ch_be_s16_2ch(this->mixbuf, (const std::uint8_t*) readout, this->BUFFER_SIZE_FRAMES);
+				break;
+
+			case PB_24BIT1CH:
+				convert_24bit1ch_be_s16_2ch(this->mixbuf, (const std::uint8_t*) readout, this->BUFFER_SIZE_FRAMES);
+				break;
+
+			case PB_24BIT2CH:
+				convert_24bit2ch_be_s16_2ch(this->mixbuf, (const std::uint8_t*) readout, this->BUFFER_SIZE_FRAMES);
+				break;
+		}
+
+		return this->mixbuf;
+	}
+
+	switch(stream->format)
+	{
+		case PB_16BIT1CH:
+			convert_16bit1ch_s16_2ch(this->mixbuf, (const std::int16_t*) readout, this->BUFFER_SIZE_FRAMES);
+			break;
+
+		case PB_24BIT1CH:
+			convert_24bit1ch_s16_2ch(this->mixbuf, (const std::uint8_t*) readout, this->BUFFER_SIZE_FRAMES);
+			break;
+
+		case PB_24BIT2CH:
+			convert_24bit2ch_s16_2ch(this->mixbuf, (const std::uint8_t*) readout, this->BUFFER_SIZE_FRAMES);
+			break;
+	}
+
+	return this->mixbuf;
+}
+
+//Playback thread only. Returns false if playback must end.
+bool AudioMixer::stream_apply(void)
+{
+	size_t n_stream = 0u;
+	__offset pos = 0;
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
+
+	this->stream_pending = false;
+
+	if(this->shutdown_request) return false;
+
+	if(this->stream_flush)
+	{
+		for(n_stream = 0u; n_stream < this->streams.size(); n_stream++) this->stream_close(&this->streams[n_stream]);
+		this->streams.clear();
+
+		//Drop whatever is still queued in the device, so the new stream is heard right away
+		snd_pcm_drop(this->audio_dev);
+		snd_pcm_prepare(this->audio_dev);
+		this->stream_flush = false;
+	}
+
+	for(n_stream = 0u; n_stream < this->stream_requests.size(); n_stream++)
+	{
+		this->stream_buffer_malloc(&this->stream_requests[n_stream]);
+		this->streams.push_back(this->stream_requests[n_stream]);
+	}
+
+	this->stream_requests.clear();
+
+	//Queued streams start once nothing else is playing
+	if(this->streams.empty() && !this->stream_queue.empty())
+	{
+		this->stream_buffer_malloc(&this->stream_queue.front());
+		this->streams.push_back(this->stream_queue.front());
+		this->stream_queue.pop_front();
+	}
+
+	if((this->stream_seek >= 0) && !this->streams.empty())
+	{
+		audio_mixer_stream_t *stream = &this->streams[0];
+
+		pos = stream->audio_data_begin + ((__offset) this->stream_seek)*((__offset) stream->frame_size);
+		if(pos > stream->audio_data_end) pos = stream->audio_data_end;
+
+		stream->filein_pos = pos;
+	}
+
+	this->stream_seek = -1;
+	this->n_active = this->streams.size();
+	this->n_queued = this->stream_queue.size();
+	return true;
+}
+
+//Playback thread only. Closes streams that have finished, then starts the next queued stream if nothing is left.
+void AudioMixer::stream_purge(void)
+{
+	size_t n_stream = 0u;
+
+	while(n_stream < this->streams.size())
+	{
+		if(this->streams[n_stream].filein_pos < this->streams[n_stream].audio_data_end)
+		{
+			n_stream++;
+			continue;
+		}
+
+		this->stream_close(&this->streams[n_stream]);
+		this->streams.erase(this->streams.begin() + n_stream);
+	}
+
+	if(this->streams.empty() && (this->n_queued > 0u))
+	{
+		std::lock_guard<std::mutex> lock(this->stream_mutex);
+
+		if(!this->stream_queue.empty())
+		{
+			this->stream_buffer_malloc(&this->stream_queue.front());
+			this->streams.push_back(this->stream_queue.front());
+			this->stream_queue.pop_front();
+		}
+
+		this->n_queued = this->stream_queue.size();
+	}
+
+	this->n_active = this->streams.size();
+	return;
+}
+
+//Playback thread only. Nothing left to play: let the device play out what is queued, then stop it
+//(keeping its configuration) until a new request arrives. Returns false if playback must end.
+bool AudioMixer::stream_wait(void)
+{
+	snd_pcm_sframes_t delay = 0;
+	bool idle = false;
+
+	if(snd_pcm_delay(this->audio_dev, &delay) < 0) delay = 0;
+	if(delay < 0) delay = 0;
+
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(this->stream_mutex);
+
+			if(!idle && !this->stream_pending) this->stream_cond.wait_for(lock, std::chrono::nanoseconds((((std::int64_t) delay)*1000000000)/((std::int64_t) this->sample_rate)), [this]{ return this->stream_pending.load(); });
+
+			if(!this->stream_pending)
+			{
+				if(!idle) snd_pcm_drop(this->audio_dev);
+				idle = true;
+
+				this->stream_cond.wait(lock, [this]{ return this->stream_pending.load(); });
+			}
+		}
+
+		if(!this->stream_apply()) return false;
+		if(this->streams.empty()) continue;
+
+		if(idle) snd_pcm_prepare(this->audio_dev);
+		return true;
+	}
+}
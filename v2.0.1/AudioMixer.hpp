@@ -0,0 +1,118 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef AUDIOMIXER_HPP
+#define AUDIOMIXER_HPP
+
+#include "AudioPlayback.hpp"
+#include "AudioConvert.hpp"
+#include "ClipCache.hpp"
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/*
+ * Software mixer: plays any number of input streams through one PCM device.
+ * Every stream has its own file descriptor, input buffer and converter. Each period, every stream is
+ * converted to S16_LE stereo and added into the output buffer with saturation and per-stream gain.
+ * All streams must share the same sample rate. 24bit streams are reduced to 16bit.
+ *
+ * In continuous mode, playback keeps going after every stream has finished: the device stays open and
+ * configured, and is stopped while there is nothing to play. Streams can be started, queued, stopped and
+ * seeked from any thread while playing. A new stream is picked up at the next period.
+ * Streams can also be decoded clips from a ClipCache, mixed straight from memory with no read or conversion.
+ */
+
+struct audio_mixer_stream {
+	std::string filein_dir;
+	int filein;
+	int format;
+	bool big_endian; //RIFX file
+	__offset filein_pos;
+	__offset audio_data_begin;
+	__offset audio_data_end;
+	size_t frame_size;
+	std::int16_t gain;
+	void *bufferin;
+	audio_readahead_t readahead;
+	std::shared_ptr<const audio_clip_t> clip; //Played from memory instead of filein if set
+};
+
+typedef struct audio_mixer_stream audio_mixer_stream_t;
+
+class AudioMixer : public AudioPlayback {
+	public:
+		AudioMixer(const char *audio_dev_desc);
+		~AudioMixer(void);
+
+		//format is one of the PB_ format codes returned by file_get_params. gain ranges from 0.0 to 1.0
+		bool addStream(audio_playback_params_t *params, int format, float gain);
+		size_t getStreamCount(void);
+
+		//Call before runPlayback. Continuous mode needs a fixed sample rate, streams with another rate are rejected.
+		void setContinuous(bool continuous);
+		bool setSampleRate(std::uint32_t sample_rate);
+
+		//Thread safe. playStream cuts everything playing or queued, queueStream starts after the streams ahead of it.
+		bool playStream(audio_playback_params_t *params, int format, float gain);
+		bool queueStream(audio_playback_params_t *params, int format, float gain);
+		bool playClip(std::shared_ptr<const audio_clip_t> clip, float gain);
+		bool queueClip(std::shared_ptr<const audio_clip_t> clip, float gain);
+		void stopStreams(void);
+		//Seeks the oldest stream that is playing. Frames are counted from the beginning of its audio data.
+		void seekStream(std::uint64_t n_frame);
+		//Ends continuous playback. runPlayback returns once the device has been closed.
+		void shutdown(void);
+
+		size_t getActiveStreamCount(void);
+		size_t getQueuedStreamCount(void);
+
+	private:
+		std::vector<audio_mixer_stream_t> streams;
+
+		bool continuous = false;
+
+		//Stream requests from other threads, applied by the playback thread.
+		std::mutex stream_mutex;
+		std::condition_variable stream_cond;
+		std::atomic<bool> stream_pending{false};
+		std::vector<audio_mixer_stream_t> stream_requests;
+		std::deque<audio_mixer_stream_t> stream_queue;
+		bool stream_flush = false;
+		std::int64_t stream_seek = -1;
+		bool shutdown_request = false;
+
+		std::atomic<size_t> n_active{0u};
+		std::atomic<size_t> n_queued{0u};
+
+		std::int16_t *mixbuf = nullptr;
+
+		bool filein_open(void) override;
+		void filein_close(void) override;
+
+		bool audio_hw_init(void) override;
+		void buffer_malloc(void) override;
+		void buffer_free(void) override;
+
+		void buffer_load(void) override;
+		const std::int16_t *stream_load(audio_mixer_stream_t *stream);
+
+		bool stream_init(audio_mixer_stream_t *stream, audio_playback_params_t *params, int format, float gain);
+		bool stream_init_clip(audio_mixer_stream_t *stream, std::shared_ptr<const audio_clip_t> clip, float gain);
+		bool stream_request(audio_mixer_stream_t *stream, bool queue);
+		bool stream_open(audio_mixer_stream_t *stream);
+		void stream_close(audio_mixer_stream_t *stream);
+		void stream_buffer_malloc(audio_mixer_stream_t *stream);
+
+		bool stream_apply(void);
+		bool stream_wait(void);
+		void stream_purge(void);
+};
+
+#endif //AUDIOMIXER_HPP
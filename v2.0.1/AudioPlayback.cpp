@@ -6,12 +6,30 @@
  */
 
 #include "AudioPlayback.hpp"
+#include "AudioVerify.hpp"
+#include <time.h>
+#include <pthread.h>
+#include <cerrno>
+
+static std::int64_t monotonic_ns(void)
+{
+	struct timespec tspec;
+
+	clock_gettime(CLOCK_MONOTONIC, &tspec);
+	return ((std::int64_t) tspec.tv_sec)*1000000000 + ((std::int64_t) tspec.tv_nsec);
+}
 
 AudioPlayback::AudioPlayback(audio_playback_params_t *params)
 {
 	this->setParameters(params);
 }
 
+AudioPlayback::~AudioPlayback(void)
+{
+	this->loopbuf_free();
+	this->buffer_release(this->renderbuf);
+}
+
 bool AudioPlayback::setParameters(audio_playback_params_t *params)
 {
 	if(params == nullptr) return false;
@@ -23,12 +41,25 @@ bool AudioPlayback::setParameters(audio_playback_params_t *params)
 	this->audio_data_begin = params->audio_data_begin;
 	this->audio_data_end = params->audio_data_end;
 	this->sample_rate = params->sample_rate;
+	this->big_endian = params->big_endian;
 
 	this->status = STATUS_INITIALIZED;
 	return true;
 }
 
 bool AudioPlayback::runPlayback(void)
+{
+	if(!this->playout_begin()) return false;
+
+	if(this->verbose) std::cout << "Playback started\n";
+	this->playback_proc();
+	if(this->verbose) std::cout << "Playback finished\n";
+	this->playout_end();
+
+	return !this->render_failed;
+}
+
+bool AudioPlayback::playout_begin(void)
 {
 	if(this->status < 1)
 	{
@@ -43,6 +74,8 @@ bool AudioPlayback::runPlayback(void)
 		return false;
 	}
 
+	startup_trace_mark(this->startup_trace, STARTUP_FILEIN_OPEN);
+
 	if(!this->audio_hw_init())
 	{
 		this->status = this->STATUS_ERROR_AUDIOHW;
@@ -50,19 +83,203 @@ bool AudioPlayback::runPlayback(void)
 		return false;
 	}
 
+	startup_trace_mark(this->startup_trace, STARTUP_AUDIO_HW_INIT);
+
 	this->buffer_malloc();
 
-	std::cout << "Playback started\n";
-	this->playback_proc();
-	std::cout << "Playback finished\n";
+	startup_trace_mark(this->startup_trace, STARTUP_BUFFER_MALLOC);
+
+	this->render_failed = false;
+	this->stats_reset();
+	return true;
+}
+
+void AudioPlayback::playout_end(void)
+{
+	this->stats_finish();
 
 	this->filein_close();
 	this->audio_hw_deinit();
+	this->pos_valid = false;
 	this->buffer_free();
+	this->loopbuf_free();
+	return;
+}
+
+bool AudioPlayback::seekFrame(std::uint64_t n_frame)
+{
+	__offset pos = 0;
+
+	if(this->FILEIN_FRAME_SIZE == 0u) return false;
+
+	pos = this->audio_data_begin + ((__offset) (n_frame*this->FILEIN_FRAME_SIZE));
+	if(pos >= this->audio_data_end) return false;
+
+	std::lock_guard<std::mutex> lock(this->ctrl_mutex);
+	this->ctrl_seek_pos = pos;
+	this->ctrl_pending = true;
+	return true;
+}
+
+bool AudioPlayback::setLoopRegion(std::uint64_t begin_frame, std::uint64_t end_frame, int loop_count)
+{
+	__offset begin = 0;
+	__offset end = 0;
+
+	if(this->FILEIN_FRAME_SIZE == 0u) return false;
+	if(begin_frame >= end_frame) return false;
+
+	begin = this->audio_data_begin + ((__offset) (begin_frame*this->FILEIN_FRAME_SIZE));
+	end = this->audio_data_begin + ((__offset) (end_frame*this->FILEIN_FRAME_SIZE));
+	if(end > this->audio_data_end) return false;
+
+	std::lock_guard<std::mutex> lock(this->ctrl_mutex);
+	this->ctrl_loop_begin = begin;
+	this->ctrl_loop_end = end;
+	this->ctrl_loop_count = loop_count;
+	this->ctrl_loop_update = true;
+	this->ctrl_pending = true;
+	return true;
+}
+
+void AudioPlayback::clearLoopRegion(void)
+{
+	std::lock_guard<std::mutex> lock(this->ctrl_mutex);
+	this->ctrl_loop_count = 0;
+	this->ctrl_loop_update = true;
+	this->ctrl_pending = true;
+	return;
+}
+
+bool AudioPlayback::getPlaybackPosition(audio_playback_position_t *position)
+{
+	std::uint32_t seq = 0u;
+	std::uint64_t frames_written = 0u;
+	std::uint64_t file_frame_end = 0u;
+	std::int64_t delay = 0;
+	std::int64_t tstamp_ns = 0;
+	std::int64_t elapsed = 0;
+	std::uint64_t loop_begin = 0u;
+	std::uint64_t loop_end = 0u;
+	std::int64_t file_frame = 0;
+
+	if(position == nullptr) return false;
+	if(!this->pos_valid) return false;
+
+	do {
+		seq = this->pos_seq.load(std::memory_order_acquire);
+		if(seq & 1u) continue;
+
+		frames_written = this->pos_frames_written.load(std::memory_order_relaxed);
+		file_frame_end = this->pos_file_frame_end.load(std::memory_order_relaxed);
+		delay = this->pos_delay.load(std::memory_order_relaxed);
+		tstamp_ns = this->pos_tstamp_ns.load(std::memory_order_relaxed);
+		loop_begin = this->pos_loop_begin.load(std::memory_order_relaxed);
+		loop_end = this->pos_loop_end.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while((seq & 1u) || (seq != this->pos_seq.load(std::memory_order_relaxed)));
+
+	position->delay_frames = delay;
+	position->tstamp_ns = tstamp_ns;
+
+	//Frames consumed by the device since the snapshot was taken
+	elapsed = ((monotonic_ns() - tstamp_ns)*((std::int64_t) this->sample_rate))/1000000000;
+	if(elapsed > delay) elapsed = delay;
+	if(elapsed > 0) delay -= elapsed;
+
+	if(((std::uint64_t) delay) > frames_written) delay = (std::int64_t) frames_written;
+	position->frames_played = frames_written - ((std::uint64_t) delay);
+
+	if(this->FILEIN_FRAME_SIZE == 0u)
+	{
+		position->file_frame = position->frames_played;
+		return true;
+	}
+
+	file_frame = ((std::int64_t) file_frame_end) - delay;
+
+	//Queued frames may span a loop wrap
+	if(loop_end > loop_begin)
+	{
+		while(file_frame < ((std::int64_t) loop_begin)) file_frame += (std::int64_t) (loop_end - loop_begin);
+	}
+
+	if(file_frame < 0) file_frame = 0;
+	position->file_frame = (std::uint64_t) file_frame;
 
 	return true;
 }
 
+void AudioPlayback::setNonBlocking(bool nonblock)
+{
+	this->nonblock = nonblock;
+	return;
+}
+
+void AudioPlayback::setVerbose(bool verbose)
+{
+	this->verbose = verbose;
+	return;
+}
+
+std::uint64_t AudioPlayback::getFramesWritten(void)
+{
+	return this->frames_written;
+}
+
+void AudioPlayback::setStartupTrace(startup_trace_t *trace)
+{
+	this->startup_trace = trace;
+	return;
+}
+
+void AudioPlayback::setPeriodStats(period_stats_t *stats)
+{
+	this->period_stats = stats;
+	return;
+}
+
+void AudioPlayback::setRenderOutput(int fd, __offset fileout_pos, std::uint64_t n_frames, bool pack_s24)
+{
+	this->render_fd = fd;
+	this->render_pos = fileout_pos;
+	this->render_frames = n_frames;
+	this->render_pack_s24 = pack_s24;
+	return;
+}
+
+void AudioPlayback::setVerify(audio_verify_t *verify)
+{
+	this->verify = verify;
+	return;
+}
+
+void AudioPlayback::setBufferArena(BufferArena *arena)
+{
+	this->arena = (arena != nullptr) ? arena : buffer_arena();
+	return;
+}
+
+void AudioPlayback::setReadahead(size_t window_bytes)
+{
+	this->readahead_window = window_bytes;
+	return;
+}
+
+void AudioPlayback::setDirectIO(bool direct_io)
+{
+	this->direct_io = direct_io;
+	return;
+}
+
+void AudioPlayback::setChannelMatrix(const channel_matrix_t *matrix)
+{
+	this->channel_matrix_set = (matrix != nullptr);
+	if(matrix != nullptr) this->channel_matrix = *matrix;
+	return;
+}
+
 std::string AudioPlayback::getLastErrorMessage(void)
 {
 	return this->error_msg;
@@ -70,10 +287,31 @@ std::string AudioPlayback::getLastErrorMessage(void)
 
 bool AudioPlayback::filein_open(void)
 {
-	this->filein = open(this->filein_dir.c_str(), O_RDONLY);
+	//"-" is the standard input. If it is a pipe, its header was already read up to the audio data (stream_get_params).
+	if(this->filein_dir == "-") this->filein = dup(STDIN_FILENO);
+	else this->filein = open(this->filein_dir.c_str(), O_RDONLY);
+
 	if(this->filein < 0) return false;
 
 	this->filein_size = __LSEEK(this->filein, 0, SEEK_END);
+	this->filein_stream = (this->filein_size < 0);
+	this->stream_pos = this->audio_data_begin;
+
+	//Files shorter than their header claims end where the file ends, loop or not
+	if(!this->filein_stream && (this->audio_data_end > this->filein_size)) this->audio_data_end = this->filein_size;
+
+	//filein stays open (buffered) for the file size and nothing else
+	if(this->direct_io && !this->filein_stream)
+	{
+		this->direct_reader = new DirectReader(DIRECT_READER_CHUNK_BYTES);
+
+		if(!this->direct_reader->open(this->filein_dir.c_str()))
+		{
+			delete this->direct_reader;
+			this->direct_reader = nullptr;
+		}
+	}
+
 	return true;
 }
 
@@ -81,12 +319,339 @@ void AudioPlayback::filein_close(void)
 {
 	if(this->filein < 0) return;
 
+	if(this->direct_reader != nullptr)
+	{
+		delete this->direct_reader;
+		this->direct_reader = nullptr;
+	}
+
+	this->readahead_drop(this->filein);
 	close(this->filein);
 	this->filein = -1;
 	this->filein_size = 0;
+	this->filein_stream = false;
 	return;
 }
 
+size_t AudioPlayback::filein_read(void *buf, size_t n_bytes)
+{
+	std::uint8_t *bytebuf = (std::uint8_t*) buf;
+	size_t n_done = 0u;
+	size_t n_chunk = 0u;
+	ssize_t n_read = 0;
+
+	if(this->ctrl_pending) this->ctrl_apply(false);
+
+	while(n_done < n_bytes)
+	{
+		if((this->loop_remaining != 0) && (this->filein_pos == this->loop_end))
+		{
+			this->filein_pos = this->loop_begin;
+			this->loop_wraps++;
+			if(this->loop_remaining > 0) this->loop_remaining--;
+		}
+
+		//Nothing past the audio data is audio (LIST and other trailing chunks)
+		if(this->filein_pos >= this->audio_data_end) break;
+
+		n_chunk = n_bytes - n_done;
+
+		if((this->audio_data_end - this->filein_pos) < ((__offset) n_chunk)) n_chunk = (size_t) (this->audio_data_end - this->filein_pos);
+
+		if((this->loop_remaining != 0) && (this->filein_pos < this->loop_end))
+		{
+			if((this->loop_end - this->filein_pos) < ((__offset) n_chunk)) n_chunk = (size_t) (this->loop_end - this->filein_pos);
+		}
+
+		//Loop start region is served from memory, so wrapping around costs no read.
+		if((this->filein_pos >= this->loop_begin) && (this->filein_pos < (this->loop_begin + ((__offset) this->loopbuf_size))))
+		{
+			size_t loopbuf_pos = (size_t) (this->filein_pos - this->loop_begin);
+			if((this->loopbuf_size - loopbuf_pos) < n_chunk) n_chunk = this->loopbuf_size - loopbuf_pos;
+
+			memcpy(&bytebuf[n_done], &this->loopbuf[loopbuf_pos], n_chunk);
+		}
+		else
+		{
+			n_read = this->filein_pread(&bytebuf[n_done], n_chunk, this->filein_pos);
+			if(n_read < 0) n_read = 0;
+
+			//File is shorter than its header says: playback ends where the file does
+			if(((size_t) n_read) < n_chunk)
+			{
+				n_done += (size_t) n_read;
+				this->filein_pos = this->audio_data_end;
+				break;
+			}
+		}
+
+		this->filein_pos += (__offset) n_chunk;
+		n_done += n_chunk;
+	}
+
+	if((this->readahead_window > 0u) && (this->direct_reader == nullptr) && !this->filein_stream)
+	{
+		//A repeating loop region stays cached, and nothing past it is needed until the loop ends
+		if((this->loop_remaining != 0) && (this->filein_pos <= this->loop_end)) this->readahead_advise(this->filein, &this->readahead, this->filein_pos, this->loop_end, this->loop_begin);
+		else this->readahead_advise(this->filein, &this->readahead, this->filein_pos, this->audio_data_end, this->filein_pos);
+	}
+
+	return n_done;
+}
+
+ssize_t AudioPlayback::filein_pread(void *buf, size_t n_bytes, __offset pos)
+{
+	std::int64_t tstamp = 0;
+	ssize_t n_read = 0;
+
+	if(this->filein_stream) return this->stream_read(buf, n_bytes, pos);
+	if(this->direct_reader == nullptr) return this->stats_pread(this->filein, buf, n_bytes, pos);
+
+	tstamp = monotonic_ns();
+	n_read = this->direct_reader->read(buf, n_bytes, pos);
+	this->stats_read(n_read, monotonic_ns() - tstamp);
+	return n_read;
+}
+
+ssize_t AudioPlayback::stream_read(void *buf, size_t n_bytes, __offset pos)
+{
+	std::uint8_t *bytebuf = (std::uint8_t*) buf;
+	std::int64_t tstamp = monotonic_ns();
+	size_t n_done = 0u;
+	ssize_t n_read = 0;
+
+	if(pos != this->stream_pos) return -1;
+
+	//A pipe hands over whatever the producer wrote so far: n_bytes are only short at the end of the stream
+	while(n_done < n_bytes)
+	{
+		n_read = read(this->filein, &bytebuf[n_done], n_bytes - n_done);
+		if((n_read < 0) && (errno == EINTR)) continue;
+		if(n_read <= 0) break;
+
+		n_done += (size_t) n_read;
+	}
+
+	this->stream_pos += (__offset) n_done;
+	this->stats_read((ssize_t) n_done, monotonic_ns() - tstamp);
+	return (ssize_t) n_done;
+}
+
+void AudioPlayback::readahead_reset(audio_readahead_t *ra, __offset pos)
+{
+	ra->ahead_pos = pos;
+	ra->behind_pos = pos;
+	return;
+}
+
+void AudioPlayback::readahead_advise(int fd, audio_readahead_t *ra, __offset pos, __offset end, __offset keep_begin)
+{
+	__offset window = (__offset) this->readahead_window;
+	__offset ahead_end = pos + window;
+	__offset behind_end = (keep_begin < pos) ? keep_begin : pos;
+
+	if((fd < 0) || (window <= 0)) return;
+
+	//Seeked back, or wrapped around a loop region that was not kept: start over from here
+	if(pos < ra->behind_pos) this->readahead_reset(ra, pos);
+	//Seeked forward past the advised range: nothing to request behind pos
+	if(pos > ra->ahead_pos) ra->ahead_pos = pos;
+	if(behind_end < ra->behind_pos) behind_end = ra->behind_pos;
+
+	if(ahead_end > end) ahead_end = end;
+
+	//Advice is given half a window at a time, so most periods cost no extra syscall
+	if((ahead_end > ra->ahead_pos) && (((ahead_end - ra->ahead_pos) >= (window/2)) || (ahead_end == end)))
+	{
+		posix_fadvise(fd, ra->ahead_pos, ahead_end - ra->ahead_pos, POSIX_FADV_WILLNEED);
+		ra->ahead_pos = ahead_end;
+	}
+
+	//Only whole pages are dropped, so the page holding pos stays cached
+	if((behind_end - ra->behind_pos) >= (window/2))
+	{
+		posix_fadvise(fd, ra->behind_pos, behind_end - ra->behind_pos, POSIX_FADV_DONTNEED);
+		ra->behind_pos = behind_end;
+	}
+
+	return;
+}
+
+void AudioPlayback::readahead_drop(int fd)
+{
+	if((fd < 0) || (this->readahead_window == 0u)) return;
+
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	return;
+}
+
+void AudioPlayback::ctrl_apply(bool reload_loop)
+{
+	std::lock_guard<std::mutex> lock(this->ctrl_mutex);
+
+	this->ctrl_pending = false;
+
+	//Streams play front to back once
+	if(this->filein_stream)
+	{
+		this->ctrl_seek_pos = -1;
+		this->ctrl_loop_update = false;
+		this->loop_remaining = 0;
+		return;
+	}
+
+	if(this->ctrl_seek_pos >= 0)
+	{
+		this->filein_pos = this->ctrl_seek_pos;
+		this->ctrl_seek_pos = -1;
+	}
+
+	if(this->ctrl_loop_update || reload_loop)
+	{
+		this->ctrl_loop_update = false;
+
+		this->loop_begin = this->ctrl_loop_begin;
+		this->loop_end = this->ctrl_loop_end;
+		this->loop_remaining = this->ctrl_loop_count;
+
+		this->loop_prefetch();
+	}
+
+	return;
+}
+
+void AudioPlayback::loop_prefetch(void)
+{
+	size_t n_bytes = LOOP_RESIDENT_BYTES;
+	ssize_t n_read = 0;
+
+	this->loopbuf_size = 0u;
+
+	if(this->loop_remaining == 0) return;
+	if(this->filein < 0) return;
+
+	if(n_bytes < this->BUFFER_SIZE_BYTES) n_bytes = this->BUFFER_SIZE_BYTES;
+	if((this->loop_end - this->loop_begin) < ((__offset) n_bytes)) n_bytes = (size_t) (this->loop_end - this->loop_begin);
+
+	if(this->loopbuf_capacity < n_bytes) this->loopbuf_free();
+
+	if(this->loopbuf == nullptr)
+	{
+		this->loopbuf = (std::uint8_t*) this->buffer_acquire(n_bytes);
+		if(this->loopbuf == nullptr) return;
+
+		this->loopbuf_capacity = n_bytes;
+	}
+
+	//A file cut short inside the loop keeps only what it has: past that, filein_read reads and finds the end
+	n_read = this->filein_pread(this->loopbuf, n_bytes, this->loop_begin);
+	if(n_read < 0) n_read = 0;
+
+	this->loopbuf_size = (size_t) n_read;
+	return;
+}
+
+void AudioPlayback::loopbuf_free(void)
+{
+	if(this->loopbuf == nullptr) return;
+
+	this->buffer_release(this->loopbuf);
+	this->loopbuf = nullptr;
+	this->loopbuf_size = 0u;
+	this->loopbuf_capacity = 0u;
+	return;
+}
+
+bool AudioPlayback::audio_hw_open(snd_pcm_format_t format)
+{
+	snd_pcm_hw_params_t *hw_params = nullptr;
+	snd_pcm_uframes_t nframes = 0u;
+	int n_ret = 0;
+	std::uint32_t rate = this->sample_rate;
+
+	if(this->render_fd >= 0)
+	{
+		//Device format without a device. 24bit samples are S24_LE, 4 bytes each.
+		this->render_frame_size = (format == SND_PCM_FORMAT_S16_LE) ? (2u*this->device_channels) : 8u;
+		if(this->render_pack_s24 && (this->render_frame_size == 8u)) this->render_frame_size = 6u;
+
+		this->BUFFER_SIZE_FRAMES = RENDER_PERIOD_FRAMES;
+		this->DEVICE_BUFFER_FRAMES = RENDER_PERIOD_FRAMES;
+
+		if(this->renderbuf == nullptr) this->renderbuf = (std::uint8_t*) this->buffer_acquire(6u*RENDER_PERIOD_FRAMES);
+		return true;
+	}
+
+	n_ret = snd_pcm_open(&this->audio_dev, this->audio_dev_desc.c_str(), SND_PCM_STREAM_PLAYBACK, (this->nonblock ? SND_PCM_NONBLOCK : 0));
+	if(n_ret < 0)
+	{
+		this->error_msg = "Audio HW Init: could not open audio device.";
+		return false;
+	}
+
+	snd_pcm_hw_params_malloc(&hw_params);
+	snd_pcm_hw_params_any(this->audio_dev, hw_params);
+
+	n_ret = snd_pcm_hw_params_set_access(this->audio_dev, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+	if(n_ret < 0)
+	{
+		this->error_msg = "Audio HW Init: could not set device access.";
+		snd_pcm_hw_params_free(hw_params);
+		snd_pcm_close(this->audio_dev);
+		this->audio_dev = nullptr;
+		return false;
+	}
+
+	n_ret = snd_pcm_hw_params_set_format(this->audio_dev, hw_params, format);
+	if(n_ret < 0)
+	{
+		this->error_msg = "Audio HW Init: could not set device format.";
+		snd_pcm_hw_params_free(hw_params);
+		snd_pcm_close(this->audio_dev);
+		this->audio_dev = nullptr;
+		return false;
+	}
+
+	n_ret = snd_pcm_hw_params_set_channels(this->audio_dev, hw_params, this->device_channels);
+	if(n_ret < 0)
+	{
+		this->error_msg = "Audio HW Init: could not set device channels.";
+		snd_pcm_hw_params_free(hw_params);
+		snd_pcm_close(this->audio_dev);
+		this->audio_dev = nullptr;
+		return false;
+	}
+
+	n_ret = snd_pcm_hw_params_set_rate_near(this->audio_dev, hw_params, &rate, 0);
+	if((n_ret < 0) || (rate < this->sample_rate))
+	{
+		this->error_msg = "Audio HW Init: could not set device sampling rate.";
+		snd_pcm_hw_params_free(hw_params);
+		snd_pcm_close(this->audio_dev);
+		this->audio_dev = nullptr;
+		return false;
+	}
+
+	n_ret = snd_pcm_hw_params(this->audio_dev, hw_params);
+	if(n_ret < 0)
+	{
+		this->error_msg = "Audio HW Init: could not apply device params.";
+		snd_pcm_hw_params_free(hw_params);
+		snd_pcm_close(this->audio_dev);
+		this->audio_dev = nullptr;
+		return false;
+	}
+
+	snd_pcm_hw_params_get_period_size(hw_params, &nframes, 0);
+	this->BUFFER_SIZE_FRAMES = (size_t) nframes;
+
+	snd_pcm_hw_params_get_buffer_size(hw_params, &nframes);
+	this->DEVICE_BUFFER_FRAMES = (size_t) nframes;
+
+	snd_pcm_hw_params_free(hw_params);
+	return true;
+}
+
 void AudioPlayback::audio_hw_deinit(void)
 {
 	if(this->audio_dev == nullptr) return;
@@ -97,13 +662,44 @@ void AudioPlayback::audio_hw_deinit(void)
 	return;
 }
 
+void *AudioPlayback::buffer_acquire(size_t n_bytes)
+{
+	return this->arena->acquire(n_bytes);
+}
+
+void AudioPlayback::buffer_release(void *buf)
+{
+	this->arena->release(buf);
+	return;
+}
+
 void AudioPlayback::playback_proc(void)
+{
+	this->playback_reset();
+
+	if((this->verify != nullptr) && (this->audio_dev != nullptr)) audio_verify_setup(this->verify, (size_t) snd_pcm_frames_to_bytes(this->audio_dev, 1), this->BUFFER_SIZE_FRAMES);
+
+	this->playback_init();
+	startup_trace_mark(this->startup_trace, STARTUP_PLAYBACK_INIT);
+
+	//Chosen once, so the plain loop carries no instrumentation at all
+	if(this->period_stats != nullptr) this->playback_loop_stats();
+	else this->playback_loop();
+
+	return;
+}
+
+void AudioPlayback::playback_reset(void)
 {
 	this->stop = false;
 	this->filein_pos = this->audio_data_begin;
+	this->ctrl_apply(true);
+	this->readahead_reset(&this->readahead, this->filein_pos);
 
-	this->playback_init();
-	this->playback_loop();
+	this->frames_written = 0u;
+	this->loop_wraps = 0u;
+	this->loadout_file_pos = this->filein_pos;
+	this->playout_file_pos = this->filein_pos;
 	return;
 }
 
@@ -112,6 +708,7 @@ void AudioPlayback::playback_init(void)
 	this->buffer_remap();
 
 	this->buffer_load();
+	this->loadout_file_pos = this->filein_pos;
 
 	this->curr_buf_cycle = !this->curr_buf_cycle;
 	this->buffer_remap();
@@ -125,8 +722,44 @@ void AudioPlayback::playback_loop(void)
 	{
 		this->buffer_play();
 		this->buffer_load();
+		this->loadout_file_pos = this->filein_pos;
+		this->curr_buf_cycle = !this->curr_buf_cycle;
+		this->buffer_remap();
+	}
+
+	return;
+}
+
+void AudioPlayback::playback_loop_stats(void)
+{
+	period_stats_t *stats = this->period_stats;
+	snd_pcm_sframes_t avail = 0;
+	std::int64_t queued = 0;
+	std::int64_t tstamp_0 = 0;
+	std::int64_t tstamp_1 = 0;
+	std::int64_t tstamp_2 = 0;
+
+	while(!this->stop)
+	{
+		//Whatever is still queued when the next period is written is the margin left before an underrun
+		avail = (this->audio_dev != nullptr) ? snd_pcm_avail(this->audio_dev) : (snd_pcm_sframes_t) this->DEVICE_BUFFER_FRAMES;
+		if(avail < 0) queued = 0;
+		else queued = (std::int64_t) this->DEVICE_BUFFER_FRAMES - (std::int64_t) avail;
+		if(queued < 0) queued = 0;
+
+		tstamp_0 = monotonic_ns();
+		this->buffer_play();
+		tstamp_1 = monotonic_ns();
+		this->buffer_load();
+		tstamp_2 = monotonic_ns();
+
+		this->loadout_file_pos = this->filein_pos;
 		this->curr_buf_cycle = !this->curr_buf_cycle;
 		this->buffer_remap();
+
+		period_histogram_record(&stats->play, (std::uint64_t) (tstamp_1 - tstamp_0));
+		period_histogram_record(&stats->load, (std::uint64_t) (tstamp_2 - tstamp_1));
+		period_histogram_record(&stats->headroom, (std::uint64_t) ((queued*1000000000)/((std::int64_t) this->sample_rate)));
 	}
 
 	return;
@@ -145,13 +778,261 @@ void AudioPlayback::buffer_remap(void)
 		this->playout_buf = this->bufferout_1;
 	}
 
+	this->playout_file_pos = this->loadout_file_pos;
+
 	return;
 }
 
 void AudioPlayback::buffer_play(void)
 {
-	int n_ret = snd_pcm_writei(this->audio_dev, this->playout_buf, (snd_pcm_uframes_t) this->BUFFER_SIZE_FRAMES);
-	if(n_ret == -EPIPE) snd_pcm_prepare(this->audio_dev);
+	const std::uint8_t *playout = (const std::uint8_t*) this->playout_buf;
+	snd_pcm_uframes_t n_frames = (snd_pcm_uframes_t) this->BUFFER_SIZE_FRAMES;
+	snd_pcm_sframes_t n_ret = 0;
+	bool first_write = (this->frames_written == 0u);
+
+	if(this->render_fd >= 0)
+	{
+		this->render_write();
+		return;
+	}
+
+	//Short writes and non-blocking retries continue with the frames left over
+	while(n_frames > 0u)
+	{
+		n_ret = snd_pcm_writei(this->audio_dev, playout, n_frames);
+
+		if(n_ret == -EAGAIN)
+		{
+			snd_pcm_wait(this->audio_dev, 1000);
+			continue;
+		}
+
+		if(n_ret == -EPIPE)
+		{
+			this->st_xruns.store(this->st_xruns.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+			if(snd_pcm_prepare(this->audio_dev) >= 0) this->st_recoveries.store(this->st_recoveries.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+			continue;
+		}
+
+		if(n_ret < 0) break;
+
+		playout += snd_pcm_frames_to_bytes(this->audio_dev, n_ret);
+		n_frames -= (snd_pcm_uframes_t) n_ret;
+		this->frames_written += (std::uint64_t) n_ret;
+	}
+
+	if(this->verify != nullptr) audio_verify_period(this->verify, this->playout_buf, this->BUFFER_SIZE_FRAMES - (size_t) n_frames, this->BUFFER_SIZE_FRAMES);
+
+	if(first_write && (this->frames_written > 0u)) startup_trace_mark(this->startup_trace, STARTUP_FIRST_WRITE);
+
+	this->position_update();
+	return;
+}
+
+void AudioPlayback::render_write(void)
+{
+	const std::uint8_t *playout = (const std::uint8_t*) this->playout_buf;
+	const std::int32_t *samples = (const std::int32_t*) this->playout_buf;
+	size_t n_frames = this->BUFFER_SIZE_FRAMES;
+	size_t n_bytes = 0u;
+	size_t n_sample = 0u;
+	ssize_t n_ret = 0;
+
+	if(this->render_frames < ((std::uint64_t) n_frames)) n_frames = (size_t) this->render_frames;
+
+	if(this->render_frame_size == 6u)
+	{
+		for(n_sample = 0u; n_sample < 2u*n_frames; n_sample++)
+		{
+			this->renderbuf[3u*n_sample] = (std::uint8_t) samples[n_sample];
+			this->renderbuf[3u*n_sample + 1u] = (std::uint8_t) (samples[n_sample] >> 8);
+			this->renderbuf[3u*n_sample + 2u] = (std::uint8_t) (samples[n_sample] >> 16);
+		}
+
+		playout = this->renderbuf;
+	}
+
+	n_bytes = n_frames*this->render_frame_size;
+
+	while(n_bytes > 0u)
+	{
+		if(this->render_pos >= 0) n_ret = __PWRITE(this->render_fd, playout, n_bytes, this->render_pos);
+		else n_ret = write(this->render_fd, playout, n_bytes);
+
+		if(n_ret <= 0)
+		{
+			this->error_msg = "Render: could not write output.";
+			this->render_failed = true;
+			this->stop = true;
+			return;
+		}
+
+		playout += n_ret;
+		n_bytes -= (size_t) n_ret;
+		if(this->render_pos >= 0) this->render_pos += (__offset) n_ret;
+	}
+
+	this->frames_written += (std::uint64_t) n_frames;
+	this->render_frames -= (std::uint64_t) n_frames;
+
+	//Padding past the end of the data is never written
+	if(this->render_frames == 0u) this->stop = true;
+
+	return;
+}
+
+void AudioPlayback::position_update(void)
+{
+	this->position_update(this->playout_file_pos, this->loop_wraps, this->loop_begin, this->loop_end);
 	return;
 }
 
+void AudioPlayback::position_update(__offset file_pos, std::uint64_t loop_wraps, __offset loop_begin_pos, __offset loop_end_pos)
+{
+	snd_pcm_sframes_t delay = 0;
+	std::uint64_t file_frame_end = 0u;
+	std::uint64_t loop_begin = 0u;
+	std::uint64_t loop_end = 0u;
+	std::uint32_t seq = this->pos_seq.load(std::memory_order_relaxed);
+
+	if((this->audio_dev == nullptr) || (snd_pcm_delay(this->audio_dev, &delay) < 0)) delay = 0;
+	if(delay < 0) delay = 0;
+
+	if(this->FILEIN_FRAME_SIZE > 0u)
+	{
+		file_frame_end = (std::uint64_t) ((file_pos - this->audio_data_begin)/((__offset) this->FILEIN_FRAME_SIZE));
+
+		//Once the loop has wrapped, queued frames before loop_begin belong to the previous pass
+		if(loop_wraps > 0u)
+		{
+			loop_begin = (std::uint64_t) ((loop_begin_pos - this->audio_data_begin)/((__offset) this->FILEIN_FRAME_SIZE));
+			loop_end = (std::uint64_t) ((loop_end_pos - this->audio_data_begin)/((__offset) this->FILEIN_FRAME_SIZE));
+		}
+	}
+
+	this->pos_seq.store(seq + 1u, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	this->pos_frames_written.store(this->frames_written, std::memory_order_relaxed);
+	this->pos_file_frame_end.store(file_frame_end, std::memory_order_relaxed);
+	this->pos_delay.store((std::int64_t) delay, std::memory_order_relaxed);
+	this->pos_tstamp_ns.store(monotonic_ns(), std::memory_order_relaxed);
+	this->pos_loop_begin.store(loop_begin, std::memory_order_relaxed);
+	this->pos_loop_end.store(loop_end, std::memory_order_relaxed);
+
+	this->pos_seq.store(seq + 2u, std::memory_order_release);
+	this->pos_valid = true;
+	return;
+}
+
+bool AudioPlayback::getStats(audio_playback_stats_t *stats)
+{
+	audio_playback_position_t position;
+	struct timespec tspec;
+	std::int64_t start_ns = 0;
+	clockid_t cpu_clock = CLOCK_THREAD_CPUTIME_ID;
+
+	if(stats == nullptr) return false;
+
+	start_ns = this->st_start_ns.load(std::memory_order_acquire);
+	if(start_ns == 0) return false;
+
+	stats->running = this->st_running.load(std::memory_order_acquire);
+	stats->frames_written = this->pos_frames_written.load(std::memory_order_relaxed);
+	stats->frames_played = stats->frames_written;
+	stats->ring_frames = 0;
+
+	if(stats->running && this->getPlaybackPosition(&position))
+	{
+		stats->frames_played = position.frames_played;
+		stats->ring_frames = position.delay_frames;
+	}
+
+	stats->bytes_read = this->st_bytes_read.load(std::memory_order_relaxed);
+	stats->reads = this->st_reads.load(std::memory_order_relaxed);
+	stats->read_ns_total = this->st_read_ns_total.load(std::memory_order_relaxed);
+	stats->read_ns_max = this->st_read_ns_max.load(std::memory_order_relaxed);
+	stats->xruns = this->st_xruns.load(std::memory_order_relaxed);
+	stats->recoveries = this->st_recoveries.load(std::memory_order_relaxed);
+	stats->ring_capacity = (std::int64_t) this->DEVICE_BUFFER_FRAMES;
+
+	//The playback thread's CPU clock can be read from any thread while it is running.
+	//CLOCK_THREAD_CPUTIME_ID would be the clock of the caller instead, so there is no CPU time to report.
+	if(stats->running)
+	{
+		cpu_clock = this->st_cpu_clock.load(std::memory_order_relaxed);
+
+		if((cpu_clock != CLOCK_THREAD_CPUTIME_ID) && (clock_gettime(cpu_clock, &tspec) == 0)) stats->cpu_ns = ((std::int64_t) tspec.tv_sec)*1000000000 + ((std::int64_t) tspec.tv_nsec) - this->st_cpu_base_ns.load(std::memory_order_relaxed);
+		else stats->cpu_ns = 0;
+
+		stats->uptime_ns = monotonic_ns() - start_ns;
+	}
+	else
+	{
+		stats->cpu_ns = this->st_cpu_ns.load(std::memory_order_relaxed);
+		stats->uptime_ns = this->st_end_ns.load(std::memory_order_relaxed) - start_ns;
+	}
+
+	return true;
+}
+
+void AudioPlayback::stats_reset(void)
+{
+	struct timespec tspec;
+	clockid_t cpu_clock = CLOCK_THREAD_CPUTIME_ID;
+
+	//getStats reports nothing until the new run is set up
+	this->st_start_ns.store(0, std::memory_order_release);
+
+	this->st_bytes_read.store(0u, std::memory_order_relaxed);
+	this->st_reads.store(0u, std::memory_order_relaxed);
+	this->st_read_ns_total.store(0u, std::memory_order_relaxed);
+	this->st_read_ns_max.store(0u, std::memory_order_relaxed);
+	this->st_xruns.store(0u, std::memory_order_relaxed);
+	this->st_recoveries.store(0u, std::memory_order_relaxed);
+
+	//CPU time is counted from here, so time spent before this run is not included
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tspec);
+	this->st_cpu_base_ns.store(((std::int64_t) tspec.tv_sec)*1000000000 + ((std::int64_t) tspec.tv_nsec), std::memory_order_relaxed);
+	this->st_cpu_ns.store(0, std::memory_order_relaxed);
+
+	if(pthread_getcpuclockid(pthread_self(), &cpu_clock) != 0) cpu_clock = CLOCK_THREAD_CPUTIME_ID;
+	this->st_cpu_clock.store(cpu_clock, std::memory_order_relaxed);
+
+	this->st_end_ns.store(0, std::memory_order_relaxed);
+	this->st_running.store(true, std::memory_order_relaxed);
+	this->st_start_ns.store(monotonic_ns(), std::memory_order_release);
+	return;
+}
+
+void AudioPlayback::stats_finish(void)
+{
+	struct timespec tspec;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tspec);
+	this->st_cpu_ns.store(((std::int64_t) tspec.tv_sec)*1000000000 + ((std::int64_t) tspec.tv_nsec) - this->st_cpu_base_ns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	this->st_end_ns.store(monotonic_ns(), std::memory_order_relaxed);
+	this->st_running.store(false, std::memory_order_release);
+	return;
+}
+
+void AudioPlayback::stats_read(ssize_t n_read, std::int64_t read_ns)
+{
+	this->st_reads.store(this->st_reads.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+	if(n_read > 0) this->st_bytes_read.store(this->st_bytes_read.load(std::memory_order_relaxed) + ((std::uint64_t) n_read), std::memory_order_relaxed);
+
+	if(read_ns < 0) read_ns = 0;
+	this->st_read_ns_total.store(this->st_read_ns_total.load(std::memory_order_relaxed) + ((std::uint64_t) read_ns), std::memory_order_relaxed);
+	if(((std::uint64_t) read_ns) > this->st_read_ns_max.load(std::memory_order_relaxed)) this->st_read_ns_max.store((std::uint64_t) read_ns, std::memory_order_relaxed);
+
+	return;
+}
+
+ssize_t AudioPlayback::stats_pread(int fd, void *buf, size_t n_bytes, __offset pos)
+{
+	std::int64_t tstamp = monotonic_ns();
+	ssize_t n_read = __PREAD(fd, buf, n_bytes, pos);
+
+	this->stats_read(n_read, monotonic_ns() - tstamp);
+	return n_read;
+}
@@ -9,31 +9,144 @@
 #define AUDIOPLAYBACK_HPP
 
 #include "globaldef.h"
+#include "StartupTrace.hpp"
+#include "PeriodStats.hpp"
+#include "BufferArena.hpp"
+#include "DirectReader.hpp"
+#include "ChannelMatrix.hpp"
 #include <iostream>
 #include <string>
+#include <mutex>
+#include <atomic>
+#include <time.h>
 
 #include <alsa/asoundlib.h>
 
+#define RENDER_PERIOD_FRAMES 16384u
+//Loop regions up to this size are held in memory whole, longer ones only their beginning
+#define LOOP_RESIDENT_BYTES 0x400000u
+
+typedef struct audio_verify audio_verify_t;
+
+class PlayoutEngine;
+
 struct audio_playback_params {
 	char *audio_dev_desc;
 	char *filein_dir;
 	__offset audio_data_begin;
 	__offset audio_data_end;
 	std::uint32_t sample_rate;
+	std::uint16_t n_channels;
+	std::uint16_t block_align;
+	std::uint16_t samples_per_block; //Compressed formats only
+	bool big_endian; //RIFX file: 16bit and 24bit samples are big-endian
+
+	//Loop stored in the file ("smpl" or "cue " chunk), in frames from the beginning of the audio data. loop_count 0: no loop, -1: endless.
+	std::uint64_t loop_begin_frame;
+	std::uint64_t loop_end_frame;
+	int loop_count;
 };
 
 typedef struct audio_playback_params audio_playback_params_t;
 
+struct audio_playback_position {
+	std::uint64_t frames_played; //Frames heard since playback started
+	std::uint64_t file_frame; //Frame of the audio data being heard
+	std::int64_t delay_frames; //Frames queued in the device when the snapshot was taken
+	std::int64_t tstamp_ns; //CLOCK_MONOTONIC time of the snapshot
+};
+
+typedef struct audio_playback_position audio_playback_position_t;
+
+struct audio_playback_stats {
+	std::uint64_t frames_written; //Frames handed to the device
+	std::uint64_t frames_played; //Frames heard (frames written minus frames still queued)
+	std::uint64_t bytes_read; //Bytes read from the input file(s)
+	std::uint64_t reads; //Number of read calls
+	std::uint64_t read_ns_total; //Time spent in read calls
+	std::uint64_t read_ns_max; //Slowest read call
+	std::uint64_t xruns; //Underruns reported by the device
+	std::uint64_t recoveries; //Successful recoveries from an underrun
+	std::int64_t ring_frames; //Frames queued in the device at the last period
+	std::int64_t ring_capacity; //Device buffer size in frames
+	std::int64_t cpu_ns; //CPU time used by the playback thread (0 while running if its clock can not be read from other threads)
+	std::int64_t uptime_ns; //Time since playback started
+	bool running;
+};
+
+typedef struct audio_playback_stats audio_playback_stats_t;
+
+//Page cache advice already given for a file being streamed
+struct audio_readahead {
+	__offset ahead_pos; //WILLNEED was given up to here
+	__offset behind_pos; //DONTNEED was given up to here
+};
+
+typedef struct audio_readahead audio_readahead_t;
+
 class AudioPlayback {
 	public:
 		AudioPlayback(audio_playback_params_t *params);
+		virtual ~AudioPlayback(void);
 
 		bool setParameters(audio_playback_params_t *params);
 		bool runPlayback(void);
 
+		//Playback control. Frames are counted from the beginning of the audio data. Safe to call while playing.
+		bool seekFrame(std::uint64_t n_frame);
+		//loop_count: number of times the region repeats. -1 loops forever, 0 removes the loop region.
+		bool setLoopRegion(std::uint64_t begin_frame, std::uint64_t end_frame, int loop_count);
+		void clearLoopRegion(void);
+
+		//Lock-free. Extrapolates the last snapshot taken by the playback thread to the current time.
+		bool getPlaybackPosition(audio_playback_position_t *position);
+		//Lock-free. Counters are kept for the current (or last) run.
+		bool getStats(audio_playback_stats_t *stats);
+
+		//Non-blocking mode is meant for benchmarking: writes are not paced by the device.
+		void setNonBlocking(bool nonblock);
+		void setVerbose(bool verbose);
+		std::uint64_t getFramesWritten(void);
+
+		//Records startup phases into trace during the next runPlayback. nullptr disables tracing.
+		void setStartupTrace(startup_trace_t *trace);
+		//Records per-period load/play times and device headroom into stats. nullptr disables recording.
+		void setPeriodStats(period_stats_t *stats);
+
+		/*
+		 * Offline rendering: no audio device is opened, n_frames frames of device format audio are written to fd
+		 * at fileout_pos (or appended, if fileout_pos is negative) as fast as they are decoded.
+		 * pack_s24 writes 24bit output as packed 3 byte samples instead of S24_LE in 4 bytes. fd -1 disables rendering.
+		 */
+		void setRenderOutput(int fd, __offset fileout_pos, std::uint64_t n_frames, bool pack_s24);
+		//Hashes every period written to the device into verify during the next runPlayback. nullptr disables verification.
+		void setVerify(audio_verify_t *verify);
+		//Where period buffers come from. Call while not playing. nullptr selects the process-wide arena (default).
+		void setBufferArena(BufferArena *arena);
+		/*
+		 * Streaming page cache policy. window_bytes of the file ahead of the read position are requested in advance
+		 * (POSIX_FADV_WILLNEED), and what has been read is dropped from the page cache (POSIX_FADV_DONTNEED), except a
+		 * loop region that is still repeating. The page cache used by a file stays around one window however large the file is.
+		 * 0 disables it (default): the kernel readahead applies and read pages stay cached. Call while not playing.
+		 */
+		void setReadahead(size_t window_bytes);
+		/*
+		 * Reads the audio data with O_DIRECT, bypassing the page cache, through a DirectReader (aligned, double buffered).
+		 * Files on a file system without O_DIRECT support are read as usual. The readahead policy does not apply. Call while not playing.
+		 */
+		void setDirectIO(bool direct_io);
+		/*
+		 * Channel matrix from the channels of the file to the channels of the device (PB_16BITNCH only), copied.
+		 * nullptr selects the default matrix from the channels of the file to stereo. Call while not playing.
+		 */
+		void setChannelMatrix(const channel_matrix_t *matrix);
+
 		std::string getLastErrorMessage(void);
 
 	protected:
+		//Drives objects period by period from its own threads, through playout_begin/playout_end and buffer_load
+		friend class PlayoutEngine;
+
 		enum Status {
 			STATUS_ERROR_NOFILE = -3,
 			STATUS_ERROR_AUDIOHW = -2,
@@ -50,9 +163,16 @@ class AudioPlayback {
 		__offset filein_size = 0;
 		__offset filein_pos = 0;
 
+		//filein is a pipe or socket: read front to back, no seek, loop or pread. stream_pos is where it stands.
+		bool filein_stream = false;
+		__offset stream_pos = 0;
+
 		__offset audio_data_begin = 0;
 		__offset audio_data_end = 0;
 
+		//RIFX file: the 16bit and 24bit classes convert with the big-endian kernels
+		bool big_endian = false;
+
 		std::string filein_dir = "";
 		std::string audio_dev_desc = "";
 
@@ -60,7 +180,70 @@ class AudioPlayback {
 
 		snd_pcm_t *audio_dev = nullptr;
 
+		int render_fd = -1;
+		__offset render_pos = -1;
+		std::uint64_t render_frames = 0u;
+		bool render_pack_s24 = false;
+		bool render_failed = false;
+		size_t render_frame_size = 0u;
+		std::uint8_t *renderbuf = nullptr;
+
+		size_t FILEIN_FRAME_SIZE = 0u;
+
+		//Channels opened on the device (and rendered). Set by classes that play through a channel matrix.
+		unsigned int device_channels = 2u;
+		channel_matrix_t channel_matrix;
+		bool channel_matrix_set = false;
+
+		//Loop region in use by the playback thread. The region (or its first LOOP_RESIDENT_BYTES) is kept in loopbuf, so a wrap reads nothing.
+		__offset loop_begin = 0;
+		__offset loop_end = 0;
+		int loop_remaining = 0;
+		std::uint64_t loop_wraps = 0u;
+
+		std::uint8_t *loopbuf = nullptr;
+		size_t loopbuf_size = 0u;
+		size_t loopbuf_capacity = 0u;
+
+		//Control requests, applied by the playback thread at the next read.
+		std::mutex ctrl_mutex;
+		std::atomic<bool> ctrl_pending{false};
+		__offset ctrl_seek_pos = -1;
+		__offset ctrl_loop_begin = 0;
+		__offset ctrl_loop_end = 0;
+		int ctrl_loop_count = 0;
+		bool ctrl_loop_update = false;
+
+		//Position snapshot, written by the playback thread after every period (seqlock).
+		std::atomic<std::uint32_t> pos_seq{0u};
+		std::atomic<bool> pos_valid{false};
+		std::atomic<std::uint64_t> pos_frames_written{0u};
+		std::atomic<std::uint64_t> pos_file_frame_end{0u};
+		std::atomic<std::int64_t> pos_delay{0};
+		std::atomic<std::int64_t> pos_tstamp_ns{0};
+		std::atomic<std::uint64_t> pos_loop_begin{0u};
+		std::atomic<std::uint64_t> pos_loop_end{0u};
+
+		//Counters for getStats, written by the playback thread only.
+		std::atomic<std::uint64_t> st_bytes_read{0u};
+		std::atomic<std::uint64_t> st_reads{0u};
+		std::atomic<std::uint64_t> st_read_ns_total{0u};
+		std::atomic<std::uint64_t> st_read_ns_max{0u};
+		std::atomic<std::uint64_t> st_xruns{0u};
+		std::atomic<std::uint64_t> st_recoveries{0u};
+		std::atomic<std::int64_t> st_start_ns{0};
+		std::atomic<std::int64_t> st_end_ns{0};
+		std::atomic<std::int64_t> st_cpu_ns{0};
+		std::atomic<bool> st_running{false};
+		std::atomic<std::int64_t> st_cpu_base_ns{0};
+		std::atomic<clockid_t> st_cpu_clock{CLOCK_THREAD_CPUTIME_ID};
+
+		std::uint64_t frames_written = 0u;
+		__offset loadout_file_pos = 0;
+		__offset playout_file_pos = 0;
+
 		size_t BUFFER_SIZE_FRAMES = 0u;
+		size_t DEVICE_BUFFER_FRAMES = 0u;
 		size_t BUFFER_SIZE_SAMPLES = 0u;
 		size_t BUFFER_SIZE_BYTES = 0u;
 
@@ -73,22 +256,73 @@ class AudioPlayback {
 		bool curr_buf_cycle = false;
 		bool stop = false;
 
-		bool filein_open(void);
-		void filein_close(void);
+		bool nonblock = false;
+		bool verbose = true;
+
+		startup_trace_t *startup_trace = nullptr;
+		period_stats_t *period_stats = nullptr;
+		audio_verify_t *verify = nullptr;
+		BufferArena *arena = buffer_arena();
+
+		size_t readahead_window = 0u;
+		audio_readahead_t readahead = {0, 0};
+
+		bool direct_io = false;
+		DirectReader *direct_reader = nullptr; //Only while the file is open in direct mode
+
+		virtual bool filein_open(void);
+		virtual void filein_close(void);
+		//Returns the bytes read: short only at the end of the audio data, 0 once playback is over.
+		//Loops wrap in here, so buffer_load tells the end by the return value, never by filein_pos.
+		size_t filein_read(void *buf, size_t n_bytes);
+		//Timed pread of filein, through the DirectReader in direct mode
+		ssize_t filein_pread(void *buf, size_t n_bytes, __offset pos);
+		//Stream input: only reads at stream_pos succeed
+		ssize_t stream_read(void *buf, size_t n_bytes, __offset pos);
+
+		void readahead_reset(audio_readahead_t *ra, __offset pos);
+		//pos: read position. Nothing is requested past end, nothing is dropped from keep_begin on.
+		void readahead_advise(int fd, audio_readahead_t *ra, __offset pos, __offset end, __offset keep_begin);
+		//Drops every cached page of the file, once it is no longer read
+		void readahead_drop(int fd);
+
+		void ctrl_apply(bool reload_loop);
+		void loop_prefetch(void);
+		void loopbuf_free(void);
 
 		virtual bool audio_hw_init(void) = 0;
+		bool audio_hw_open(snd_pcm_format_t format);
 		void audio_hw_deinit(void);
 
 		virtual void buffer_malloc(void) = 0;
 		virtual void buffer_free(void) = 0;
+		//Period buffers from the arena: aligned, already faulted in, contents undefined
+		void *buffer_acquire(size_t n_bytes);
+		void buffer_release(void *buf);
+
+		//Setup and teardown around a run: input file, device, buffers and stats
+		bool playout_begin(void);
+		void playout_end(void);
 
 		void playback_proc(void);
+		void playback_reset(void);
 		void playback_init(void);
 		void playback_loop(void);
+		void playback_loop_stats(void);
 		void buffer_remap(void);
 
 		virtual void buffer_load(void) = 0;
 		void buffer_play(void);
+		void render_write(void);
+		void position_update(void);
+		//Position of the period just written, for callers that load ahead of the period being played
+		void position_update(__offset file_pos, std::uint64_t loop_wraps, __offset loop_begin_pos, __offset loop_end_pos);
+
+		void stats_reset(void);
+		void stats_finish(void);
+		void stats_read(ssize_t n_read, std::int64_t read_ns);
+		//Timed pread for reads outside filein_read
+		ssize_t stats_pread(int fd, void *buf, size_t n_bytes, __offset pos);
 };
 
 #endif //AUDIOPLAYBACK_HPP
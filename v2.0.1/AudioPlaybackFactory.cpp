@@ -0,0 +1,68 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "AudioPlaybackFactory.hpp"
+#include "AudioPlayback_8bit1ch.hpp"
+#include "AudioPlayback_8bit2ch.hpp"
+#include "AudioPlayback_16bit1ch.hpp"
+#include "AudioPlayback_16bit2ch.hpp"
+#include "AudioPlayback_16bitNch.hpp"
+#include "AudioPlayback_24bit1ch.hpp"
+#include "AudioPlayback_24bit2ch.hpp"
+#include "AudioPlayback_g711.hpp"
+#include "AudioPlayback_imaadpcm.hpp"
+#include "WaveHeader.hpp"
+
+static AudioPlayback *audio_playback_new(int format, audio_playback_params_t *params);
+
+AudioPlayback *audio_playback_create(int format, audio_playback_params_t *params)
+{
+	AudioPlayback *pb_obj = audio_playback_new(format, params);
+
+	//A loop outside the audio data, or in a format that can not loop (IMA ADPCM), is ignored
+	if((pb_obj != nullptr) && (params->loop_count != 0)) pb_obj->setLoopRegion(params->loop_begin_frame, params->loop_end_frame, params->loop_count);
+
+	return pb_obj;
+}
+
+static AudioPlayback *audio_playback_new(int format, audio_playback_params_t *params)
+{
+	switch(format)
+	{
+		case PB_8BIT1CH:
+			return new AudioPlayback_8bit1ch(params);
+
+		case PB_8BIT2CH:
+			return new AudioPlayback_8bit2ch(params);
+
+		case PB_16BIT1CH:
+			return new AudioPlayback_16bit1ch(params);
+
+		case PB_16BIT2CH:
+			return new AudioPlayback_16bit2ch(params);
+
+		case PB_16BITNCH:
+			return new AudioPlayback_16bitNch(params);
+
+		case PB_24BIT1CH:
+			return new AudioPlayback_24bit1ch(params);
+
+		case PB_24BIT2CH:
+			return new AudioPlayback_24bit2ch(params);
+
+		case PB_G711ALAW:
+			return new AudioPlayback_g711(params, true);
+
+		case PB_G711ULAW:
+			return new AudioPlayback_g711(params, false);
+
+		case PB_IMAADPCM:
+			return new AudioPlayback_imaadpcm(params);
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,19 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef AUDIOPLAYBACKFACTORY_HPP
+#define AUDIOPLAYBACKFACTORY_HPP
+
+#include "AudioPlayback.hpp"
+
+/*
+ * Creates the playback object for one of the PB_ format codes returned by file_get_params. Returns nullptr for unknown codes.
+ * The loop in params, if any, is set on the object (setLoopRegion); clear loop_count first to play straight through.
+ */
+AudioPlayback *audio_playback_create(int format, audio_playback_params_t *params);
+
+#endif //AUDIOPLAYBACKFACTORY_HPP
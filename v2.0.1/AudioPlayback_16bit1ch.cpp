@@ -9,6 +9,7 @@
 
 AudioPlayback_16bit1ch::AudioPlayback_16bit1ch(audio_playback_params_t *params) : AudioPlayback(params)
 {
+	this->FILEIN_FRAME_SIZE = 2u;
 }
 
 AudioPlayback_16bit1ch::~AudioPlayback_16bit1ch(void)
@@ -20,75 +21,7 @@ AudioPlayback_16bit1ch::~AudioPlayback_16bit1ch(void)
 
 bool AudioPlayback_16bit1ch::audio_hw_init(void)
 {
-	snd_pcm_hw_params_t *hw_params = nullptr;
-	snd_pcm_uframes_t nframes = 0u;
-	int n_ret = 0;
-	std::uint32_t rate = this->sample_rate;
-
-	n_ret = snd_pcm_open(&this->audio_dev, this->audio_dev_desc.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not open audio device.";
-		return false;
-	}
-
-	snd_pcm_hw_params_malloc(&hw_params);
-	snd_pcm_hw_params_any(this->audio_dev, hw_params);
-
-	n_ret = snd_pcm_hw_params_set_access(this->audio_dev, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not set device access.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	n_ret = snd_pcm_hw_params_set_format(this->audio_dev, hw_params, SND_PCM_FORMAT_S16_LE);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not set device format.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	n_ret = snd_pcm_hw_params_set_channels(this->audio_dev, hw_params, 2);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not set device channels.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	n_ret = snd_pcm_hw_params_set_rate_near(this->audio_dev, hw_params, &rate, 0);
-	if((n_ret < 0) || (rate < this->sample_rate))
-	{
-		this->error_msg = "Audio HW Init: could not set device sampling rate.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	n_ret = snd_pcm_hw_params(this->audio_dev, hw_params);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not apply device params.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	snd_pcm_hw_params_get_period_size(hw_params, &nframes, 0);
-	snd_pcm_hw_params_free(hw_params);
-
-	this->BUFFER_SIZE_FRAMES = (size_t) nframes;
+	if(!this->audio_hw_open(SND_PCM_FORMAT_S16_LE)) return false;
 
 	this->BUFFER_SIZE_SAMPLES = this->BUFFER_SIZE_FRAMES;
 	this->BUFFER_SIZE_BYTES = 2u*this->BUFFER_SIZE_SAMPLES;
@@ -101,13 +34,9 @@ bool AudioPlayback_16bit1ch::audio_hw_init(void)
 
 void AudioPlayback_16bit1ch::buffer_malloc(void)
 {
-	if(this->bufferin == nullptr) this->bufferin = (std::int16_t*) std::malloc(this->BUFFER_SIZE_BYTES);
-	if(this->bufferout_0 == nullptr) this->bufferout_0 = std::malloc(this->AUDIOBUFFER_SIZE_BYTES);
-	if(this->bufferout_1 == nullptr) this->bufferout_1 = std::malloc(this->AUDIOBUFFER_SIZE_BYTES);
-
-	memset(this->bufferin, 0, this->BUFFER_SIZE_BYTES);
-	memset(this->bufferout_0, 0, this->AUDIOBUFFER_SIZE_BYTES);
-	memset(this->bufferout_1, 0, this->AUDIOBUFFER_SIZE_BYTES);
+	if(this->bufferin == nullptr) this->bufferin = (std::int16_t*) this->buffer_acquire(this->BUFFER_SIZE_BYTES);
+	if(this->bufferout_0 == nullptr) this->bufferout_0 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
+	if(this->bufferout_1 == nullptr) this->bufferout_1 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
 
 	return;
 }
@@ -116,19 +45,19 @@ void AudioPlayback_16bit1ch::buffer_free(void)
 {
 	if(this->bufferin != nullptr)
 	{
-		std::free(this->bufferin);
+		this->buffer_release(this->bufferin);
 		this->bufferin = nullptr;
 	}
 
 	if(this->bufferout_0 != nullptr)
 	{
-		std::free(this->bufferout_0);
+		this->buffer_release(this->bufferout_0);
 		this->bufferout_0 = nullptr;
 	}
 
 	if(this->bufferout_1 != nullptr)
 	{
-		std::free(this->bufferout_1);
+		this->buffer_release(this->bufferout_1);
 		this->bufferout_1 = nullptr;
 	}
 
@@ -139,26 +68,20 @@ void AudioPlayback_16bit1ch::buffer_free(void)
 
 void AudioPlayback_16bit1ch::buffer_load(void)
 {
-	std::int16_t *loadout16 = (std::int16_t*) this->loadout_buf;
-	size_t n_frame = 0u;
+	size_t n_read = 0u;
 
-	if(this->filein_pos >= this->audio_data_end)
+	n_read = this->filein_read(this->bufferin, this->BUFFER_SIZE_BYTES);
+	if(n_read == 0u)
 	{
 		this->stop = true;
 		return;
 	}
 
-	memset(this->bufferin, 0, this->BUFFER_SIZE_BYTES);
+	//Only the last period is short, the rest of it is silence
+	if(n_read < this->BUFFER_SIZE_BYTES) memset(&((std::uint8_t*) this->bufferin)[n_read], 0, this->BUFFER_SIZE_BYTES - n_read);
 
-	__LSEEK(this->filein, this->filein_pos, SEEK_SET);
-	read(this->filein, this->bufferin, this->BUFFER_SIZE_BYTES);
-	this->filein_pos += (__offset) this->BUFFER_SIZE_BYTES;
-
-	for(n_frame = 0u; n_frame < this->BUFFER_SIZE_FRAMES; n_frame++)
-	{
-		loadout16[2u*n_frame] = this->bufferin[n_frame];
-		loadout16[2u*n_frame + 1u] = loadout16[2u*n_frame];
-	}
+	if(this->big_endian) convert_16bit1ch_be_s16_2ch((std::int16_t*) this->loadout_buf, (const std::uint8_t*) this->bufferin, this->BUFFER_SIZE_FRAMES);
+	else convert_16bit1ch_s16_2ch((std::int16_t*) this->loadout_buf, this->bufferin, this->BUFFER_SIZE_FRAMES);
 
 	return;
 }
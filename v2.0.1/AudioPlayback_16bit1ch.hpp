@@ -9,6 +9,7 @@
 #define AUDIOPLAYBACK_16BIT1CH_HPP
 
 #include "AudioPlayback.hpp"
+#include "AudioConvert.hpp"
 
 class AudioPlayback_16bit1ch : public AudioPlayback {
 	public:
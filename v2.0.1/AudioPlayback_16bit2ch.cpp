@@ -9,6 +9,7 @@
 
 AudioPlayback_16bit2ch::AudioPlayback_16bit2ch(audio_playback_params_t *params) : AudioPlayback(params)
 {
+	this->FILEIN_FRAME_SIZE = 4u;
 }
 
 AudioPlayback_16bit2ch::~AudioPlayback_16bit2ch(void)
@@ -20,75 +21,8 @@ AudioPlayback_16bit2ch::~AudioPlayback_16bit2ch(void)
 
 bool AudioPlayback_16bit2ch::audio_hw_init(void)
 {
-	snd_pcm_hw_params_t *hw_params = nullptr;
-	snd_pcm_uframes_t nframes = 0u;
-	int n_ret = 0;
-	std::uint32_t rate = this->sample_rate;
+	if(!this->audio_hw_open(SND_PCM_FORMAT_S16_LE)) return false;
 
-	n_ret = snd_pcm_open(&this->audio_dev, this->audio_dev_desc.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not open audio device.";
-		return false;
-	}
-
-	snd_pcm_hw_params_malloc(&hw_params);
-	snd_pcm_hw_params_any(this->audio_dev, hw_params);
-
-	n_ret = snd_pcm_hw_params_set_access(this->audio_dev, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not set device access.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	n_ret = snd_pcm_hw_params_set_format(this->audio_dev, hw_params, SND_PCM_FORMAT_S16_LE);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not set device format.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	n_ret = snd_pcm_hw_params_set_channels(this->audio_dev, hw_params, 2);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not set device channels.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	n_ret = snd_pcm_hw_params_set_rate_near(this->audio_dev, hw_params, &rate, 0);
-	if((n_ret < 0) || (rate < this->sample_rate))
-	{
-		this->error_msg = "Audio HW Init: could not set device sampling rate.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	n_ret = snd_pcm_hw_params(this->audio_dev, hw_params);
-	if(n_ret < 0)
-	{
-		this->error_msg = "Audio HW Init: could not apply device params.";
-		snd_pcm_hw_params_free(hw_params);
-		snd_pcm_close(this->audio_dev);
-		this->audio_dev = nullptr;
-		return false;
-	}
-
-	snd_pcm_hw_params_get_period_size(hw_params, &nframes, 0);
-	snd_pcm_hw_params_free(hw_params);
-
-	this->BUFFER_SIZE_FRAMES = (size_t) nframes;
 	this->BUFFER_SIZE_SAMPLES = 2u*this->BUFFER_SIZE_FRAMES;
 	this->BUFFER_SIZE_BYTES = 2u*this->BUFFER_SIZE_SAMPLES;
 
@@ -97,11 +31,8 @@ bool AudioPlayback_16bit2ch::audio_hw_init(void)
 
 void AudioPlayback_16bit2ch::buffer_malloc(void)
 {
-	if(this->bufferout_0 == nullptr) this->bufferout_0 = std::malloc(this->BUFFER_SIZE_BYTES);
-	if(this->bufferout_1 == nullptr) this->bufferout_1 = std::malloc(this->BUFFER_SIZE_BYTES);
-
-	memset(this->bufferout_0, 0, this->BUFFER_SIZE_BYTES);
-	memset(this->bufferout_1, 0, this->BUFFER_SIZE_BYTES);
+	if(this->bufferout_0 == nullptr) this->bufferout_0 = this->buffer_acquire(this->BUFFER_SIZE_BYTES);
+	if(this->bufferout_1 == nullptr) this->bufferout_1 = this->buffer_acquire(this->BUFFER_SIZE_BYTES);
 
 	return;
 }
@@ -110,13 +41,13 @@ void AudioPlayback_16bit2ch::buffer_free(void)
 {
 	if(this->bufferout_0 != nullptr)
 	{
-		std::free(this->bufferout_0);
+		this->buffer_release(this->bufferout_0);
 		this->bufferout_0 = nullptr;
 	}
 
 	if(this->bufferout_1 != nullptr)
 	{
-		std::free(this->bufferout_1);
+		this->buffer_release(this->bufferout_1);
 		this->bufferout_1 = nullptr;
 	}
 
@@ -127,17 +58,20 @@ void AudioPlayback_16bit2ch::buffer_free(void)
 
 void AudioPlayback_16bit2ch::buffer_load(void)
 {
-	if(this->filein_pos >= this->audio_data_end)
+	size_t n_read = 0u;
+
+	n_read = this->filein_read(this->loadout_buf, this->BUFFER_SIZE_BYTES);
+	if(n_read == 0u)
 	{
 		this->stop = true;
 		return;
 	}
 
-	memset(this->loadout_buf, 0, this->BUFFER_SIZE_BYTES);
+	//Only the last period is short, the rest of it is silence
+	if(n_read < this->BUFFER_SIZE_BYTES) memset(&((std::uint8_t*) this->loadout_buf)[n_read], 0, this->BUFFER_SIZE_BYTES - n_read);
 
-	__LSEEK(this->filein, this->filein_pos, SEEK_SET);
-	read(this->filein, this->loadout_buf, this->BUFFER_SIZE_BYTES);
-	this->filein_pos += (__offset) this->BUFFER_SIZE_BYTES;
+	//The file layout is the device layout, except for the byte order of RIFX files
+	if(this->big_endian) convert_16bit2ch_be_s16_2ch((std::int16_t*) this->loadout_buf, (const std::uint8_t*) this->loadout_buf, this->BUFFER_SIZE_FRAMES);
 
 	return;
 }
@@ -9,6 +9,7 @@
 #define AUDIOPLAYBACK_16BIT2CH_HPP
 
 #include "AudioPlayback.hpp"
+#include "AudioConvert.hpp"
 
 class AudioPlayback_16bit2ch : public AudioPlayback {
 	public:
@@ -0,0 +1,107 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "AudioPlayback_16bitNch.hpp"
+
+AudioPlayback_16bitNch::AudioPlayback_16bitNch(audio_playback_params_t *params) : AudioPlayback(params)
+{
+	if(params != nullptr) this->n_channels = params->n_channels;
+	this->FILEIN_FRAME_SIZE = 2u*this->n_channels;
+}
+
+AudioPlayback_16bitNch::~AudioPlayback_16bitNch(void)
+{
+	this->filein_close();
+	this->audio_hw_deinit();
+	this->buffer_free();
+}
+
+bool AudioPlayback_16bitNch::audio_hw_init(void)
+{
+	if(!this->channel_matrix_set && !channel_matrix_default(&this->channel_matrix, this->n_channels, 2u))
+	{
+		this->error_msg = "Audio HW Init: unsupported number of channels.";
+		return false;
+	}
+
+	this->channel_matrix_set = true;
+
+	if(this->channel_matrix.in_channels != this->n_channels)
+	{
+		this->error_msg = "Audio HW Init: channel matrix does not match the channels of the file.";
+		return false;
+	}
+
+	this->device_channels = this->channel_matrix.out_channels;
+
+	if(!this->audio_hw_open(SND_PCM_FORMAT_S16_LE)) return false;
+
+	this->BUFFER_SIZE_SAMPLES = this->n_channels*this->BUFFER_SIZE_FRAMES;
+	this->BUFFER_SIZE_BYTES = 2u*this->BUFFER_SIZE_SAMPLES;
+
+	this->AUDIOBUFFER_SIZE_SAMPLES = this->device_channels*this->BUFFER_SIZE_FRAMES;
+	this->AUDIOBUFFER_SIZE_BYTES = 2u*this->AUDIOBUFFER_SIZE_SAMPLES;
+
+	return true;
+}
+
+void AudioPlayback_16bitNch::buffer_malloc(void)
+{
+	//An identity matrix reads straight into the output buffers
+	if((this->bufferin == nullptr) && (this->channel_matrix.kind != CHANNEL_MATRIX_IDENTITY)) this->bufferin = (std::int16_t*) this->buffer_acquire(this->BUFFER_SIZE_BYTES);
+	if(this->bufferout_0 == nullptr) this->bufferout_0 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
+	if(this->bufferout_1 == nullptr) this->bufferout_1 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
+
+	return;
+}
+
+void AudioPlayback_16bitNch::buffer_free(void)
+{
+	if(this->bufferin != nullptr)
+	{
+		this->buffer_release(this->bufferin);
+		this->bufferin = nullptr;
+	}
+
+	if(this->bufferout_0 != nullptr)
+	{
+		this->buffer_release(this->bufferout_0);
+		this->bufferout_0 = nullptr;
+	}
+
+	if(this->bufferout_1 != nullptr)
+	{
+		this->buffer_release(this->bufferout_1);
+		this->bufferout_1 = nullptr;
+	}
+
+	this->loadout_buf = nullptr;
+	this->playout_buf = nullptr;
+	return;
+}
+
+void AudioPlayback_16bitNch::buffer_load(void)
+{
+	std::int16_t *bufferin = (this->bufferin != nullptr) ? this->bufferin : (std::int16_t*) this->loadout_buf;
+	size_t n_read = 0u;
+
+	n_read = this->filein_read(bufferin, this->BUFFER_SIZE_BYTES);
+	if(n_read == 0u)
+	{
+		this->stop = true;
+		return;
+	}
+
+	//Only the last period is short, the rest of it is silence
+	if(n_read < this->BUFFER_SIZE_BYTES) memset(&((std::uint8_t*) bufferin)[n_read], 0, this->BUFFER_SIZE_BYTES - n_read);
+
+	if(this->big_endian) convert_s16_be_s16(bufferin, (const std::uint8_t*) bufferin, this->BUFFER_SIZE_SAMPLES);
+
+	if(bufferin != this->loadout_buf) channel_matrix_apply((std::int16_t*) this->loadout_buf, bufferin, this->BUFFER_SIZE_FRAMES, &this->channel_matrix);
+
+	return;
+}
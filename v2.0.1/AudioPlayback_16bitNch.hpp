@@ -0,0 +1,36 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef AUDIOPLAYBACK_16BITNCH_HPP
+#define AUDIOPLAYBACK_16BITNCH_HPP
+
+#include "AudioPlayback.hpp"
+#include "AudioConvert.hpp"
+#include "ChannelMatrix.hpp"
+
+//16bit PCM with any number of channels, mixed to the device channels through the channel matrix
+class AudioPlayback_16bitNch : public AudioPlayback {
+	public:
+		AudioPlayback_16bitNch(audio_playback_params_t *params);
+		~AudioPlayback_16bitNch(void);
+
+	private:
+		unsigned int n_channels = 0u;
+
+		size_t AUDIOBUFFER_SIZE_SAMPLES = 0u;
+		size_t AUDIOBUFFER_SIZE_BYTES = 0u;
+
+		std::int16_t *bufferin = nullptr;
+
+		bool audio_hw_init(void) override;
+		void buffer_malloc(void) override;
+		void buffer_free(void) override;
+
+		void buffer_load(void) override;
+};
+
+#endif //AUDIOPLAYBACK_16BITNCH_HPP
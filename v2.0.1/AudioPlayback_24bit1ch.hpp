@@ -9,6 +9,7 @@
 #define AUDIOPLAYBACK_24BIT1CH_HPP
 
 #include "AudioPlayback.hpp"
+#include "AudioConvert.hpp"
 
 class AudioPlayback_24bit1ch : public AudioPlayback {
 	public:
@@ -9,6 +9,7 @@
 #define AUDIOPLAYBACK_24BIT2CH_HPP
 
 #include "AudioPlayback.hpp"
+#include "AudioConvert.hpp"
 
 class AudioPlayback_24bit2ch : public AudioPlayback {
 	public:
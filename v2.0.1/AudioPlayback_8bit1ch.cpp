@@ -0,0 +1,85 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "AudioPlayback_8bit1ch.hpp"
+
+AudioPlayback_8bit1ch::AudioPlayback_8bit1ch(audio_playback_params_t *params) : AudioPlayback(params)
+{
+	this->FILEIN_FRAME_SIZE = 1u;
+}
+
+AudioPlayback_8bit1ch::~AudioPlayback_8bit1ch(void)
+{
+	this->filein_close();
+	this->audio_hw_deinit();
+	this->buffer_free();
+}
+
+bool AudioPlayback_8bit1ch::audio_hw_init(void)
+{
+	if(!this->audio_hw_open(SND_PCM_FORMAT_S16_LE)) return false;
+
+	this->BUFFER_SIZE_SAMPLES = this->BUFFER_SIZE_FRAMES;
+	this->BUFFER_SIZE_BYTES = this->BUFFER_SIZE_SAMPLES;
+
+	this->AUDIOBUFFER_SIZE_BYTES = 4u*this->BUFFER_SIZE_FRAMES;
+
+	return true;
+}
+
+void AudioPlayback_8bit1ch::buffer_malloc(void)
+{
+	if(this->bytebuf == nullptr) this->bytebuf = (std::uint8_t*) this->buffer_acquire(this->BUFFER_SIZE_BYTES);
+	if(this->bufferout_0 == nullptr) this->bufferout_0 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
+	if(this->bufferout_1 == nullptr) this->bufferout_1 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
+
+	return;
+}
+
+void AudioPlayback_8bit1ch::buffer_free(void)
+{
+	if(this->bytebuf != nullptr)
+	{
+		this->buffer_release(this->bytebuf);
+		this->bytebuf = nullptr;
+	}
+
+	if(this->bufferout_0 != nullptr)
+	{
+		this->buffer_release(this->bufferout_0);
+		this->bufferout_0 = nullptr;
+	}
+
+	if(this->bufferout_1 != nullptr)
+	{
+		this->buffer_release(this->bufferout_1);
+		this->bufferout_1 = nullptr;
+	}
+
+	this->loadout_buf = nullptr;
+	this->playout_buf = nullptr;
+	return;
+}
+
+void AudioPlayback_8bit1ch::buffer_load(void)
+{
+	size_t n_read = 0u;
+
+	n_read = this->filein_read(this->bytebuf, this->BUFFER_SIZE_BYTES);
+	if(n_read == 0u)
+	{
+		this->stop = true;
+		return;
+	}
+
+	//Only the last period is short, the rest of it is silence (0x80 unsigned)
+	if(n_read < this->BUFFER_SIZE_BYTES) memset(&this->bytebuf[n_read], 0x80, this->BUFFER_SIZE_BYTES - n_read);
+
+	convert_8bit1ch_s16_2ch((std::int16_t*) this->loadout_buf, this->bytebuf, this->BUFFER_SIZE_FRAMES);
+
+	return;
+}
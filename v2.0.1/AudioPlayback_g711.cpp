@@ -0,0 +1,90 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "AudioPlayback_g711.hpp"
+
+AudioPlayback_g711::AudioPlayback_g711(audio_playback_params_t *params, bool alaw) : AudioPlayback(params)
+{
+	this->alaw = alaw;
+	if(params != nullptr) this->n_channels = params->n_channels;
+
+	//One byte per sample
+	this->FILEIN_FRAME_SIZE = this->n_channels;
+}
+
+AudioPlayback_g711::~AudioPlayback_g711(void)
+{
+	this->filein_close();
+	this->audio_hw_deinit();
+	this->buffer_free();
+}
+
+bool AudioPlayback_g711::audio_hw_init(void)
+{
+	if(!this->audio_hw_open(SND_PCM_FORMAT_S16_LE)) return false;
+
+	this->BUFFER_SIZE_SAMPLES = this->n_channels*this->BUFFER_SIZE_FRAMES;
+	this->BUFFER_SIZE_BYTES = this->BUFFER_SIZE_SAMPLES;
+
+	this->AUDIOBUFFER_SIZE_BYTES = 4u*this->BUFFER_SIZE_FRAMES;
+
+	return true;
+}
+
+void AudioPlayback_g711::buffer_malloc(void)
+{
+	if(this->bytebuf == nullptr) this->bytebuf = (std::uint8_t*) this->buffer_acquire(this->BUFFER_SIZE_BYTES);
+	if(this->bufferout_0 == nullptr) this->bufferout_0 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
+	if(this->bufferout_1 == nullptr) this->bufferout_1 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
+
+	return;
+}
+
+void AudioPlayback_g711::buffer_free(void)
+{
+	if(this->bytebuf != nullptr)
+	{
+		this->buffer_release(this->bytebuf);
+		this->bytebuf = nullptr;
+	}
+
+	if(this->bufferout_0 != nullptr)
+	{
+		this->buffer_release(this->bufferout_0);
+		this->bufferout_0 = nullptr;
+	}
+
+	if(this->bufferout_1 != nullptr)
+	{
+		this->buffer_release(this->bufferout_1);
+		this->bufferout_1 = nullptr;
+	}
+
+	this->loadout_buf = nullptr;
+	this->playout_buf = nullptr;
+	return;
+}
+
+void AudioPlayback_g711::buffer_load(void)
+{
+	size_t n_read = 0u;
+
+	n_read = this->filein_read(this->bytebuf, this->BUFFER_SIZE_BYTES);
+	if(n_read == 0u)
+	{
+		this->stop = true;
+		return;
+	}
+
+	//Only the last period is short, the rest of it is silence: 0xd5 in A-law and 0xff in mu-law
+	if(n_read < this->BUFFER_SIZE_BYTES) memset(&this->bytebuf[n_read], (this->alaw) ? 0xd5 : 0xff, this->BUFFER_SIZE_BYTES - n_read);
+
+	if(this->n_channels == 1u) convert_g711_1ch_s16_2ch((std::int16_t*) this->loadout_buf, this->bytebuf, this->BUFFER_SIZE_FRAMES, this->alaw);
+	else convert_g711_2ch_s16_2ch((std::int16_t*) this->loadout_buf, this->bytebuf, this->BUFFER_SIZE_FRAMES, this->alaw);
+
+	return;
+}
@@ -0,0 +1,35 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef AUDIOPLAYBACK_G711_HPP
+#define AUDIOPLAYBACK_G711_HPP
+
+#include "AudioPlayback.hpp"
+#include "AudioConvert.hpp"
+
+//G.711 A-law / mu-law, mono or stereo. Decoded to S16_LE stereo.
+class AudioPlayback_g711 : public AudioPlayback {
+	public:
+		AudioPlayback_g711(audio_playback_params_t *params, bool alaw);
+		~AudioPlayback_g711(void);
+
+	private:
+		bool alaw = false;
+		std::uint16_t n_channels = 0u;
+
+		size_t AUDIOBUFFER_SIZE_BYTES = 0u;
+
+		std::uint8_t *bytebuf = nullptr;
+
+		bool audio_hw_init(void) override;
+		void buffer_malloc(void) override;
+		void buffer_free(void) override;
+
+		void buffer_load(void) override;
+};
+
+#endif //AUDIOPLAYBACK_G711_HPP
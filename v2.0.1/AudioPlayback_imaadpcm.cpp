@@ -0,0 +1,130 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "AudioPlayback_imaadpcm.hpp"
+
+AudioPlayback_imaadpcm::AudioPlayback_imaadpcm(audio_playback_params_t *params) : AudioPlayback(params)
+{
+	if(params == nullptr) return;
+
+	this->n_channels = params->n_channels;
+	this->block_align = params->block_align;
+	this->samples_per_block = params->samples_per_block;
+
+	//FILEIN_FRAME_SIZE stays 0: frames are not byte addressable, so seeking and looping are not available.
+}
+
+AudioPlayback_imaadpcm::~AudioPlayback_imaadpcm(void)
+{
+	this->filein_close();
+	this->audio_hw_deinit();
+	this->buffer_free();
+}
+
+bool AudioPlayback_imaadpcm::audio_hw_init(void)
+{
+	if(!this->audio_hw_open(SND_PCM_FORMAT_S16_LE)) return false;
+
+	this->BUFFER_SIZE_SAMPLES = 2u*this->BUFFER_SIZE_FRAMES;
+	this->BUFFER_SIZE_BYTES = this->block_align;
+
+	this->AUDIOBUFFER_SIZE_BYTES = 2u*this->BUFFER_SIZE_SAMPLES;
+
+	return true;
+}
+
+void AudioPlayback_imaadpcm::buffer_malloc(void)
+{
+	if(this->blockbuf == nullptr) this->blockbuf = (std::uint8_t*) this->buffer_acquire(this->block_align);
+	if(this->decodebuf == nullptr) this->decodebuf = (std::int16_t*) this->buffer_acquire(2u*this->n_channels*this->samples_per_block);
+	if(this->bufferout_0 == nullptr) this->bufferout_0 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
+	if(this->bufferout_1 == nullptr) this->bufferout_1 = this->buffer_acquire(this->AUDIOBUFFER_SIZE_BYTES);
+
+	this->decode_frames = 0u;
+	this->decode_pos = 0u;
+
+	return;
+}
+
+void AudioPlayback_imaadpcm::buffer_free(void)
+{
+	if(this->blockbuf != nullptr)
+	{
+		this->buffer_release(this->blockbuf);
+		this->blockbuf = nullptr;
+	}
+
+	if(this->decodebuf != nullptr)
+	{
+		this->buffer_release(this->decodebuf);
+		this->decodebuf = nullptr;
+	}
+
+	if(this->bufferout_0 != nullptr)
+	{
+		this->buffer_release(this->bufferout_0);
+		this->bufferout_0 = nullptr;
+	}
+
+	if(this->bufferout_1 != nullptr)
+	{
+		this->buffer_release(this->bufferout_1);
+		this->bufferout_1 = nullptr;
+	}
+
+	this->loadout_buf = nullptr;
+	this->playout_buf = nullptr;
+	return;
+}
+
+void AudioPlayback_imaadpcm::buffer_load(void)
+{
+	std::int16_t *loadout16 = (std::int16_t*) this->loadout_buf;
+	size_t n_frame = 0u;
+	size_t n_frames = 0u;
+
+	//A period rarely matches the block size: the decoded block is consumed across periods.
+	while(n_frame < this->BUFFER_SIZE_FRAMES)
+	{
+		if(this->decode_pos >= this->decode_frames)
+		{
+			if(!this->block_decode()) break;
+		}
+
+		n_frames = this->decode_frames - this->decode_pos;
+		if(n_frames > (this->BUFFER_SIZE_FRAMES - n_frame)) n_frames = this->BUFFER_SIZE_FRAMES - n_frame;
+
+		if(this->n_channels == 1u) convert_16bit1ch_s16_2ch(&loadout16[2u*n_frame], &this->decodebuf[this->decode_pos], n_frames);
+		else memcpy(&loadout16[2u*n_frame], &this->decodebuf[2u*this->decode_pos], 4u*n_frames);
+
+		n_frame += n_frames;
+		this->decode_pos += n_frames;
+	}
+
+	if(n_frame == 0u)
+	{
+		this->stop = true;
+		return;
+	}
+
+	if(n_frame < this->BUFFER_SIZE_FRAMES) memset(&loadout16[2u*n_frame], 0, 4u*(this->BUFFER_SIZE_FRAMES - n_frame));
+
+	return;
+}
+
+bool AudioPlayback_imaadpcm::block_decode(void)
+{
+	size_t n_bytes = 0u;
+
+	//The last block may be truncated: the decoder is given the bytes actually read, nothing past them is looked at
+	n_bytes = this->filein_read(this->blockbuf, this->block_align);
+
+	this->decode_frames = decode_imaadpcm_block(this->decodebuf, this->blockbuf, n_bytes, this->n_channels);
+	this->decode_pos = 0u;
+
+	return (this->decode_frames > 0u);
+}
@@ -0,0 +1,41 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef AUDIOPLAYBACK_IMAADPCM_HPP
+#define AUDIOPLAYBACK_IMAADPCM_HPP
+
+#include "AudioPlayback.hpp"
+#include "AudioConvert.hpp"
+
+//IMA ADPCM, mono or stereo. Decoded block by block to S16_LE stereo.
+class AudioPlayback_imaadpcm : public AudioPlayback {
+	public:
+		AudioPlayback_imaadpcm(audio_playback_params_t *params);
+		~AudioPlayback_imaadpcm(void);
+
+	private:
+		std::uint16_t n_channels = 0u;
+		std::uint16_t block_align = 0u;
+		std::uint16_t samples_per_block = 0u;
+
+		size_t AUDIOBUFFER_SIZE_BYTES = 0u;
+
+		std::uint8_t *blockbuf = nullptr;
+		std::int16_t *decodebuf = nullptr;
+
+		size_t decode_frames = 0u;
+		size_t decode_pos = 0u;
+
+		bool audio_hw_init(void) override;
+		void buffer_malloc(void) override;
+		void buffer_free(void) override;
+
+		void buffer_load(void) override;
+		bool block_decode(void);
+};
+
+#endif //AUDIOPLAYBACK_IMAADPCM_HPP
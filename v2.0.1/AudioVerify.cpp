@@ -0,0 +1,497 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "AudioVerify.hpp"
+#include "AudioConvert.hpp"
+#include "WaveHeader.hpp"
+#include <sys/stat.h>
+
+#define HASH64_PRIME_1 0x9e3779b185ebca87ull
+#define HASH64_PRIME_2 0xc2b2ae3d27d4eb4full
+#define HASH64_PRIME_3 0x165667b19e3779f9ull
+#define HASH64_PRIME_4 0x85ebca77c2b2ae63ull
+#define HASH64_PRIME_5 0x27d4eb2f165667c5ull
+
+static inline std::uint64_t hash64_rotl(std::uint64_t value, int n_bits)
+{
+	return (value << n_bits) | (value >> (64 - n_bits));
+}
+
+static inline std::uint64_t hash64_read64(const std::uint8_t *data)
+{
+	std::uint64_t value = 0u;
+
+	memcpy(&value, data, 8);
+	return value;
+}
+
+static inline std::uint32_t hash64_read32(const std::uint8_t *data)
+{
+	std::uint32_t value = 0u;
+
+	memcpy(&value, data, 4);
+	return value;
+}
+
+static inline std::uint64_t hash64_round(std::uint64_t acc, std::uint64_t input)
+{
+	acc += input*HASH64_PRIME_2;
+	acc = hash64_rotl(acc, 31);
+	return acc*HASH64_PRIME_1;
+}
+
+static inline std::uint64_t hash64_merge(std::uint64_t hash, std::uint64_t acc)
+{
+	hash ^= hash64_round(0u, acc);
+	return hash*HASH64_PRIME_1 + HASH64_PRIME_4;
+}
+
+void hash64_reset(hash64_state_t *state, std::uint64_t seed)
+{
+	state->acc[0] = seed + HASH64_PRIME_1 + HASH64_PRIME_2;
+	state->acc[1] = seed + HASH64_PRIME_2;
+	state->acc[2] = seed;
+	state->acc[3] = seed - HASH64_PRIME_1;
+	state->total_len = 0u;
+	state->seed = seed;
+	state->mem_size = 0u;
+	return;
+}
+
+void hash64_update(hash64_state_t *state, const void *data, size_t n_bytes)
+{
+	const std::uint8_t *bytebuf = (const std::uint8_t*) data;
+	const std::uint8_t *bytebuf_end = bytebuf + n_bytes;
+	size_t n_fill = 0u;
+
+	state->total_len += (std::uint64_t) n_bytes;
+
+	if((state->mem_size + n_bytes) < 32u)
+	{
+		memcpy(&state->mem[state->mem_size], bytebuf, n_bytes);
+		state->mem_size += n_bytes;
+		return;
+	}
+
+	if(state->mem_size > 0u)
+	{
+		n_fill = 32u - state->mem_size;
+		memcpy(&state->mem[state->mem_size], bytebuf, n_fill);
+
+		state->acc[0] = hash64_round(state->acc[0], hash64_read64(&state->mem[0]));
+		state->acc[1] = hash64_round(state->acc[1], hash64_read64(&state->mem[8]));
+		state->acc[2] = hash64_round(state->acc[2], hash64_read64(&state->mem[16]));
+		state->acc[3] = hash64_round(state->acc[3], hash64_read64(&state->mem[24]));
+
+		bytebuf += n_fill;
+		state->mem_size = 0u;
+	}
+
+	while((bytebuf_end - bytebuf) >= 32)
+	{
+		state->acc[0] = hash64_round(state->acc[0], hash64_read64(bytebuf));
+		state->acc[1] = hash64_round(state->acc[1], hash64_read64(bytebuf + 8));
+		state->acc[2] = hash64_round(state->acc[2], hash64_read64(bytebuf + 16));
+		state->acc[3] = hash64_round(state->acc[3], hash64_read64(bytebuf + 24));
+		bytebuf += 32;
+	}
+
+	state->mem_size = (size_t) (bytebuf_end - bytebuf);
+	memcpy(state->mem, bytebuf, state->mem_size);
+	return;
+}
+
+std::uint64_t hash64_digest(const hash64_state_t *state)
+{
+	const std::uint8_t *bytebuf = state->mem;
+	const std::uint8_t *bytebuf_end = state->mem + state->mem_size;
+	std::uint64_t hash = 0u;
+
+	if(state->total_len >= 32u)
+	{
+		hash = hash64_rotl(state->acc[0], 1) + hash64_rotl(state->acc[1], 7) + hash64_rotl(state->acc[2], 12) + hash64_rotl(state->acc[3], 18);
+		hash = hash64_merge(hash, state->acc[0]);
+		hash = hash64_merge(hash, state->acc[1]);
+		hash = hash64_merge(hash, state->acc[2]);
+		hash = hash64_merge(hash, state->acc[3]);
+	}
+	else hash = state->seed + HASH64_PRIME_5;
+
+	hash += state->total_len;
+
+	while((bytebuf_end - bytebuf) >= 8)
+	{
+		hash ^= hash64_round(0u, hash64_read64(bytebuf));
+		hash = hash64_rotl(hash, 27)*HASH64_PRIME_1 + HASH64_PRIME_4;
+		bytebuf += 8;
+	}
+
+	if((bytebuf_end - bytebuf) >= 4)
+	{
+		hash ^= ((std::uint64_t) hash64_read32(bytebuf))*HASH64_PRIME_1;
+		hash = hash64_rotl(hash, 23)*HASH64_PRIME_2 + HASH64_PRIME_3;
+		bytebuf += 4;
+	}
+
+	while(bytebuf < bytebuf_end)
+	{
+		hash ^= ((std::uint64_t) *bytebuf)*HASH64_PRIME_5;
+		hash = hash64_rotl(hash, 11)*HASH64_PRIME_1;
+		bytebuf++;
+	}
+
+	hash ^= hash >> 33;
+	hash *= HASH64_PRIME_2;
+	hash ^= hash >> 29;
+	hash *= HASH64_PRIME_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+std::uint64_t hash64(const void *data, size_t n_bytes, std::uint64_t seed)
+{
+	hash64_state_t state;
+
+	hash64_reset(&state, seed);
+	hash64_update(&state, data, n_bytes);
+	return hash64_digest(&state);
+}
+
+std::uint64_t audio_data_frames(const audio_playback_params_t *params, int format)
+{
+	struct stat filein_stat;
+	__offset data_end = params->audio_data_end;
+	__offset data_size = 0;
+	__offset tail_size = 0;
+	std::uint64_t n_frames = 0u;
+
+	if((stat(params->filein_dir, &filein_stat) == 0) && (data_end > (__offset) filein_stat.st_size)) data_end = (__offset) filein_stat.st_size;
+	if((data_end <= params->audio_data_begin) || (params->block_align == 0u)) return 0u;
+
+	data_size = data_end - params->audio_data_begin;
+
+	if(format != PB_IMAADPCM) return (std::uint64_t) (data_size/((__offset) params->block_align));
+
+	n_frames = ((std::uint64_t) (data_size/((__offset) params->block_align)))*params->samples_per_block;
+	tail_size = data_size%((__offset) params->block_align);
+
+	//A truncated last block still decodes its header sample plus every complete group of 8 samples
+	if(tail_size >= (__offset) (4u*params->n_channels)) n_frames += 8u*((std::uint64_t) ((tail_size - 4*params->n_channels)/(4*params->n_channels))) + 1u;
+
+	return n_frames;
+}
+
+void audio_verify_init(audio_verify_t *verify, std::uint64_t data_frames)
+{
+	verify->data_frames = data_frames;
+	verify->frame_size = 0u;
+	verify->period_frames = 0u;
+	verify->period_hash.clear();
+	hash64_reset(&verify->data_hash, 0u);
+	verify->frames_written = 0u;
+	verify->short_periods = 0u;
+	verify->padding_frames = 0u;
+	verify->padding_loud_frames = 0u;
+	return;
+}
+
+void audio_verify_setup(audio_verify_t *verify, size_t frame_size, size_t period_frames)
+{
+	verify->frame_size = frame_size;
+	verify->period_frames = period_frames;
+
+	//Reserved up front, so recording a period never allocates
+	if(period_frames > 0u) verify->period_hash.reserve((size_t) (verify->data_frames/period_frames) + 2u);
+
+	return;
+}
+
+void audio_verify_period(audio_verify_t *verify, const void *buf, size_t n_written, size_t n_frames)
+{
+	const std::uint8_t *bytebuf = (const std::uint8_t*) buf;
+	size_t n_data = n_written;
+	size_t n_frame = 0u;
+	size_t n_byte = 0u;
+
+	if(verify->frames_written >= verify->data_frames) n_data = 0u;
+	else if((verify->data_frames - verify->frames_written) < (std::uint64_t) n_data) n_data = (size_t) (verify->data_frames - verify->frames_written);
+
+	if(n_written < n_frames) verify->short_periods++;
+
+	if(n_data > 0u)
+	{
+		verify->period_hash.push_back(hash64(bytebuf, n_data*verify->frame_size, 0u));
+		hash64_update(&verify->data_hash, bytebuf, n_data*verify->frame_size);
+	}
+
+	for(n_frame = n_data; n_frame < n_written; n_frame++)
+	{
+		for(n_byte = 0u; n_byte < verify->frame_size; n_byte++)
+		{
+			if(bytebuf[n_frame*verify->frame_size + n_byte] == 0u) continue;
+
+			verify->padding_loud_frames++;
+			break;
+		}
+	}
+
+	verify->padding_frames += (std::uint64_t) (n_written - n_data);
+	verify->frames_written += (std::uint64_t) n_written;
+	return;
+}
+
+static inline std::int32_t reference_s24(const std::uint8_t *in)
+{
+	return ((std::int32_t) (((std::uint32_t) in[0] << 8) | ((std::uint32_t) in[1] << 16) | ((std::uint32_t) in[2] << 24))) >> 8;
+}
+
+//RIFX file: reverses the bytes of every 16bit or 24bit sample, so reference_convert reads little-endian samples
+static void reference_swap(std::uint8_t *in, size_t n_bytes, int format)
+{
+	std::uint8_t byte = 0u;
+	size_t n_byte = 0u;
+
+	if((format == PB_16BIT1CH) || (format == PB_16BIT2CH) || (format == PB_16BITNCH))
+	{
+		for(n_byte = 0u; (n_byte + 2u) <= n_bytes; n_byte += 2u)
+		{
+			byte = in[n_byte];
+			in[n_byte] = in[n_byte + 1u];
+			in[n_byte + 1u] = byte;
+		}
+	}
+	else if((format == PB_24BIT1CH) || (format == PB_24BIT2CH))
+	{
+		for(n_byte = 0u; (n_byte + 3u) <= n_bytes; n_byte += 3u)
+		{
+			byte = in[n_byte];
+			in[n_byte] = in[n_byte + 2u];
+			in[n_byte + 2u] = byte;
+		}
+	}
+
+	return;
+}
+
+//Plain per-sample conversion of n_frames frames into device format, kept independent from the SIMD kernels
+static void reference_convert(void *out, const std::uint8_t *in, size_t n_frames, int format, const channel_matrix_t *matrix)
+{
+	std::int16_t *out16 = (std::int16_t*) out;
+	std::int32_t *out32 = (std::int32_t*) out;
+	std::int64_t acc = 0;
+	size_t n_frame = 0u;
+	unsigned int n_out = 0u;
+	unsigned int n_in = 0u;
+
+	for(n_frame = 0u; n_frame < n_frames; n_frame++)
+	{
+		switch(format)
+		{
+			case PB_8BIT1CH:
+				out16[2u*n_frame] = (std::int16_t) ((in[n_frame] - 128) << 8);
+				out16[2u*n_frame + 1u] = out16[2u*n_frame];
+				break;
+
+			case PB_8BIT2CH:
+				out16[2u*n_frame] = (std::int16_t) ((in[2u*n_frame] - 128) << 8);
+				out16[2u*n_frame + 1u] = (std::int16_t) ((in[2u*n_frame + 1u] - 128) << 8);
+				break;
+
+			case PB_16BIT1CH:
+				out16[2u*n_frame] = (std::int16_t) (in[2u*n_frame] | (in[2u*n_frame + 1u] << 8));
+				out16[2u*n_frame + 1u] = out16[2u*n_frame];
+				break;
+
+			case PB_16BIT2CH:
+				out16[2u*n_frame] = (std::int16_t) (in[4u*n_frame] | (in[4u*n_frame + 1u] << 8));
+				out16[2u*n_frame + 1u] = (std::int16_t) (in[4u*n_frame + 2u] | (in[4u*n_frame + 3u] << 8));
+				break;
+
+			case PB_24BIT1CH:
+				out32[2u*n_frame] = reference_s24(&in[3u*n_frame]);
+				out32[2u*n_frame + 1u] = out32[2u*n_frame];
+				break;
+
+			case PB_24BIT2CH:
+				out32[2u*n_frame] = reference_s24(&in[6u*n_frame]);
+				out32[2u*n_frame + 1u] = reference_s24(&in[6u*n_frame + 3u]);
+				break;
+
+			case PB_16BITNCH:
+				for(n_out = 0u; n_out < matrix->out_channels; n_out++)
+				{
+					acc = 0;
+
+					for(n_in = 0u; n_in < matrix->in_channels; n_in++)
+					{
+						const std::uint8_t *sample = &in[2u*(n_frame*matrix->in_channels + n_in)];
+						acc += ((std::int64_t) (std::int16_t) (sample[0] | (sample[1] << 8)))*matrix->gain[n_out][n_in];
+					}
+
+					acc = (acc + 0x2000) >> 14;
+					if(acc > 32767) acc = 32767;
+					if(acc < -32768) acc = -32768;
+
+					out16[n_frame*matrix->out_channels + n_out] = (std::int16_t) acc;
+				}
+				break;
+		}
+	}
+
+	return;
+}
+
+bool audio_verify_reference(const audio_playback_params_t *params, int format, const channel_matrix_t *matrix, size_t period_frames, audio_verify_reference_t *reference)
+{
+	std::vector<std::uint8_t> bytebuf;
+	std::vector<std::uint8_t> outbuf;
+	std::vector<std::int16_t> decodebuf;
+	hash64_state_t data_hash;
+	const std::int16_t *g711 = nullptr;
+	std::uint64_t frames_left = 0u;
+	size_t in_frame_size = 0u;
+	size_t out_frame_size = 4u;
+	size_t n_frames = 0u;
+	size_t n_frame = 0u;
+	size_t decode_frames = 0u;
+	size_t decode_pos = 0u;
+	__offset filein_pos = 0;
+	int fd = -1;
+
+	if((params == nullptr) || (reference == nullptr) || (period_frames == 0u)) return false;
+	if((format == PB_16BITNCH) && ((matrix == nullptr) || (matrix->in_channels != params->n_channels))) return false;
+
+	in_frame_size = (size_t) params->block_align;
+	filein_pos = params->audio_data_begin;
+
+	fd = open(params->filein_dir, O_RDONLY);
+	if(fd < 0) return false;
+
+	if((format == PB_24BIT1CH) || (format == PB_24BIT2CH)) out_frame_size = 8u;
+	if(format == PB_16BITNCH) out_frame_size = 2u*matrix->out_channels;
+	if((format == PB_G711ALAW) || (format == PB_G711ULAW)) g711 = g711_table(format == PB_G711ALAW);
+
+	reference->data_frames = audio_data_frames(params, format);
+	reference->period_hash.clear();
+	hash64_reset(&data_hash, 0u);
+
+	if(format == PB_IMAADPCM)
+	{
+		bytebuf.resize(params->block_align);
+		decodebuf.resize(((size_t) params->samples_per_block)*params->n_channels);
+	}
+	else bytebuf.resize(period_frames*in_frame_size);
+
+	outbuf.resize(period_frames*out_frame_size);
+	frames_left = reference->data_frames;
+
+	while(frames_left > 0u)
+	{
+		n_frames = period_frames;
+		if(frames_left < (std::uint64_t) n_frames) n_frames = (size_t) frames_left;
+
+		if(format == PB_IMAADPCM)
+		{
+			std::int16_t *out16 = (std::int16_t*) outbuf.data();
+
+			for(n_frame = 0u; n_frame < n_frames; n_frame++)
+			{
+				if(decode_pos >= decode_frames)
+				{
+					ssize_t n_read = __PREAD(fd, bytebuf.data(), params->block_align, filein_pos);
+					if(n_read < 0) n_read = 0;
+
+					filein_pos += (__offset) params->block_align;
+					decode_frames = decode_imaadpcm_block(decodebuf.data(), bytebuf.data(), (size_t) n_read, params->n_channels);
+					decode_pos = 0u;
+				}
+
+				out16[2u*n_frame] = decodebuf[decode_pos*params->n_channels];
+				out16[2u*n_frame + 1u] = decodebuf[decode_pos*params->n_channels + params->n_channels - 1u];
+				decode_pos++;
+			}
+		}
+		else
+		{
+			__PREAD(fd, bytebuf.data(), n_frames*in_frame_size, filein_pos);
+			filein_pos += (__offset) (n_frames*in_frame_size);
+
+			if(g711 != nullptr)
+			{
+				std::int16_t *out16 = (std::int16_t*) outbuf.data();
+
+				for(n_frame = 0u; n_frame < n_frames; n_frame++)
+				{
+					out16[2u*n_frame] = g711[bytebuf[n_frame*in_frame_size]];
+					out16[2u*n_frame + 1u] = g711[bytebuf[n_frame*in_frame_size + in_frame_size - 1u]];
+				}
+			}
+			else
+			{
+				if(params->big_endian) reference_swap(bytebuf.data(), n_frames*in_frame_size, format);
+				reference_convert(outbuf.data(), bytebuf.data(), n_frames, format, matrix);
+			}
+		}
+
+		reference->period_hash.push_back(hash64(outbuf.data(), n_frames*out_frame_size, 0u));
+		hash64_update(&data_hash, outbuf.data(), n_frames*out_frame_size);
+
+		frames_left -= (std::uint64_t) n_frames;
+	}
+
+	close(fd);
+
+	reference->data_hash = hash64_digest(&data_hash);
+	return true;
+}
+
+bool audio_verify_report(const audio_verify_t *verify, const audio_verify_reference_t *reference, std::FILE *stream)
+{
+	std::uint64_t data_hash = hash64_digest(&verify->data_hash);
+	std::uint64_t data_frames = verify->frames_written - verify->padding_frames;
+	size_t n_period = 0u;
+	size_t n_periods = verify->period_hash.size();
+	bool ok = true;
+
+	std::fprintf(stream, "Verify: %llu frames written, %llu periods of %llu frames\n", (unsigned long long) verify->frames_written,
+		(unsigned long long) ((verify->period_frames > 0u) ? ((verify->frames_written + verify->period_frames - 1u)/verify->period_frames) : 0u),
+		(unsigned long long) verify->period_frames);
+
+	std::fprintf(stream, "  audio data: %llu of %llu frames, hash %016llx, reference %016llx\n", (unsigned long long) data_frames, (unsigned long long) reference->data_frames,
+		(unsigned long long) data_hash, (unsigned long long) reference->data_hash);
+
+	if((data_frames != reference->data_frames) || (data_hash != reference->data_hash)) ok = false;
+
+	if(reference->period_hash.size() < n_periods) n_periods = reference->period_hash.size();
+
+	for(n_period = 0u; n_period < n_periods; n_period++)
+	{
+		if(verify->period_hash[n_period] == reference->period_hash[n_period]) continue;
+
+		std::fprintf(stream, "  first mismatching period: %llu (frame %llu)\n", (unsigned long long) n_period, (unsigned long long) (n_period*verify->period_frames));
+		ok = false;
+		break;
+	}
+
+	if(verify->period_hash.size() != reference->period_hash.size())
+	{
+		std::fprintf(stream, "  periods with audio data: %llu, reference %llu\n", (unsigned long long) verify->period_hash.size(), (unsigned long long) reference->period_hash.size());
+		ok = false;
+	}
+
+	if(verify->short_periods > 0u)
+	{
+		std::fprintf(stream, "  periods not fully written: %llu\n", (unsigned long long) verify->short_periods);
+		ok = false;
+	}
+
+	std::fprintf(stream, "  padding at EOF: %llu frames, %llu not silent\n", (unsigned long long) verify->padding_frames, (unsigned long long) verify->padding_loud_frames);
+	std::fprintf(stream, "  result: %s\n", ok ? "bit-exact" : "MISMATCH");
+
+	return ok;
+}
@@ -0,0 +1,82 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef AUDIOVERIFY_HPP
+#define AUDIOVERIFY_HPP
+
+#include "globaldef.h"
+#include "AudioPlayback.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/*
+ * 64bit streaming hash, XXH64 algorithm (same results as the reference xxHash implementation).
+ */
+
+struct hash64_state {
+	std::uint64_t acc[4];
+	std::uint64_t total_len;
+	std::uint64_t seed;
+	std::uint8_t mem[32];
+	size_t mem_size;
+};
+
+typedef struct hash64_state hash64_state_t;
+
+void hash64_reset(hash64_state_t *state, std::uint64_t seed);
+void hash64_update(hash64_state_t *state, const void *data, size_t n_bytes);
+std::uint64_t hash64_digest(const hash64_state_t *state);
+std::uint64_t hash64(const void *data, size_t n_bytes, std::uint64_t seed);
+
+/*
+ * Bit-exact verification of the audio handed to the device.
+ * The playback thread hashes every period after it has been written, counting only the frames the device accepted.
+ * Frames past the end of the audio data (EOF padding) are counted and checked for silence, but kept out of the hashes.
+ * The result is then compared with a scalar reference conversion of the source file, using the same period size.
+ */
+
+struct audio_verify {
+	std::uint64_t data_frames; //Frames of audio data in the source file
+
+	size_t frame_size; //Device frame size in bytes
+	size_t period_frames;
+
+	std::vector<std::uint64_t> period_hash; //Hash of the audio data frames written in every period
+	hash64_state_t data_hash;
+
+	std::uint64_t frames_written;
+	std::uint64_t short_periods; //Periods the device did not take in full
+	std::uint64_t padding_frames;
+	std::uint64_t padding_loud_frames; //Padding frames that are not silence
+};
+
+typedef struct audio_verify audio_verify_t;
+
+struct audio_verify_reference {
+	std::vector<std::uint64_t> period_hash;
+	std::uint64_t data_hash;
+	std::uint64_t data_frames;
+};
+
+typedef struct audio_verify_reference audio_verify_reference_t;
+
+//Frames of audio data in the file, as every format decodes them. The data end is clamped to the file size.
+std::uint64_t audio_data_frames(const audio_playback_params_t *params, int format);
+
+void audio_verify_init(audio_verify_t *verify, std::uint64_t data_frames);
+//Called by the playback thread once the device is set up, before the first period
+void audio_verify_setup(audio_verify_t *verify, size_t frame_size, size_t period_frames);
+//Called by the playback thread after every period: n_written of the n_frames frames in buf were accepted
+void audio_verify_period(audio_verify_t *verify, const void *buf, size_t n_written, size_t n_frames);
+
+//matrix: the channel matrix played, PB_16BITNCH only (nullptr otherwise)
+bool audio_verify_reference(const audio_playback_params_t *params, int format, const channel_matrix_t *matrix, size_t period_frames, audio_verify_reference_t *reference);
+//Prints the comparison and returns true if the output matched the reference bit for bit, with no short periods
+bool audio_verify_report(const audio_verify_t *verify, const audio_verify_reference_t *reference, std::FILE *stream);
+
+#endif //AUDIOVERIFY_HPP
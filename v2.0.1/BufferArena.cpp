@@ -0,0 +1,142 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "BufferArena.hpp"
+#include <cstdlib>
+#include <sys/mman.h>
+
+BufferArena::BufferArena(size_t keep_bytes)
+{
+	this->keep_bytes = keep_bytes;
+}
+
+BufferArena::~BufferArena(void)
+{
+	this->trim();
+}
+
+void *BufferArena::acquire(size_t n_bytes)
+{
+	std::multimap<size_t, void*>::iterator free_buf;
+	void *buf = nullptr;
+	size_t size = 0u;
+
+	if(n_bytes == 0u) n_bytes = 1u;
+
+	if(n_bytes >= BUFFER_ARENA_HUGEPAGE_SIZE) size = (n_bytes + BUFFER_ARENA_HUGEPAGE_SIZE - 1u) & ~((size_t) (BUFFER_ARENA_HUGEPAGE_SIZE - 1u));
+	else size = (n_bytes + BUFFER_ARENA_ALIGN - 1u) & ~((size_t) (BUFFER_ARENA_ALIGN - 1u));
+
+	{
+		std::lock_guard<std::mutex> lock(this->arena_mutex);
+
+		//Smallest kept buffer that fits, unless it would waste more than the request itself
+		free_buf = this->free_bufs.lower_bound(size);
+
+		if((free_buf != this->free_bufs.end()) && (free_buf->first <= 2u*size))
+		{
+			buf = free_buf->second;
+			size = free_buf->first;
+
+			this->free_bufs.erase(free_buf);
+			this->kept_bytes -= size;
+			this->in_use_bytes += size;
+			return buf;
+		}
+	}
+
+	//Allocated and touched outside the lock
+	buf = this->buffer_alloc(size);
+	if(buf == nullptr) return nullptr;
+
+	std::lock_guard<std::mutex> lock(this->arena_mutex);
+	this->buf_size[buf] = size;
+	this->in_use_bytes += size;
+	return buf;
+}
+
+void BufferArena::release(void *buf)
+{
+	std::unordered_map<void*, size_t>::iterator buf_entry;
+	size_t size = 0u;
+
+	if(buf == nullptr) return;
+
+	{
+		std::lock_guard<std::mutex> lock(this->arena_mutex);
+
+		buf_entry = this->buf_size.find(buf);
+		if(buf_entry == this->buf_size.end()) return;
+
+		size = buf_entry->second;
+		this->in_use_bytes -= size;
+
+		if((this->kept_bytes + size) <= this->keep_bytes)
+		{
+			this->free_bufs.insert(std::make_pair(size, buf));
+			this->kept_bytes += size;
+			return;
+		}
+
+		this->buf_size.erase(buf_entry);
+	}
+
+	std::free(buf);
+	return;
+}
+
+void BufferArena::trim(void)
+{
+	std::multimap<size_t, void*>::iterator free_buf;
+
+	std::lock_guard<std::mutex> lock(this->arena_mutex);
+
+	for(free_buf = this->free_bufs.begin(); free_buf != this->free_bufs.end(); free_buf++)
+	{
+		this->buf_size.erase(free_buf->second);
+		std::free(free_buf->second);
+	}
+
+	this->free_bufs.clear();
+	this->kept_bytes = 0u;
+	return;
+}
+
+size_t BufferArena::getKeptBytes(void)
+{
+	std::lock_guard<std::mutex> lock(this->arena_mutex);
+	return this->kept_bytes;
+}
+
+size_t BufferArena::getInUseBytes(void)
+{
+	std::lock_guard<std::mutex> lock(this->arena_mutex);
+	return this->in_use_bytes;
+}
+
+void *BufferArena::buffer_alloc(size_t n_bytes)
+{
+	void *buf = nullptr;
+	size_t align = (n_bytes >= BUFFER_ARENA_HUGEPAGE_SIZE) ? BUFFER_ARENA_HUGEPAGE_SIZE : BUFFER_ARENA_ALIGN;
+
+	if(posix_memalign(&buf, align, n_bytes) != 0) return nullptr;
+
+#ifdef MADV_HUGEPAGE
+	//Only a hint: without THP the buffer is still valid, just backed by small pages
+	if(align == BUFFER_ARENA_HUGEPAGE_SIZE) madvise(buf, n_bytes, MADV_HUGEPAGE);
+#endif
+
+	//Faults every page in now, instead of in the middle of playback
+	memset(buf, 0, n_bytes);
+	return buf;
+}
+
+BufferArena *buffer_arena(void)
+{
+	//Never destroyed, so it outlives any playback object released during exit
+	static BufferArena *arena = new BufferArena(BUFFER_ARENA_KEEP_BYTES);
+	return arena;
+}
@@ -0,0 +1,60 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef BUFFERARENA_HPP
+#define BUFFERARENA_HPP
+
+#include "globaldef.h"
+#include <mutex>
+#include <map>
+#include <unordered_map>
+
+/*
+ * Pool of period buffers, shared by every playback object in the process.
+ * Buffers are 64 byte aligned (one cache line, enough for any SIMD load or store). Buffers of 2MiB or more are
+ * 2MiB aligned and backed by transparent huge pages where the kernel allows it.
+ * Every page of a new buffer is touched when it is allocated, and released buffers are kept for reuse, so a new run
+ * or a new file gets its buffers with no malloc and no page faults. Reused buffers are NOT cleared.
+ */
+
+#define BUFFER_ARENA_ALIGN 64u
+#define BUFFER_ARENA_HUGEPAGE_SIZE 0x200000u
+#define BUFFER_ARENA_KEEP_BYTES (64u << 20)
+
+class BufferArena {
+	public:
+		//keep_bytes: most memory kept in released buffers, anything over it goes back to the system
+		BufferArena(size_t keep_bytes);
+		~BufferArena(void);
+
+		//Returns nullptr if out of memory
+		void *acquire(size_t n_bytes);
+		//nullptr is ignored
+		void release(void *buf);
+		//Frees every kept buffer
+		void trim(void);
+
+		size_t getKeptBytes(void);
+		size_t getInUseBytes(void);
+
+	private:
+		std::mutex arena_mutex;
+
+		std::multimap<size_t, void*> free_bufs; //Kept buffers by size
+		std::unordered_map<void*, size_t> buf_size; //Size of every buffer handed out
+
+		size_t keep_bytes = BUFFER_ARENA_KEEP_BYTES;
+		size_t kept_bytes = 0u;
+		size_t in_use_bytes = 0u;
+
+		void *buffer_alloc(size_t n_bytes);
+};
+
+//The arena used by playback objects that were not given one
+BufferArena *buffer_arena(void);
+
+#endif //BUFFERARENA_HPP
@@ -0,0 +1,394 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "ChannelMatrix.hpp"
+#include <cstdlib>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Speakers of a file with n channels, in WAVE order (the default channel masks):
+ * L/R front, C center, F LFE, S back center, l/r surround or back.
+ */
+static const char *const WAVE_SPEAKERS[CHANNEL_MATRIX_MAX_CHANNELS + 1u] = {"", "C", "LR", "LRC", "LRlr", "LRClr", "LRCFlr", "LRCFSlr", "LRCFlrlr"};
+
+static void matrix_duplicate(std::int16_t *out, const std::int16_t *in, size_t n_frames, const channel_matrix_t *matrix);
+static void matrix_downmix(std::int16_t *out, const std::int16_t *in, size_t n_frames, const channel_matrix_t *matrix);
+static void matrix_mix(std::int16_t *out, const std::int16_t *in, size_t n_frames, const channel_matrix_t *matrix);
+
+static inline std::int16_t matrix_sample(const std::int16_t *frame, const std::int16_t *row, unsigned int n_channels)
+{
+	std::int32_t acc = 0;
+	unsigned int n_channel = 0u;
+
+	for(n_channel = 0u; n_channel < n_channels; n_channel++) acc += frame[n_channel]*row[n_channel];
+
+	acc = (acc + 0x2000) >> 14;
+
+	if(acc > 32767) return 32767;
+	if(acc < -32768) return -32768;
+	return (std::int16_t) acc;
+}
+
+#if defined(__SSE2__)
+//One frame (8 samples, gains past the frame are zero) times one row: four partial sums
+static inline __m128i matrix_madd_sse2(__m128i frame, const std::int16_t *row)
+{
+	return _mm_madd_epi16(frame, _mm_load_si128((const __m128i*) row));
+}
+
+//Reduces four sets of partial sums, one sum per 32bit lane in order
+static inline __m128i matrix_sum4_sse2(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+	__m128i ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+	__m128i cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+
+	return _mm_add_epi32(_mm_unpacklo_epi64(ab, cd), _mm_unpackhi_epi64(ab, cd));
+}
+
+//Rounds, shifts and saturates four sums into four S16 samples, in the low 64 bits
+static inline __m128i matrix_pack_sse2(__m128i sums)
+{
+	sums = _mm_srai_epi32(_mm_add_epi32(sums, _mm_set1_epi32(0x2000)), 14);
+
+	return _mm_packs_epi32(sums, sums);
+}
+#endif
+
+bool channel_matrix_default(channel_matrix_t *matrix, unsigned int in_channels, unsigned int out_channels)
+{
+	const char *speakers = nullptr;
+	double left[CHANNEL_MATRIX_MAX_CHANNELS];
+	double right[CHANNEL_MATRIX_MAX_CHANNELS];
+	double left_sum = 0.0;
+	double right_sum = 0.0;
+	unsigned int n_in = 0u;
+	unsigned int n_out = 0u;
+	unsigned int n_fold = 0u;
+
+	if(matrix == nullptr) return false;
+	if((in_channels == 0u) || (in_channels > CHANNEL_MATRIX_MAX_CHANNELS)) return false;
+	if((out_channels == 0u) || (out_channels > CHANNEL_MATRIX_MAX_CHANNELS)) return false;
+
+	memset(matrix, 0, sizeof(channel_matrix_t));
+	matrix->in_channels = in_channels;
+	matrix->out_channels = out_channels;
+
+	if((in_channels <= out_channels) || (in_channels == 1u))
+	{
+		//Identity, mono duplicated, or the inputs repeated over the outputs
+		for(n_out = 0u; n_out < out_channels; n_out++) matrix->gain[n_out][n_out%in_channels] = CHANNEL_MATRIX_UNITY;
+	}
+	else if((out_channels == 2u) && (in_channels >= 3u))
+	{
+		speakers = WAVE_SPEAKERS[in_channels];
+
+		for(n_in = 0u; n_in < in_channels; n_in++)
+		{
+			left[n_in] = 0.0;
+			right[n_in] = 0.0;
+
+			switch(speakers[n_in])
+			{
+				case 'L':
+					left[n_in] = 1.0;
+					break;
+
+				case 'R':
+					right[n_in] = 1.0;
+					break;
+
+				case 'C':
+					left[n_in] = M_SQRT1_2;
+					right[n_in] = M_SQRT1_2;
+					break;
+
+				case 'S':
+					left[n_in] = 0.5;
+					right[n_in] = 0.5;
+					break;
+
+				case 'l':
+					left[n_in] = M_SQRT1_2;
+					break;
+
+				case 'r':
+					right[n_in] = M_SQRT1_2;
+					break;
+			}
+
+			left_sum += left[n_in];
+			right_sum += right[n_in];
+		}
+
+		//Everything at full scale in phase adds up to full scale
+		for(n_in = 0u; n_in < in_channels; n_in++)
+		{
+			matrix->gain[0][n_in] = (std::int16_t) std::lrint(CHANNEL_MATRIX_UNITY*left[n_in]/left_sum);
+			matrix->gain[1][n_in] = (std::int16_t) std::lrint(CHANNEL_MATRIX_UNITY*right[n_in]/right_sum);
+		}
+	}
+	else
+	{
+		//Inputs fold onto outputs in order, each output the average of its inputs
+		for(n_out = 0u; n_out < out_channels; n_out++)
+		{
+			n_fold = (in_channels - n_out + out_channels - 1u)/out_channels;
+
+			for(n_in = n_out; n_in < in_channels; n_in += out_channels) matrix->gain[n_out][n_in] = (std::int16_t) (CHANNEL_MATRIX_UNITY/n_fold);
+		}
+	}
+
+	channel_matrix_classify(matrix);
+	return true;
+}
+
+bool channel_matrix_parse(channel_matrix_t *matrix, const char *arg)
+{
+	const char *pos = arg;
+	char *endptr = nullptr;
+	float gain = 0.0f;
+	long gain_q14 = 0;
+	long row_sum = 0;
+	unsigned int n_in = 0u;
+	unsigned int n_out = 0u;
+	unsigned int n_col = 0u;
+
+	if((matrix == nullptr) || (arg == nullptr)) return false;
+
+	memset(matrix, 0, sizeof(channel_matrix_t));
+
+	while(true)
+	{
+		if(n_out >= CHANNEL_MATRIX_MAX_CHANNELS) return false;
+
+		n_col = 0u;
+		row_sum = 0;
+
+		while(true)
+		{
+			if(n_col >= CHANNEL_MATRIX_MAX_CHANNELS) return false;
+
+			gain = std::strtof(pos, &endptr);
+			if(endptr == pos) return false;
+			if(!std::isfinite(gain) || (gain < -2.0f) || (gain > 2.0f)) return false;
+
+			//The row sum takes 2.0 as it is, only the stored gain is clamped to Q14
+			gain_q14 = std::lrint(gain*CHANNEL_MATRIX_UNITY);
+			row_sum += std::labs(gain_q14);
+			if(gain_q14 > 32767) gain_q14 = 32767;
+
+			matrix->gain[n_out][n_col] = (std::int16_t) gain_q14;
+			n_col++;
+
+			pos = endptr;
+			if(*pos != ',') break;
+			pos++;
+		}
+
+		if(row_sum > CHANNEL_MATRIX_ROW_MAX) return false;
+
+		if(n_out == 0u) n_in = n_col;
+		else if(n_col != n_in) return false;
+
+		n_out++;
+
+		if(*pos == '\0') break;
+		if(*pos != ';') return false;
+		pos++;
+	}
+
+	matrix->in_channels = n_in;
+	matrix->out_channels = n_out;
+	channel_matrix_classify(matrix);
+	return true;
+}
+
+void channel_matrix_classify(channel_matrix_t *matrix)
+{
+	unsigned int n_in = 0u;
+	unsigned int n_out = 0u;
+	unsigned int n_gains = 0u;
+	bool route = true;
+	bool identity = (matrix->in_channels == matrix->out_channels);
+
+	for(n_out = 0u; n_out < matrix->out_channels; n_out++)
+	{
+		n_gains = 0u;
+
+		for(n_in = 0u; n_in < matrix->in_channels; n_in++)
+		{
+			if(matrix->gain[n_out][n_in] == 0) continue;
+
+			n_gains++;
+			matrix->route[n_out] = (std::uint8_t) n_in;
+		}
+
+		if((n_gains != 1u) || (matrix->gain[n_out][matrix->route[n_out]] != CHANNEL_MATRIX_UNITY)) route = false;
+		else if(matrix->route[n_out] != n_out) identity = false;
+	}
+
+	if(route && identity) matrix->kind = CHANNEL_MATRIX_IDENTITY;
+	else if(route) matrix->kind = CHANNEL_MATRIX_DUPLICATE;
+	else if(matrix->out_channels == 2u) matrix->kind = CHANNEL_MATRIX_DOWNMIX;
+	else matrix->kind = CHANNEL_MATRIX_MIX;
+
+	return;
+}
+
+void channel_matrix_apply(std::int16_t *out, const std::int16_t *in, size_t n_frames, const channel_matrix_t *matrix)
+{
+	switch(matrix->kind)
+	{
+		case CHANNEL_MATRIX_IDENTITY:
+			memcpy(out, in, 2u*n_frames*matrix->in_channels);
+			return;
+
+		case CHANNEL_MATRIX_DUPLICATE:
+			matrix_duplicate(out, in, n_frames, matrix);
+			return;
+
+		case CHANNEL_MATRIX_DOWNMIX:
+			matrix_downmix(out, in, n_frames, matrix);
+			return;
+	}
+
+	matrix_mix(out, in, n_frames, matrix);
+	return;
+}
+
+static void matrix_duplicate(std::int16_t *out, const std::int16_t *in, size_t n_frames, const channel_matrix_t *matrix)
+{
+	const unsigned int in_channels = matrix->in_channels;
+	const unsigned int out_channels = matrix->out_channels;
+	size_t n_frame = 0u;
+	unsigned int n_out = 0u;
+
+#if defined(__SSE2__)
+	__m128i samples;
+	__m128i lo;
+	__m128i hi;
+
+	if((in_channels == 1u) && (out_channels == 2u))
+	{
+		for(n_frame = 0u; (n_frame + 8u) <= n_frames; n_frame += 8u)
+		{
+			samples = _mm_loadu_si128((const __m128i*) &in[n_frame]);
+
+			_mm_storeu_si128((__m128i*) &out[2u*n_frame], _mm_unpacklo_epi16(samples, samples));
+			_mm_storeu_si128((__m128i*) &out[2u*n_frame + 8u], _mm_unpackhi_epi16(samples, samples));
+		}
+	}
+	else if((in_channels == 1u) && (out_channels == 4u))
+	{
+		for(n_frame = 0u; (n_frame + 8u) <= n_frames; n_frame += 8u)
+		{
+			samples = _mm_loadu_si128((const __m128i*) &in[n_frame]);
+			lo = _mm_unpacklo_epi16(samples, samples);
+			hi = _mm_unpackhi_epi16(samples, samples);
+
+			_mm_storeu_si128((__m128i*) &out[4u*n_frame], _mm_unpacklo_epi32(lo, lo));
+			_mm_storeu_si128((__m128i*) &out[4u*n_frame + 8u], _mm_unpackhi_epi32(lo, lo));
+			_mm_storeu_si128((__m128i*) &out[4u*n_frame + 16u], _mm_unpacklo_epi32(hi, hi));
+			_mm_storeu_si128((__m128i*) &out[4u*n_frame + 24u], _mm_unpackhi_epi32(hi, hi));
+		}
+	}
+	else if((in_channels == 2u) && (out_channels == 4u) && (matrix->route[0] == 0u) && (matrix->route[1] == 1u) && (matrix->route[2] == 0u) && (matrix->route[3] == 1u))
+	{
+		//A stereo frame is one 32bit lane
+		for(n_frame = 0u; (n_frame + 4u) <= n_frames; n_frame += 4u)
+		{
+			samples = _mm_loadu_si128((const __m128i*) &in[2u*n_frame]);
+
+			_mm_storeu_si128((__m128i*) &out[4u*n_frame], _mm_unpacklo_epi32(samples, samples));
+			_mm_storeu_si128((__m128i*) &out[4u*n_frame + 8u], _mm_unpackhi_epi32(samples, samples));
+		}
+	}
+#endif
+
+	for(; n_frame < n_frames; n_frame++)
+	{
+		for(n_out = 0u; n_out < out_channels; n_out++) out[n_frame*out_channels + n_out] = in[n_frame*in_channels + matrix->route[n_out]];
+	}
+
+	return;
+}
+
+static void matrix_downmix(std::int16_t *out, const std::int16_t *in, size_t n_frames, const channel_matrix_t *matrix)
+{
+	const unsigned int in_channels = matrix->in_channels;
+	const size_t n_samples = n_frames*in_channels;
+	size_t n_frame = 0u;
+
+#if defined(__SSE2__)
+	__m128i frame_a;
+	__m128i frame_b;
+
+	//Two frames at a time. Each load takes 8 samples: the frame and the start of the next ones, which meet zero gains.
+	for(n_frame = 0u; ((n_frame + 1u)*in_channels + CHANNEL_MATRIX_MAX_CHANNELS) <= n_samples; n_frame += 2u)
+	{
+		frame_a = _mm_loadu_si128((const __m128i*) &in[n_frame*in_channels]);
+		frame_b = _mm_loadu_si128((const __m128i*) &in[(n_frame + 1u)*in_channels]);
+
+		_mm_storel_epi64((__m128i*) &out[2u*n_frame], matrix_pack_sse2(matrix_sum4_sse2(matrix_madd_sse2(frame_a, matrix->gain[0]), matrix_madd_sse2(frame_a, matrix->gain[1]), matrix_madd_sse2(frame_b, matrix->gain[0]), matrix_madd_sse2(frame_b, matrix->gain[1]))));
+	}
+#endif
+
+	for(; n_frame < n_frames; n_frame++)
+	{
+		out[2u*n_frame] = matrix_sample(&in[n_frame*in_channels], matrix->gain[0], in_channels);
+		out[2u*n_frame + 1u] = matrix_sample(&in[n_frame*in_channels], matrix->gain[1], in_channels);
+	}
+
+	return;
+}
+
+static void matrix_mix(std::int16_t *out, const std::int16_t *in, size_t n_frames, const channel_matrix_t *matrix)
+{
+	const unsigned int in_channels = matrix->in_channels;
+	const unsigned int out_channels = matrix->out_channels;
+	const size_t n_samples = n_frames*in_channels;
+	size_t n_frame = 0u;
+	unsigned int n_out = 0u;
+	unsigned int n_sample = 0u;
+
+#if defined(__SSE2__)
+	alignas(16) std::int16_t samples[8];
+	__m128i frame;
+	__m128i packed;
+
+	//Outputs four at a time, rows past the last output are zero
+	for(n_frame = 0u; (n_frame*in_channels + CHANNEL_MATRIX_MAX_CHANNELS) <= n_samples; n_frame++)
+	{
+		frame = _mm_loadu_si128((const __m128i*) &in[n_frame*in_channels]);
+
+		for(n_out = 0u; n_out < out_channels; n_out += 4u)
+		{
+			packed = matrix_pack_sse2(matrix_sum4_sse2(matrix_madd_sse2(frame, matrix->gain[n_out]), matrix_madd_sse2(frame, matrix->gain[n_out + 1u]), matrix_madd_sse2(frame, matrix->gain[n_out + 2u]), matrix_madd_sse2(frame, matrix->gain[n_out + 3u])));
+
+			if((n_out + 4u) <= out_channels)
+			{
+				_mm_storel_epi64((__m128i*) &out[n_frame*out_channels + n_out], packed);
+				continue;
+			}
+
+			_mm_store_si128((__m128i*) samples, packed);
+			for(n_sample = n_out; n_sample < out_channels; n_sample++) out[n_frame*out_channels + n_sample] = samples[n_sample - n_out];
+		}
+	}
+#endif
+
+	for(; n_frame < n_frames; n_frame++)
+	{
+		for(n_out = 0u; n_out < out_channels; n_out++) out[n_frame*out_channels + n_out] = matrix_sample(&in[n_frame*in_channels], matrix->gain[n_out], in_channels);
+	}
+
+	return;
+}
@@ -0,0 +1,69 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef CHANNELMATRIX_HPP
+#define CHANNELMATRIX_HPP
+
+#include "globaldef.h"
+#include <cstdint>
+
+/*
+ * Channel mixing matrix, from the channels of a file to the channels of a device, on interleaved S16 frames.
+ * Every output sample is saturate((sum of in[c]*gain[out][c] + 0x2000) >> 14): gains are Q14 fixed point, so 1.0
+ * is exact and a unity copy is bit exact. The same arithmetic is done by every kernel, SIMD or not.
+ * Rows are zero padded to CHANNEL_MATRIX_MAX_CHANNELS gains, so a frame times a row is one pmaddwd, and the partial
+ * sums of four rows are reduced together.
+ *
+ * Matrices are classified when built, and the kernel picked for the class:
+ * IDENTITY: copy. DUPLICATE: every output copies one input at unity gain (mono to N, stereo to 4), with shuffles.
+ * DOWNMIX: any matrix to stereo, two frames per reduction. MIX: anything else, four outputs per reduction.
+ */
+
+#define CHANNEL_MATRIX_MAX_CHANNELS 8u
+
+#define CHANNEL_MATRIX_UNITY 0x4000
+//Largest sum of absolute gains in a row, so that a row can not overflow 32bit accumulation
+#define CHANNEL_MATRIX_ROW_MAX 0xffff
+
+#define CHANNEL_MATRIX_IDENTITY 0
+#define CHANNEL_MATRIX_DUPLICATE 1
+#define CHANNEL_MATRIX_DOWNMIX 2
+#define CHANNEL_MATRIX_MIX 3
+
+struct channel_matrix {
+	unsigned int in_channels;
+	unsigned int out_channels;
+	int kind; //CHANNEL_MATRIX_ class
+	std::uint8_t route[CHANNEL_MATRIX_MAX_CHANNELS]; //DUPLICATE: input copied by each output
+	alignas(16) std::int16_t gain[CHANNEL_MATRIX_MAX_CHANNELS][CHANNEL_MATRIX_MAX_CHANNELS]; //[output][input], Q14
+};
+
+typedef struct channel_matrix channel_matrix_t;
+
+/*
+ * Default matrix from in_channels to out_channels (1 to CHANNEL_MATRIX_MAX_CHANNELS each).
+ * Same count: identity. Mono input: duplicated to every output. Fewer inputs: outputs repeat the inputs in order
+ * (stereo to 4: L R L R). Stereo output: the inputs are taken in WAVE speaker order (FL FR FC LFE BL BR SL SR, quad is
+ * FL FR BL BR) and folded down with center and surrounds at -3dB, LFE dropped, scaled so that the sum can not clip.
+ * Other reductions average the inputs that fold onto each output.
+ */
+bool channel_matrix_default(channel_matrix_t *matrix, unsigned int in_channels, unsigned int out_channels);
+
+/*
+ * Parses a matrix given as rows of gains, one row per output: "<gain>,<gain>,...;<gain>,<gain>,...".
+ * Gains range from -2.0 to 2.0, every row must have the same number of gains (the input channels).
+ * Returns false on a syntax error, a gain out of range, or a row whose gains add up to 4.0 or more.
+ */
+bool channel_matrix_parse(channel_matrix_t *matrix, const char *arg);
+
+//Sets the kind and route of a matrix whose gains were filled in by hand
+void channel_matrix_classify(channel_matrix_t *matrix);
+
+//Mixes n_frames frames of in (matrix->in_channels interleaved) into out (matrix->out_channels interleaved)
+void channel_matrix_apply(std::int16_t *out, const std::int16_t *in, size_t n_frames, const channel_matrix_t *matrix);
+
+#endif //CHANNELMATRIX_HPP
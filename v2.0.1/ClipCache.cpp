@@ -0,0 +1,314 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "ClipCache.hpp"
+#include "AudioConvert.hpp"
+#include "WaveHeader.hpp"
+#include <algorithm>
+#include <sys/stat.h>
+
+#define CLIP_FRAME_SIZE 4u //S16_LE stereo
+
+ClipCache::ClipCache(size_t budget_bytes)
+{
+	this->budget_bytes = budget_bytes;
+}
+
+ClipCache::~ClipCache(void)
+{
+	this->clear();
+}
+
+std::shared_ptr<const audio_clip_t> ClipCache::getClip(const char *filein_dir)
+{
+	struct stat filein_stat;
+	std::shared_ptr<audio_clip_t> clip = nullptr;
+	std::int64_t mtime_ns = 0;
+	size_t n_bytes = 0u;
+
+	if(filein_dir == nullptr) return nullptr;
+
+	if(stat(filein_dir, &filein_stat) < 0)
+	{
+		this->error_msg = "Clip Cache: could not open file.";
+		return nullptr;
+	}
+
+	mtime_ns = ((std::int64_t) filein_stat.st_mtim.tv_sec)*1000000000 + ((std::int64_t) filein_stat.st_mtim.tv_nsec);
+
+	{
+		std::lock_guard<std::mutex> lock(this->cache_mutex);
+		auto entry = this->entries.find(filein_dir);
+
+		if(entry != this->entries.end())
+		{
+			if(entry->second.clip->mtime_ns == mtime_ns)
+			{
+				this->lru.splice(this->lru.begin(), this->lru, entry->second.lru_pos);
+				return entry->second.clip;
+			}
+
+			//Changed on disk
+			this->entry_remove(filein_dir);
+		}
+	}
+
+	//Decoded without holding the lock, so hits on other clips are not held up
+	clip = this->clip_load(filein_dir, mtime_ns);
+	if(clip == nullptr) return nullptr;
+
+	n_bytes = clip->samples.size()*sizeof(std::int16_t);
+	if(n_bytes > this->budget_bytes)
+	{
+		this->error_msg = "Clip Cache: clip is larger than the cache budget.";
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(this->cache_mutex);
+
+	//Loaded by another thread in the meantime
+	if(this->entries.count(filein_dir) > 0u) this->entry_remove(filein_dir);
+
+	this->evict(n_bytes);
+
+	this->lru.push_front(filein_dir);
+	this->entries[filein_dir] = {clip, this->lru.begin()};
+	this->usage_bytes += n_bytes;
+
+	return clip;
+}
+
+void ClipCache::clear(void)
+{
+	std::lock_guard<std::mutex> lock(this->cache_mutex);
+
+	this->entries.clear();
+	this->lru.clear();
+	this->usage_bytes = 0u;
+	return;
+}
+
+size_t ClipCache::getBudget(void)
+{
+	return this->budget_bytes;
+}
+
+size_t ClipCache::getUsage(void)
+{
+	std::lock_guard<std::mutex> lock(this->cache_mutex);
+	return this->usage_bytes;
+}
+
+size_t ClipCache::getClipCount(void)
+{
+	std::lock_guard<std::mutex> lock(this->cache_mutex);
+	return this->entries.size();
+}
+
+std::string ClipCache::getLastErrorMessage(void)
+{
+	return this->error_msg;
+}
+
+//Caller holds cache_mutex
+void ClipCache::entry_remove(const std::string &filein_dir)
+{
+	auto entry = this->entries.find(filein_dir);
+
+	if(entry == this->entries.end()) return;
+
+	this->usage_bytes -= entry->second.clip->samples.size()*sizeof(std::int16_t);
+	this->lru.erase(entry->second.lru_pos);
+	this->entries.erase(entry);
+	return;
+}
+
+//Caller holds cache_mutex
+void ClipCache::evict(size_t n_bytes)
+{
+	while(!this->lru.empty() && ((this->usage_bytes + n_bytes) > this->budget_bytes))
+	{
+		std::string filein_dir = this->lru.back();
+		this->entry_remove(filein_dir);
+	}
+
+	return;
+}
+
+std::shared_ptr<audio_clip_t> ClipCache::clip_load(const char *filein_dir, std::int64_t mtime_ns)
+{
+	audio_playback_params_t params;
+	std::shared_ptr<audio_clip_t> clip = nullptr;
+	std::vector<std::uint8_t> filebuf;
+	std::vector<std::int16_t> blockbuf;
+	size_t data_size = 0u;
+	size_t frame_size = 0u;
+	size_t n_frames = 0u;
+	size_t n_done = 0u;
+	size_t n_block = 0u;
+	ssize_t n_read = 0;
+	int format = -1;
+	int fd = -1;
+
+	if(!file_ext_check(filein_dir))
+	{
+		this->error_msg = "Clip Cache: file extension not supported.";
+		return nullptr;
+	}
+
+	fd = file_open(filein_dir);
+	if(fd < 0)
+	{
+		this->error_msg = "Clip Cache: could not open file.";
+		return nullptr;
+	}
+
+	params.audio_dev_desc = nullptr;
+	params.filein_dir = (char*) filein_dir;
+
+	format = file_get_params(fd, &params);
+	if(format < 0)
+	{
+		this->error_msg = "Clip Cache: file format not supported.";
+		file_close(fd);
+		return nullptr;
+	}
+
+	switch(format)
+	{
+		case PB_8BIT1CH:
+			frame_size = 1u;
+			break;
+
+		case PB_8BIT2CH:
+		case PB_16BIT1CH:
+			frame_size = 2u;
+			break;
+
+		case PB_24BIT1CH:
+			frame_size = 3u;
+			break;
+
+		case PB_16BIT2CH:
+			frame_size = 4u;
+			break;
+
+		case PB_24BIT2CH:
+			frame_size = 6u;
+			break;
+
+		case PB_G711ALAW:
+		case PB_G711ULAW:
+			frame_size = (size_t) params.n_channels;
+			break;
+
+		case PB_IMAADPCM:
+			frame_size = 0u;
+			break;
+
+		default:
+			this->error_msg = "Clip Cache: file format not supported.";
+			file_close(fd);
+			return nullptr;
+	}
+
+	data_size = (size_t) (params.audio_data_end - params.audio_data_begin);
+
+	if(frame_size > 0u) n_frames = data_size/frame_size;
+	else n_frames = ((data_size + params.block_align - 1u)/params.block_align)*params.samples_per_block;
+
+	//Checked before reading, so oversized files are never loaded
+	if((n_frames*CLIP_FRAME_SIZE) > this->budget_bytes)
+	{
+		this->error_msg = "Clip Cache: clip is larger than the cache budget.";
+		file_close(fd);
+		return nullptr;
+	}
+
+	filebuf.resize(data_size);
+
+	while(n_done < data_size)
+	{
+		n_read = __PREAD(fd, &filebuf[n_done], data_size - n_done, params.audio_data_begin + ((__offset) n_done));
+		if(n_read <= 0) break;
+
+		n_done += (size_t) n_read;
+	}
+
+	file_close(fd);
+
+	//Files shorter than their header claims end where the data ends
+	if(n_done < data_size)
+	{
+		data_size = n_done;
+		if(frame_size > 0u) n_frames = data_size/frame_size;
+	}
+
+	clip = std::make_shared<audio_clip_t>();
+	clip->filein_dir = filein_dir;
+	clip->mtime_ns = mtime_ns;
+	clip->sample_rate = params.sample_rate;
+	clip->samples.resize(2u*n_frames);
+
+	//8bit and G.711 samples have no byte order, 16bit and 24bit samples of RIFX files are big-endian
+	switch(format)
+	{
+		case PB_8BIT1CH:
+			convert_8bit1ch_s16_2ch(clip->samples.data(), filebuf.data(), n_frames);
+			break;
+
+		case PB_8BIT2CH:
+			convert_8bit2ch_s16_2ch(clip->samples.data(), filebuf.data(), n_frames);
+			break;
+
+		case PB_16BIT1CH:
+			if(params.big_endian) convert_16bit1ch_be_s16_2ch(clip->samples.data(), filebuf.data(), n_frames);
+			else convert_16bit1ch_s16_2ch(clip->samples.data(), (const std::int16_t*) filebuf.data(), n_frames);
+			break;
+
+		case PB_16BIT2CH:
+			if(params.big_endian) convert_16bit2ch_be_s16_2ch(clip->samples.data(), filebuf.data(), n_frames);
+			else memcpy(clip->samples.data(), filebuf.data(), n_frames*CLIP_FRAME_SIZE);
+			break;
+
+		case PB_24BIT1CH:
+			if(params.big_endian) convert_24bit1ch_be_s16_2ch(clip->samples.data(), filebuf.data(), n_frames);
+			else convert_24bit1ch_s16_2ch(clip->samples.data(), filebuf.data(), n_frames);
+			break;
+
+		case PB_24BIT2CH:
+			if(params.big_endian) convert_24bit2ch_be_s16_2ch(clip->samples.data(), filebuf.data(), n_frames);
+			else convert_24bit2ch_s16_2ch(clip->samples.data(), filebuf.data(), n_frames);
+			break;
+
+		case PB_G711ALAW:
+		case PB_G711ULAW:
+			if(params.n_channels == 1u) convert_g711_1ch_s16_2ch(clip->samples.data(), filebuf.data(), n_frames, (format == PB_G711ALAW));
+			else convert_g711_2ch_s16_2ch(clip->samples.data(), filebuf.data(), n_frames, (format == PB_G711ALAW));
+			break;
+
+		case PB_IMAADPCM:
+			blockbuf.resize(((size_t) params.samples_per_block)*((size_t) params.n_channels));
+			n_frames = 0u;
+
+			for(n_done = 0u; n_done < data_size; n_done += params.block_align)
+			{
+				n_block = decode_imaadpcm_block(blockbuf.data(), &filebuf[n_done], std::min((size_t) params.block_align, data_size - n_done), params.n_channels);
+
+				if(params.n_channels == 1u) convert_16bit1ch_s16_2ch(&clip->samples[2u*n_frames], blockbuf.data(), n_block);
+				else memcpy(&clip->samples[2u*n_frames], blockbuf.data(), n_block*CLIP_FRAME_SIZE);
+
+				n_frames += n_block;
+			}
+
+			clip->samples.resize(2u*n_frames);
+			break;
+	}
+
+	clip->n_frames = n_frames;
+	return clip;
+}
@@ -0,0 +1,73 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef CLIPCACHE_HPP
+#define CLIPCACHE_HPP
+
+#include "globaldef.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+
+/*
+ * In-RAM cache of fully decoded clips, in the mixer's device format (S16_LE stereo).
+ * Clips are keyed by path and modification time: a file that changed on disk is decoded again.
+ * The least recently used clips are evicted to stay within the memory budget. A clip handed out stays valid
+ * for as long as its holder keeps it, even after it has been evicted.
+ */
+
+struct audio_clip {
+	std::string filein_dir;
+	std::int64_t mtime_ns;
+	std::uint32_t sample_rate;
+	size_t n_frames;
+	std::vector<std::int16_t> samples;
+};
+
+typedef struct audio_clip audio_clip_t;
+
+class ClipCache {
+	public:
+		ClipCache(size_t budget_bytes);
+		~ClipCache(void);
+
+		//Returns the decoded clip, loading it if needed. nullptr if the file can't be decoded or is larger than the budget.
+		std::shared_ptr<const audio_clip_t> getClip(const char *filein_dir);
+		void clear(void);
+
+		size_t getBudget(void);
+		size_t getUsage(void);
+		size_t getClipCount(void);
+
+		std::string getLastErrorMessage(void);
+
+	private:
+		struct cache_entry {
+			std::shared_ptr<const audio_clip_t> clip;
+			std::list<std::string>::iterator lru_pos;
+		};
+
+		size_t budget_bytes = 0u;
+		size_t usage_bytes = 0u;
+
+		//Front is the most recently used
+		std::list<std::string> lru;
+		std::unordered_map<std::string, struct cache_entry> entries;
+		std::mutex cache_mutex;
+
+		std::string error_msg = "";
+
+		std::shared_ptr<audio_clip_t> clip_load(const char *filein_dir, std::int64_t mtime_ns);
+		void entry_remove(const std::string &filein_dir);
+		void evict(size_t n_bytes);
+};
+
+#endif //CLIPCACHE_HPP
@@ -0,0 +1,207 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "DirectReader.hpp"
+#include <cstdlib>
+#include <cerrno>
+
+DirectReader::DirectReader(size_t chunk_bytes)
+{
+	if(chunk_bytes == 0u) chunk_bytes = DIRECT_READER_CHUNK_BYTES;
+
+	this->chunk_bytes = (chunk_bytes + DIRECT_READER_ALIGN - 1u) & ~((size_t) (DIRECT_READER_ALIGN - 1u));
+}
+
+DirectReader::~DirectReader(void)
+{
+	this->close();
+}
+
+bool DirectReader::open(const char *filein_dir)
+{
+	void *buf = nullptr;
+
+	this->close();
+
+	this->filein = ::open(filein_dir, O_RDONLY | O_DIRECT);
+	if(this->filein < 0) return false;
+
+	if(posix_memalign(&buf, DIRECT_READER_ALIGN, 2u*this->chunk_bytes) != 0)
+	{
+		this->close();
+		return false;
+	}
+
+	this->chunkbuf[0] = (std::uint8_t*) buf;
+	this->chunkbuf[1] = &this->chunkbuf[0][this->chunk_bytes];
+
+	//Some file systems take O_DIRECT at open and only refuse it on read
+	this->chunk_load(0u, 0);
+	if(this->chunk_len[0] < 0)
+	{
+		this->close();
+		return false;
+	}
+
+	this->curr_chunk = 0u;
+	this->prefetch_pos = -1;
+	this->prefetch_busy = false;
+	this->prefetch_quit = false;
+	this->prefetch_thread = std::thread(&DirectReader::prefetch_proc, this);
+	return true;
+}
+
+void DirectReader::close(void)
+{
+	if(this->prefetch_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->prefetch_mutex);
+			this->prefetch_quit = true;
+		}
+
+		this->prefetch_cond.notify_all();
+		this->prefetch_thread.join();
+	}
+
+	if(this->filein >= 0)
+	{
+		::close(this->filein);
+		this->filein = -1;
+	}
+
+	//Both chunks share one allocation
+	if(this->chunkbuf[0] != nullptr)
+	{
+		std::free(this->chunkbuf[0]);
+		this->chunkbuf[0] = nullptr;
+		this->chunkbuf[1] = nullptr;
+	}
+
+	this->chunk_len[0] = -1;
+	this->chunk_len[1] = -1;
+	return;
+}
+
+ssize_t DirectReader::read(void *buf, size_t n_bytes, __offset pos)
+{
+	std::uint8_t *bytebuf = (std::uint8_t*) buf;
+	size_t n_done = 0u;
+	size_t n_copy = 0u;
+	size_t chunk_offset = 0u;
+
+	if(this->filein < 0) return -1;
+
+	while(n_done < n_bytes)
+	{
+		if(!this->chunk_has(this->curr_chunk, pos))
+		{
+			//The other chunk may be the one being prefetched
+			this->prefetch_wait();
+
+			if(this->chunk_has(this->curr_chunk ^ 1u, pos)) this->curr_chunk ^= 1u;
+			else this->chunk_load(this->curr_chunk, pos);
+
+			if(this->chunk_len[this->curr_chunk] < 0) return (n_done > 0u) ? ((ssize_t) n_done) : -1;
+
+			//pos is at or past the end of the file
+			if(!this->chunk_has(this->curr_chunk, pos)) break;
+
+			this->prefetch_start();
+		}
+
+		chunk_offset = (size_t) (pos - this->chunk_pos[this->curr_chunk]);
+		n_copy = ((size_t) this->chunk_len[this->curr_chunk]) - chunk_offset;
+		if(n_copy > (n_bytes - n_done)) n_copy = n_bytes - n_done;
+
+		memcpy(&bytebuf[n_done], &this->chunkbuf[this->curr_chunk][chunk_offset], n_copy);
+
+		n_done += n_copy;
+		pos += (__offset) n_copy;
+	}
+
+	return (ssize_t) n_done;
+}
+
+bool DirectReader::chunk_has(unsigned int n_chunk, __offset pos)
+{
+	if(this->chunk_len[n_chunk] <= 0) return false;
+
+	return ((pos >= this->chunk_pos[n_chunk]) && (pos < (this->chunk_pos[n_chunk] + ((__offset) this->chunk_len[n_chunk]))));
+}
+
+void DirectReader::chunk_load(unsigned int n_chunk, __offset pos)
+{
+	ssize_t n_read = 0;
+
+	pos &= ~((__offset) (DIRECT_READER_ALIGN - 1u));
+
+	do {
+		n_read = __PREAD(this->filein, this->chunkbuf[n_chunk], this->chunk_bytes, pos);
+	} while((n_read < 0) && (errno == EINTR));
+
+	this->chunk_pos[n_chunk] = pos;
+	this->chunk_len[n_chunk] = n_read;
+	return;
+}
+
+//Playback side. Starts reading the chunk that follows the current one, unless the file ends in the current one.
+void DirectReader::prefetch_start(void)
+{
+	__offset pos = this->chunk_pos[this->curr_chunk] + ((__offset) this->chunk_bytes);
+
+	if(this->chunk_len[this->curr_chunk] < ((ssize_t) this->chunk_bytes)) return;
+	if(this->chunk_has(this->curr_chunk ^ 1u, pos)) return;
+
+	{
+		std::lock_guard<std::mutex> lock(this->prefetch_mutex);
+
+		//Nobody looks at the other chunk until the prefetch is done
+		this->chunk_len[this->curr_chunk ^ 1u] = -1;
+		this->prefetch_pos = pos;
+		this->prefetch_busy = true;
+	}
+
+	this->prefetch_cond.notify_all();
+	return;
+}
+
+void DirectReader::prefetch_wait(void)
+{
+	std::unique_lock<std::mutex> lock(this->prefetch_mutex);
+
+	this->prefetch_cond.wait(lock, [this] { return !this->prefetch_busy; });
+	return;
+}
+
+void DirectReader::prefetch_proc(void)
+{
+	std::unique_lock<std::mutex> lock(this->prefetch_mutex);
+	__offset pos = 0;
+	unsigned int n_chunk = 0u;
+
+	while(true)
+	{
+		this->prefetch_cond.wait(lock, [this] { return (this->prefetch_pos >= 0) || this->prefetch_quit; });
+		if(this->prefetch_quit) break;
+
+		//The playback side does not switch chunks while a prefetch is busy
+		pos = this->prefetch_pos;
+		n_chunk = this->curr_chunk ^ 1u;
+		this->prefetch_pos = -1;
+
+		lock.unlock();
+		this->chunk_load(n_chunk, pos);
+		lock.lock();
+
+		this->prefetch_busy = false;
+		this->prefetch_cond.notify_all();
+	}
+
+	this->prefetch_busy = false;
+	return;
+}
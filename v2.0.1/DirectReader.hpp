@@ -0,0 +1,67 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef DIRECTREADER_HPP
+#define DIRECTREADER_HPP
+
+#include "globaldef.h"
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * Reads a file with O_DIRECT: no page cache, every read goes to the device.
+ * O_DIRECT needs block aligned offsets, lengths and memory, so the file is read in aligned chunks into two chunk
+ * buffers, and read() copies any range out of them (the audio data rarely begins on a block boundary).
+ * While one chunk is being consumed, a worker thread reads the next one into the other buffer, so sequential reads
+ * only wait on the device when playback outruns it. Seeks and loop wraps read the chunk they land in right away.
+ */
+
+//Covers the logical block size of any device in use (512 or 4096 bytes)
+#define DIRECT_READER_ALIGN 4096u
+#define DIRECT_READER_CHUNK_BYTES 0x40000u
+
+class DirectReader {
+	public:
+		//chunk_bytes is rounded up to DIRECT_READER_ALIGN
+		DirectReader(size_t chunk_bytes);
+		~DirectReader(void);
+
+		//Returns false if the file can not be opened with O_DIRECT (tmpfs and some other file systems)
+		bool open(const char *filein_dir);
+		void close(void);
+
+		//Same as pread: returns the bytes read (short at the end of the file), or -1
+		ssize_t read(void *buf, size_t n_bytes, __offset pos);
+
+	private:
+		int filein = -1;
+		size_t chunk_bytes = DIRECT_READER_CHUNK_BYTES;
+
+		//chunk_len is -1 while the chunk holds nothing
+		std::uint8_t *chunkbuf[2] = {nullptr, nullptr};
+		__offset chunk_pos[2] = {0, 0};
+		ssize_t chunk_len[2] = {-1, -1};
+		unsigned int curr_chunk = 0u;
+
+		//Prefetch of the chunk after the current one, into the other buffer
+		std::thread prefetch_thread;
+		std::mutex prefetch_mutex;
+		std::condition_variable prefetch_cond;
+		__offset prefetch_pos = -1;
+		bool prefetch_busy = false;
+		bool prefetch_quit = false;
+
+		bool chunk_has(unsigned int n_chunk, __offset pos);
+		void chunk_load(unsigned int n_chunk, __offset pos);
+		void prefetch_start(void);
+		void prefetch_wait(void);
+		void prefetch_proc(void);
+};
+
+#endif //DIRECTREADER_HPP
@@ -0,0 +1,122 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "PeriodStats.hpp"
+
+static std::uint64_t period_histogram_bucket_upper(int bucket)
+{
+	int exp = 0;
+	std::uint64_t sub = 0u;
+
+	if(bucket < 2*PERIOD_HISTOGRAM_SUB_COUNT) return (std::uint64_t) bucket;
+
+	bucket -= 2*PERIOD_HISTOGRAM_SUB_COUNT;
+	exp = bucket/PERIOD_HISTOGRAM_SUB_COUNT + PERIOD_HISTOGRAM_SUB_BITS + 1;
+	sub = (std::uint64_t) (bucket%PERIOD_HISTOGRAM_SUB_COUNT + PERIOD_HISTOGRAM_SUB_COUNT);
+
+	return ((sub + 1u) << (exp - PERIOD_HISTOGRAM_SUB_BITS)) - 1u;
+}
+
+void period_histogram_reset(period_histogram_t *hist)
+{
+	int n_bucket = 0;
+
+	if(hist == nullptr) return;
+
+	for(n_bucket = 0; n_bucket < PERIOD_HISTOGRAM_BUCKETS; n_bucket++) hist->count[n_bucket].store(0u, std::memory_order_relaxed);
+
+	hist->total.store(0u, std::memory_order_relaxed);
+	hist->sum.store(0u, std::memory_order_relaxed);
+	hist->min.store(UINT64_MAX, std::memory_order_relaxed);
+	hist->max.store(0u, std::memory_order_relaxed);
+	return;
+}
+
+void period_stats_reset(period_stats_t *stats)
+{
+	if(stats == nullptr) return;
+
+	period_histogram_reset(&stats->load);
+	period_histogram_reset(&stats->play);
+	period_histogram_reset(&stats->headroom);
+	return;
+}
+
+std::uint64_t period_histogram_percentile(const period_histogram_t *hist, double percent)
+{
+	std::uint64_t total = 0u;
+	std::uint64_t target = 0u;
+	std::uint64_t count = 0u;
+	std::uint64_t max = 0u;
+	std::uint64_t upper = 0u;
+	int n_bucket = 0;
+
+	if(hist == nullptr) return 0u;
+
+	total = hist->total.load(std::memory_order_acquire);
+	if(total == 0u) return 0u;
+
+	if(percent < 0.0) percent = 0.0;
+	else if(percent > 100.0) percent = 100.0;
+
+	target = (std::uint64_t) ((percent/100.0)*((double) total) + 0.5);
+	if(target < 1u) target = 1u;
+
+	max = hist->max.load(std::memory_order_relaxed);
+
+	for(n_bucket = 0; n_bucket < PERIOD_HISTOGRAM_BUCKETS; n_bucket++)
+	{
+		count += hist->count[n_bucket].load(std::memory_order_relaxed);
+		if(count < target) continue;
+
+		//The top bucket is clamped to the exact maximum
+		upper = period_histogram_bucket_upper(n_bucket);
+		return (upper < max) ? upper : max;
+	}
+
+	return max;
+}
+
+static void period_histogram_print(const period_histogram_t *hist, const char *name, std::FILE *stream)
+{
+	std::uint64_t total = hist->total.load(std::memory_order_acquire);
+	double mean = 0.0;
+
+	if(total == 0u)
+	{
+		std::fprintf(stream, "  %-9s no samples\n", name);
+		return;
+	}
+
+	mean = ((double) hist->sum.load(std::memory_order_relaxed))/((double) total)/1000.0;
+
+	std::fprintf(stream, "  %-9s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", name, (unsigned long long) total,
+		((double) hist->min.load(std::memory_order_relaxed))/1000.0,
+		((double) period_histogram_percentile(hist, 50.0))/1000.0,
+		((double) period_histogram_percentile(hist, 90.0))/1000.0,
+		((double) period_histogram_percentile(hist, 99.0))/1000.0,
+		((double) period_histogram_percentile(hist, 99.9))/1000.0,
+		((double) hist->max.load(std::memory_order_relaxed))/1000.0,
+		mean);
+
+	return;
+}
+
+void period_stats_print(const period_stats_t *stats, std::FILE *stream)
+{
+	if(stats == nullptr) return;
+
+	std::fprintf(stream, "Period timing (microseconds):\n");
+	std::fprintf(stream, "  %-9s %10s %10s %10s %10s %10s %10s %10s %10s\n", "", "periods", "min", "p50", "p90", "p99", "p99.9", "max", "mean");
+
+	period_histogram_print(&stats->load, "load", stream);
+	period_histogram_print(&stats->play, "play", stream);
+	period_histogram_print(&stats->headroom, "headroom", stream);
+
+	std::fflush(stream);
+	return;
+}
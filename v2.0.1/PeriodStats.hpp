@@ -0,0 +1,78 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef PERIODSTATS_HPP
+#define PERIODSTATS_HPP
+
+#include "globaldef.h"
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+
+/*
+ * Per-period timing histograms (HDR-style log-linear buckets, ~6% resolution, values in nanoseconds).
+ * Written by the playback thread only, read by any thread at any time. No locks, no allocations.
+ * Values below PERIOD_HISTOGRAM_SUB_COUNT*2 get one bucket each, every power of two above that is split
+ * into PERIOD_HISTOGRAM_SUB_COUNT buckets.
+ */
+
+#define PERIOD_HISTOGRAM_SUB_BITS 4
+#define PERIOD_HISTOGRAM_SUB_COUNT (1 << PERIOD_HISTOGRAM_SUB_BITS)
+#define PERIOD_HISTOGRAM_MAX_EXP 47 //Up to ~140000 seconds
+#define PERIOD_HISTOGRAM_BUCKETS (2*PERIOD_HISTOGRAM_SUB_COUNT + (PERIOD_HISTOGRAM_MAX_EXP - PERIOD_HISTOGRAM_SUB_BITS)*PERIOD_HISTOGRAM_SUB_COUNT)
+
+struct period_histogram {
+	std::atomic<std::uint64_t> count[PERIOD_HISTOGRAM_BUCKETS];
+	std::atomic<std::uint64_t> total;
+	std::atomic<std::uint64_t> sum;
+	std::atomic<std::uint64_t> min;
+	std::atomic<std::uint64_t> max;
+};
+
+typedef struct period_histogram period_histogram_t;
+
+struct period_stats {
+	period_histogram_t load; //Time spent in buffer_load
+	period_histogram_t play; //Time spent in buffer_play (writei, including waits for the device)
+	period_histogram_t headroom; //Audio queued in the device right before writing a period (time left before an underrun)
+};
+
+typedef struct period_stats period_stats_t;
+
+void period_stats_reset(period_stats_t *stats);
+void period_stats_print(const period_stats_t *stats, std::FILE *stream);
+
+void period_histogram_reset(period_histogram_t *hist);
+//Upper bound of the bucket holding the given percentile (0.0 to 100.0). 0 if the histogram is empty.
+std::uint64_t period_histogram_percentile(const period_histogram_t *hist, double percent);
+
+inline int period_histogram_bucket(std::uint64_t value)
+{
+	int exp = 0;
+
+	if(value < (std::uint64_t) (2*PERIOD_HISTOGRAM_SUB_COUNT)) return (int) value;
+
+	exp = 63 - __builtin_clzll(value);
+	if(exp > PERIOD_HISTOGRAM_MAX_EXP) return PERIOD_HISTOGRAM_BUCKETS - 1;
+
+	return 2*PERIOD_HISTOGRAM_SUB_COUNT + (exp - PERIOD_HISTOGRAM_SUB_BITS - 1)*PERIOD_HISTOGRAM_SUB_COUNT + (int) ((value >> (exp - PERIOD_HISTOGRAM_SUB_BITS)) & (PERIOD_HISTOGRAM_SUB_COUNT - 1));
+}
+
+//Single writer: plain load/store pairs, readers may see a sample counted in a bucket before it shows up in total.
+inline void period_histogram_record(period_histogram_t *hist, std::uint64_t value)
+{
+	std::atomic<std::uint64_t> *bucket = &hist->count[period_histogram_bucket(value)];
+
+	bucket->store(bucket->load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+	hist->sum.store(hist->sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	if(value < hist->min.load(std::memory_order_relaxed)) hist->min.store(value, std::memory_order_relaxed);
+	if(value > hist->max.load(std::memory_order_relaxed)) hist->max.store(value, std::memory_order_relaxed);
+	hist->total.store(hist->total.load(std::memory_order_relaxed) + 1u, std::memory_order_release);
+	return;
+}
+
+#endif //PERIODSTATS_HPP
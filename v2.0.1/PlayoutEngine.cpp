@@ -0,0 +1,554 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "PlayoutEngine.hpp"
+#include <cerrno>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+
+#define PLAYOUT_IO_WORKERS 2u
+#define PLAYOUT_DRAIN_POLL_MS 10
+
+PlayoutEngine::PlayoutEngine(unsigned int n_io_workers, unsigned int n_writers, size_t ring_periods)
+{
+	unsigned int n_writer = 0u;
+
+	this->n_io_workers = (n_io_workers > 0u) ? n_io_workers : PLAYOUT_IO_WORKERS;
+	this->n_writers = (n_writers > 0u) ? n_writers : std::thread::hardware_concurrency();
+	if(this->n_writers == 0u) this->n_writers = 1u;
+
+	//Two periods are the least that lets loading overlap writing
+	if(ring_periods >= 2u) this->ring_periods = ring_periods;
+
+	//Created up front, so stop can wake the writers at any time
+	for(n_writer = 0u; n_writer < this->n_writers; n_writer++) this->wake_fd.push_back(eventfd(0u, (EFD_CLOEXEC | EFD_NONBLOCK)));
+}
+
+PlayoutEngine::~PlayoutEngine(void)
+{
+	size_t n_output = 0u;
+	size_t n_writer = 0u;
+
+	for(n_output = 0u; n_output < this->outputs.size(); n_output++)
+	{
+		this->output_free(this->outputs[n_output]);
+		delete this->outputs[n_output];
+	}
+
+	for(n_writer = 0u; n_writer < this->wake_fd.size(); n_writer++)
+	{
+		if(this->wake_fd[n_writer] >= 0) close(this->wake_fd[n_writer]);
+	}
+}
+
+bool PlayoutEngine::addOutput(AudioPlayback *pb_obj)
+{
+	playout_output_t *output = nullptr;
+
+	if(pb_obj == nullptr)
+	{
+		this->error_msg = "Playout Engine: no playback object.";
+		return false;
+	}
+
+	output = new playout_output_t;
+	output->pb_obj = pb_obj;
+	output->n_writer = 0u;
+	output->opened = false;
+	output->period_frames = 0u;
+	output->period_bytes = 0u;
+	output->frame_size = 0u;
+	output->ringbuf = nullptr;
+	output->state = PLAYOUT_DONE;
+	output->write_frame = 0u;
+	output->n_pollfd = 0u;
+	output->pollfd_count = 0u;
+
+	this->outputs.push_back(output);
+	return true;
+}
+
+size_t PlayoutEngine::getOutputCount(void)
+{
+	return this->outputs.size();
+}
+
+bool PlayoutEngine::run(void)
+{
+	std::vector<std::thread> io_workers;
+	std::vector<std::thread> writers;
+	unsigned int n_io_workers = this->n_io_workers;
+	unsigned int n_writers = this->n_writers;
+	unsigned int n_thread = 0u;
+	size_t n_output = 0u;
+	bool ok = true;
+
+	if(this->outputs.empty())
+	{
+		this->error_msg = "Playout Engine: no outputs.";
+		return false;
+	}
+
+	for(n_thread = 0u; n_thread < n_writers; n_thread++)
+	{
+		if(this->wake_fd[n_thread] >= 0) continue;
+
+		this->error_msg = "Playout Engine: could not create eventfd.";
+		return false;
+	}
+
+	//No more threads than outputs
+	if(n_writers > this->outputs.size()) n_writers = (unsigned int) this->outputs.size();
+	if(n_io_workers > this->outputs.size()) n_io_workers = (unsigned int) this->outputs.size();
+
+	//A stop of the previous run does not carry over to this one
+	this->stop_request = false;
+	this->job_shutdown = false;
+
+	//Devices are opened one after the other, an output that fails to open is left out
+	for(n_output = 0u; n_output < this->outputs.size(); n_output++)
+	{
+		playout_output_t *output = this->outputs[n_output];
+
+		output->n_writer = (unsigned int) (n_output%n_writers);
+		output->error_msg = "";
+		output->opened = this->output_open(output);
+		if(!output->opened) ok = false;
+	}
+
+	for(n_thread = 0u; n_thread < n_io_workers; n_thread++) io_workers.push_back(std::thread(&PlayoutEngine::io_worker_proc, this));
+
+	for(n_output = 0u; n_output < this->outputs.size(); n_output++)
+	{
+		if(this->outputs[n_output]->opened) this->load_request(this->outputs[n_output]);
+	}
+
+	for(n_thread = 0u; n_thread < n_writers; n_thread++) writers.push_back(std::thread(&PlayoutEngine::writer_proc, this, n_thread));
+	for(n_thread = 0u; n_thread < writers.size(); n_thread++) writers[n_thread].join();
+
+	//Writers are done: what is left in the queue are the last closes
+	{
+		std::lock_guard<std::mutex> lock(this->job_mutex);
+		this->job_shutdown = true;
+	}
+
+	this->job_cond.notify_all();
+	for(n_thread = 0u; n_thread < io_workers.size(); n_thread++) io_workers[n_thread].join();
+
+	for(n_output = 0u; n_output < this->outputs.size(); n_output++)
+	{
+		playout_output_t *output = this->outputs[n_output];
+
+		this->output_free(output);
+
+		if(output->error_msg.empty()) continue;
+
+		this->error_msg = "Output " + std::to_string(n_output) + ": " + output->error_msg;
+		ok = false;
+	}
+
+	return ok;
+}
+
+void PlayoutEngine::stop(void)
+{
+	size_t n_writer = 0u;
+
+	this->stop_request = true;
+
+	for(n_writer = 0u; n_writer < this->wake_fd.size(); n_writer++) this->writer_wake((unsigned int) n_writer);
+
+	return;
+}
+
+std::string PlayoutEngine::getLastErrorMessage(void)
+{
+	return this->error_msg;
+}
+
+bool PlayoutEngine::output_open(playout_output_t *output)
+{
+	AudioPlayback *pb_obj = output->pb_obj;
+	size_t slot_stride = 0u;
+	size_t n_slot = 0u;
+
+	//The writer waits in poll, never in the device
+	pb_obj->setNonBlocking(true);
+
+	if(!pb_obj->playout_begin())
+	{
+		output->error_msg = pb_obj->getLastErrorMessage();
+		return false;
+	}
+
+	if(pb_obj->audio_dev == nullptr)
+	{
+		output->error_msg = "Playout Engine: render output is not supported.";
+		pb_obj->playout_end();
+		return false;
+	}
+
+	pb_obj->playback_reset();
+
+	output->period_frames = pb_obj->BUFFER_SIZE_FRAMES;
+	output->frame_size = (size_t) snd_pcm_frames_to_bytes(pb_obj->audio_dev, 1);
+	output->period_bytes = output->period_frames*output->frame_size;
+
+	//Slots start on a cache line each, like every other period buffer
+	slot_stride = (output->period_bytes + BUFFER_ARENA_ALIGN - 1u) & ~((size_t) (BUFFER_ARENA_ALIGN - 1u));
+
+	output->ringbuf = (std::uint8_t*) pb_obj->buffer_acquire(this->ring_periods*slot_stride);
+	if(output->ringbuf == nullptr)
+	{
+		output->error_msg = "Playout Engine: could not allocate ring buffer.";
+		pb_obj->playout_end();
+		return false;
+	}
+
+	output->ring.resize(this->ring_periods);
+
+	for(n_slot = 0u; n_slot < this->ring_periods; n_slot++)
+	{
+		output->ring[n_slot].buf = &output->ringbuf[n_slot*slot_stride];
+		output->ring[n_slot].file_pos = 0;
+		output->ring[n_slot].loop_wraps = 0u;
+		output->ring[n_slot].loop_begin = 0;
+		output->ring[n_slot].loop_end = 0;
+	}
+
+	output->ring_head = 0u;
+	output->ring_tail = 0u;
+	output->load_queued = false;
+	output->load_done = false;
+	output->abort = false;
+
+	output->state = PLAYOUT_PREFILL;
+	output->write_frame = 0u;
+	return true;
+}
+
+void PlayoutEngine::output_free(playout_output_t *output)
+{
+	output->ring.clear();
+
+	if(output->ringbuf != nullptr)
+	{
+		output->pb_obj->buffer_release(output->ringbuf);
+		output->ringbuf = nullptr;
+	}
+
+	output->opened = false;
+	return;
+}
+
+void PlayoutEngine::job_push(int type, playout_output_t *output)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->job_mutex);
+		this->jobs.push_back(std::make_pair(type, output));
+	}
+
+	this->job_cond.notify_one();
+	return;
+}
+
+//At most one load job per output is queued or running, so its buffer_load calls never overlap
+void PlayoutEngine::load_request(playout_output_t *output)
+{
+	if(!output->load_queued.exchange(true)) this->job_push(JOB_LOAD, output);
+	return;
+}
+
+void PlayoutEngine::io_worker_proc(void)
+{
+	std::pair<int, playout_output_t*> job;
+
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(this->job_mutex);
+
+			this->job_cond.wait(lock, [this]{ return (!this->jobs.empty() || this->job_shutdown); });
+			if(this->jobs.empty()) return;
+
+			job = this->jobs.front();
+			this->jobs.pop_front();
+		}
+
+		if(job.first == JOB_CLOSE) this->close_output(job.second);
+		else this->load_period(job.second);
+	}
+
+	return;
+}
+
+//Loads one period, then goes to the back of the queue, so every output gets its turn
+void PlayoutEngine::load_period(playout_output_t *output)
+{
+	AudioPlayback *pb_obj = output->pb_obj;
+	struct playout_slot *slot = nullptr;
+	size_t tail = output->ring_tail.load();
+
+	if(!output->load_done)
+	{
+		if(output->abort)
+		{
+			output->load_done = true;
+			this->writer_wake(output->n_writer);
+		}
+		else if((tail - output->ring_head.load()) < output->ring.size())
+		{
+			slot = &output->ring[tail%output->ring.size()];
+
+			pb_obj->loadout_buf = slot->buf;
+			pb_obj->buffer_load();
+
+			if(pb_obj->stop) output->load_done = true;
+			else
+			{
+				slot->file_pos = pb_obj->filein_pos;
+				slot->loop_wraps = pb_obj->loop_wraps;
+				slot->loop_begin = pb_obj->loop_begin;
+				slot->loop_end = pb_obj->loop_end;
+
+				output->ring_tail = tail + 1u;
+			}
+
+			this->writer_wake(output->n_writer);
+		}
+	}
+
+	output->load_queued = false;
+
+	//The writer may have freed a slot, or aborted, while this period was loading
+	if(output->load_done) return;
+	if(output->abort || ((output->ring_tail.load() - output->ring_head.load()) < output->ring.size())) this->load_request(output);
+
+	return;
+}
+
+void PlayoutEngine::close_output(playout_output_t *output)
+{
+	AudioPlayback *pb_obj = output->pb_obj;
+
+	//Drained or dropped by the writer already, so closing does not wait
+	snd_pcm_nonblock(pb_obj->audio_dev, 0);
+	pb_obj->playout_end();
+	return;
+}
+
+void PlayoutEngine::writer_proc(unsigned int n_writer)
+{
+	std::vector<playout_output_t*> own_outputs;
+	std::vector<struct pollfd> pollfds;
+	playout_output_t *output = nullptr;
+	snd_pcm_t *audio_dev = nullptr;
+	cpu_set_t cpuset;
+	std::uint64_t wake_count = 0u;
+	unsigned int n_cpus = std::thread::hardware_concurrency();
+	unsigned short revents = 0u;
+	size_t n_output = 0u;
+	size_t n_active = 0u;
+	size_t n_queued = 0u;
+	int n_ret = 0;
+	int timeout_ms = -1;
+	bool load_done = false;
+
+	//One writer per core. Best effort: the writer still runs if pinning is not allowed.
+	if(n_cpus > 0u)
+	{
+		CPU_ZERO(&cpuset);
+		CPU_SET(n_writer%n_cpus, &cpuset);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+	}
+
+	for(n_output = 0u; n_output < this->outputs.size(); n_output++)
+	{
+		if(this->outputs[n_output]->opened && (this->outputs[n_output]->n_writer == n_writer)) own_outputs.push_back(this->outputs[n_output]);
+	}
+
+	while(true)
+	{
+		pollfds.clear();
+		pollfds.push_back({this->wake_fd[n_writer], POLLIN, 0});
+
+		timeout_ms = -1;
+
+		for(n_output = 0u; n_output < own_outputs.size(); n_output++)
+		{
+			output = own_outputs[n_output];
+			audio_dev = output->pb_obj->audio_dev;
+			output->pollfd_count = 0u;
+
+			if(output->state == PLAYOUT_DONE) continue;
+
+			if(this->stop_request && !output->abort)
+			{
+				output->abort = true;
+				snd_pcm_drop(audio_dev);
+			}
+
+			//The load in progress has to finish before the output can be closed
+			if(output->abort)
+			{
+				if(output->load_done) this->output_finish(output);
+				else this->load_request(output);
+				continue;
+			}
+
+			if(output->state == PLAYOUT_DRAINING)
+			{
+				if(snd_pcm_state(audio_dev) != SND_PCM_STATE_DRAINING)
+				{
+					this->output_finish(output);
+					continue;
+				}
+
+				timeout_ms = PLAYOUT_DRAIN_POLL_MS;
+				continue;
+			}
+
+			//Read before the ring: once load_done is seen, every loaded period is visible too
+			load_done = output->load_done;
+			n_queued = output->ring_tail.load() - output->ring_head.load();
+
+			//The device starts with a full ring, so the first periods don't race the loader
+			if(output->state == PLAYOUT_PREFILL)
+			{
+				if((n_queued < output->ring.size()) && !load_done) continue;
+				output->state = PLAYOUT_RUNNING;
+			}
+
+			if(n_queued == 0u)
+			{
+				if(!load_done) continue;
+
+				n_ret = snd_pcm_drain(audio_dev);
+				if(n_ret == -EAGAIN)
+				{
+					output->state = PLAYOUT_DRAINING;
+					timeout_ms = PLAYOUT_DRAIN_POLL_MS;
+				}
+				else this->output_finish(output);
+
+				continue;
+			}
+
+			n_ret = snd_pcm_poll_descriptors_count(audio_dev);
+			if(n_ret <= 0) continue;
+
+			output->n_pollfd = pollfds.size();
+			pollfds.resize(pollfds.size() + (size_t) n_ret);
+
+			n_ret = snd_pcm_poll_descriptors(audio_dev, &pollfds[output->n_pollfd], (unsigned int) n_ret);
+			if(n_ret > 0) output->pollfd_count = (size_t) n_ret;
+		}
+
+		//Outputs that ended in this pass are not waited for
+		n_active = 0u;
+		for(n_output = 0u; n_output < own_outputs.size(); n_output++)
+		{
+			if(own_outputs[n_output]->state != PLAYOUT_DONE) n_active++;
+		}
+
+		if(n_active == 0u) break;
+
+		if(poll(pollfds.data(), pollfds.size(), timeout_ms) < 0)
+		{
+			if(errno == EINTR) continue;
+			this->stop_request = true;
+			continue;
+		}
+
+		if(pollfds[0].revents & POLLIN) read(this->wake_fd[n_writer], &wake_count, sizeof(wake_count));
+
+		for(n_output = 0u; n_output < own_outputs.size(); n_output++)
+		{
+			output = own_outputs[n_output];
+			if(output->pollfd_count == 0u) continue;
+
+			revents = 0u;
+			snd_pcm_poll_descriptors_revents(output->pb_obj->audio_dev, &pollfds[output->n_pollfd], (unsigned int) output->pollfd_count, &revents);
+			if(!(revents & (POLLOUT | POLLERR))) continue;
+
+			if(this->output_write(output)) continue;
+
+			output->abort = true;
+			snd_pcm_drop(output->pb_obj->audio_dev);
+			this->load_request(output);
+		}
+	}
+
+	return;
+}
+
+void PlayoutEngine::writer_wake(unsigned int n_writer)
+{
+	std::uint64_t wake_count = 1u;
+
+	if(n_writer >= this->wake_fd.size()) return;
+	if(this->wake_fd[n_writer] < 0) return;
+
+	write(this->wake_fd[n_writer], &wake_count, sizeof(wake_count));
+	return;
+}
+
+//Writes queued periods until the device is full. Returns false if the device failed.
+bool PlayoutEngine::output_write(playout_output_t *output)
+{
+	AudioPlayback *pb_obj = output->pb_obj;
+	struct playout_slot *slot = nullptr;
+	snd_pcm_sframes_t n_ret = 0;
+	size_t head = 0u;
+
+	while(true)
+	{
+		head = output->ring_head.load();
+		if(head == output->ring_tail.load()) return true;
+
+		slot = &output->ring[head%output->ring.size()];
+
+		n_ret = snd_pcm_writei(pb_obj->audio_dev, &slot->buf[output->write_frame*output->frame_size], (snd_pcm_uframes_t) (output->period_frames - output->write_frame));
+
+		if(n_ret == -EAGAIN) return true;
+
+		if(n_ret == -EPIPE)
+		{
+			pb_obj->st_xruns.store(pb_obj->st_xruns.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+			if(snd_pcm_prepare(pb_obj->audio_dev) >= 0) pb_obj->st_recoveries.store(pb_obj->st_recoveries.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+			continue;
+		}
+
+		if(n_ret < 0)
+		{
+			output->error_msg = "Playout Engine: could not write to audio device.";
+			return false;
+		}
+
+		output->write_frame += (size_t) n_ret;
+		pb_obj->frames_written += (std::uint64_t) n_ret;
+
+		if(output->write_frame < output->period_frames) continue;
+
+		output->write_frame = 0u;
+		pb_obj->position_update(slot->file_pos, slot->loop_wraps, slot->loop_begin, slot->loop_end);
+
+		output->ring_head = head + 1u;
+		this->load_request(output);
+	}
+
+	return true;
+}
+
+void PlayoutEngine::output_finish(playout_output_t *output)
+{
+	output->state = PLAYOUT_DONE;
+	this->job_push(JOB_CLOSE, output);
+	return;
+}
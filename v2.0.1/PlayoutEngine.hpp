@@ -0,0 +1,128 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef PLAYOUTENGINE_HPP
+#define PLAYOUTENGINE_HPP
+
+#include "AudioPlayback.hpp"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * Plays several AudioPlayback objects at once, each one on its own audio device, without a thread per device.
+ * Every device gets a ring of decoded periods. A small pool of I/O workers fills the rings (file reads and format
+ * conversion, through the objects' buffer_load), one period per job, so a slow file only holds up its own device.
+ * Writer threads, one per core by default, each own a share of the devices, opened non-blocking, and sleep in poll()
+ * on all of them until one can take more audio. Ended devices are drained without blocking.
+ * Seek and loop requests on the objects keep working. Continuous AudioMixer objects are not supported.
+ */
+
+#define PLAYOUT_RING_PERIODS 4u
+
+class PlayoutEngine {
+	public:
+		//0 threads picks the defaults: 2 I/O workers, one writer per core
+		PlayoutEngine(unsigned int n_io_workers, unsigned int n_writers, size_t ring_periods);
+		~PlayoutEngine(void);
+
+		//Call before run. The engine does not take ownership of pb_obj.
+		bool addOutput(AudioPlayback *pb_obj);
+		size_t getOutputCount(void);
+
+		//Plays every output to the end. Returns false if any output failed, the others still play.
+		bool run(void);
+		//Safe to call from any thread: stops every output right away, run then returns. Only stops the run in progress.
+		void stop(void);
+
+		std::string getLastErrorMessage(void);
+
+	private:
+		enum PlayoutState {
+			PLAYOUT_PREFILL = 0,
+			PLAYOUT_RUNNING = 1,
+			PLAYOUT_DRAINING = 2,
+			PLAYOUT_DONE = 3
+		};
+
+		enum JobType {
+			JOB_LOAD = 0,
+			JOB_CLOSE = 1
+		};
+
+		struct playout_slot {
+			std::uint8_t *buf;
+			//Input position and loop state after the period was loaded, for the position snapshot
+			__offset file_pos;
+			std::uint64_t loop_wraps;
+			__offset loop_begin;
+			__offset loop_end;
+		};
+
+		struct playout_output {
+			AudioPlayback *pb_obj;
+			unsigned int n_writer;
+			bool opened;
+			std::string error_msg;
+
+			size_t period_frames;
+			size_t period_bytes;
+			size_t frame_size;
+
+			//Single producer (the I/O worker loading it), single consumer (its writer)
+			std::vector<struct playout_slot> ring;
+			std::uint8_t *ringbuf;
+			std::atomic<size_t> ring_head{0u};
+			std::atomic<size_t> ring_tail{0u};
+
+			std::atomic<bool> load_queued{false};
+			std::atomic<bool> load_done{false}; //No more periods will be loaded: end of file, or aborted
+			std::atomic<bool> abort{false};
+
+			//Writer only
+			int state;
+			size_t write_frame; //Frames of the head slot already written
+			size_t n_pollfd;
+			size_t pollfd_count;
+		};
+
+		typedef struct playout_output playout_output_t;
+
+		unsigned int n_io_workers = 0u;
+		unsigned int n_writers = 0u;
+		size_t ring_periods = PLAYOUT_RING_PERIODS;
+
+		std::vector<playout_output_t*> outputs;
+		std::vector<int> wake_fd; //One eventfd per writer
+
+		std::string error_msg = "";
+
+		std::mutex job_mutex;
+		std::condition_variable job_cond;
+		std::deque<std::pair<int, playout_output_t*>> jobs;
+		bool job_shutdown = false;
+
+		std::atomic<bool> stop_request{false};
+
+		bool output_open(playout_output_t *output);
+		void output_free(playout_output_t *output);
+
+		void job_push(int type, playout_output_t *output);
+		void load_request(playout_output_t *output);
+		void io_worker_proc(void);
+		void load_period(playout_output_t *output);
+		void close_output(playout_output_t *output);
+
+		void writer_proc(unsigned int n_writer);
+		void writer_wake(unsigned int n_writer);
+		bool output_write(playout_output_t *output);
+		void output_finish(playout_output_t *output);
+};
+
+#endif //PLAYOUTENGINE_HPP
@@ -0,0 +1,84 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "StartupTrace.hpp"
+#include <time.h>
+
+void startup_trace_reset(startup_trace_t *trace)
+{
+	int n_phase = 0;
+
+	if(trace == nullptr) return;
+
+	for(n_phase = 0; n_phase < STARTUP_PHASE_COUNT; n_phase++) trace->tstamp_ns[n_phase] = -1;
+
+	return;
+}
+
+void startup_trace_mark(startup_trace_t *trace, int phase)
+{
+	struct timespec tspec;
+
+	if(trace == nullptr) return;
+	if((phase < 0) || (phase >= STARTUP_PHASE_COUNT)) return;
+
+	clock_gettime(CLOCK_MONOTONIC, &tspec);
+	trace->tstamp_ns[phase] = ((std::int64_t) tspec.tv_sec)*1000000000 + ((std::int64_t) tspec.tv_nsec);
+	return;
+}
+
+std::int64_t startup_trace_phase_ns(const startup_trace_t *trace, int phase)
+{
+	int n_phase = 0;
+
+	if(trace == nullptr) return -1;
+	if((phase <= 0) || (phase >= STARTUP_PHASE_COUNT)) return -1;
+	if(trace->tstamp_ns[phase] < 0) return -1;
+
+	//Phases that were not recorded (e.g. header parsing done ahead of time) are skipped over
+	for(n_phase = phase - 1; n_phase >= 0; n_phase--)
+	{
+		if(trace->tstamp_ns[n_phase] >= 0) return trace->tstamp_ns[phase] - trace->tstamp_ns[n_phase];
+	}
+
+	return -1;
+}
+
+const char *startup_phase_name(int phase)
+{
+	switch(phase)
+	{
+		case STARTUP_TRIGGER:
+			return "trigger";
+
+		case STARTUP_FILE_EXT_CHECK:
+			return "file_ext_check";
+
+		case STARTUP_FILE_OPEN:
+			return "file_open";
+
+		case STARTUP_FILE_GET_PARAMS:
+			return "file_get_params";
+
+		case STARTUP_FILEIN_OPEN:
+			return "filein_open";
+
+		case STARTUP_AUDIO_HW_INIT:
+			return "audio_hw_init";
+
+		case STARTUP_BUFFER_MALLOC:
+			return "buffer_malloc";
+
+		case STARTUP_PLAYBACK_INIT:
+			return "playback_init";
+
+		case STARTUP_FIRST_WRITE:
+			return "first_write";
+	}
+
+	return "unknown";
+}
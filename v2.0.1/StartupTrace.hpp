@@ -0,0 +1,46 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef STARTUPTRACE_HPP
+#define STARTUPTRACE_HPP
+
+#include "globaldef.h"
+#include <cstdint>
+
+/*
+ * Time-to-first-sample trace. Every phase records the CLOCK_MONOTONIC time at which it finished.
+ * STARTUP_TRIGGER is the reference point (the moment playback was requested).
+ */
+
+enum startup_phase {
+	STARTUP_TRIGGER = 0,
+	STARTUP_FILE_EXT_CHECK,
+	STARTUP_FILE_OPEN,
+	STARTUP_FILE_GET_PARAMS,
+	STARTUP_FILEIN_OPEN,
+	STARTUP_AUDIO_HW_INIT,
+	STARTUP_BUFFER_MALLOC,
+	STARTUP_PLAYBACK_INIT,
+	STARTUP_FIRST_WRITE,
+	STARTUP_PHASE_COUNT
+};
+
+struct startup_trace {
+	std::int64_t tstamp_ns[STARTUP_PHASE_COUNT];
+};
+
+typedef struct startup_trace startup_trace_t;
+
+void startup_trace_reset(startup_trace_t *trace);
+void startup_trace_mark(startup_trace_t *trace, int phase);
+
+//Time spent in a phase: from the end of the previous recorded phase to the end of this one. -1 if not recorded.
+std::int64_t startup_trace_phase_ns(const startup_trace_t *trace, int phase);
+
+const char *startup_phase_name(int phase);
+
+#endif //STARTUPTRACE_HPP
@@ -0,0 +1,241 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "StatsExporter.hpp"
+#include <cstdio>
+#include <chrono>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+StatsExporter::StatsExporter(AudioPlayback *pb_obj, const char *fileout_dir, int format, int interval_ms)
+{
+	this->pb_obj = pb_obj;
+	if(fileout_dir != nullptr) this->fileout_dir = fileout_dir;
+	this->format = format;
+	if(interval_ms > 0) this->interval_ms = interval_ms;
+}
+
+StatsExporter::~StatsExporter(void)
+{
+	this->stop();
+}
+
+bool StatsExporter::start(void)
+{
+	if(this->pb_obj == nullptr)
+	{
+		this->error_msg = "Stats Exporter: no playback object.";
+		return false;
+	}
+
+	if(this->fileout_dir.empty())
+	{
+		this->error_msg = "Stats Exporter: no output file.";
+		return false;
+	}
+
+	if(this->running) return true;
+
+	this->running = true;
+	this->prev_cpu_ns = 0;
+	this->prev_uptime_ns = 0;
+	this->export_thread = std::thread(&StatsExporter::export_proc, this);
+	return true;
+}
+
+void StatsExporter::stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->export_mutex);
+		if(!this->running) return;
+		this->running = false;
+	}
+
+	this->export_cond.notify_all();
+	this->export_thread.join();
+
+	this->export_write();
+	return;
+}
+
+std::string StatsExporter::getLastErrorMessage(void)
+{
+	return this->error_msg;
+}
+
+void StatsExporter::export_proc(void)
+{
+	struct sched_param sched;
+	std::unique_lock<std::mutex> lock(this->export_mutex);
+
+	//Keep out of the way of the playback thread: SCHED_IDLE where allowed, lowest nice value otherwise
+	sched.sched_priority = 0;
+	if(pthread_setschedparam(pthread_self(), SCHED_IDLE, &sched) != 0) setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), 19);
+
+	while(this->running)
+	{
+		this->export_cond.wait_for(lock, std::chrono::milliseconds(this->interval_ms));
+		if(!this->running) break;
+
+		lock.unlock();
+		this->export_write();
+		lock.lock();
+	}
+
+	return;
+}
+
+bool StatsExporter::export_write(void)
+{
+	audio_playback_stats_t stats;
+	std::string text = "";
+	std::string tmp_dir = this->fileout_dir + ".tmp";
+	std::FILE *fileout = nullptr;
+	double cpu_load = 0.0;
+
+	if(!this->pb_obj->getStats(&stats)) return false;
+
+	if(stats.uptime_ns > this->prev_uptime_ns) cpu_load = ((double) (stats.cpu_ns - this->prev_cpu_ns))/((double) (stats.uptime_ns - this->prev_uptime_ns));
+
+	this->prev_cpu_ns = stats.cpu_ns;
+	this->prev_uptime_ns = stats.uptime_ns;
+
+	if(this->format == STATS_FORMAT_PROMETHEUS) text = this->format_prometheus(&stats, cpu_load);
+	else text = this->format_json(&stats, cpu_load);
+
+	fileout = std::fopen(tmp_dir.c_str(), "w");
+	if(fileout == nullptr)
+	{
+		this->error_msg = "Stats Exporter: could not open output file.";
+		return false;
+	}
+
+	std::fwrite(text.c_str(), 1, text.size(), fileout);
+
+	if(std::fclose(fileout) != 0)
+	{
+		this->error_msg = "Stats Exporter: could not write output file.";
+		std::remove(tmp_dir.c_str());
+		return false;
+	}
+
+	if(std::rename(tmp_dir.c_str(), this->fileout_dir.c_str()) != 0)
+	{
+		this->error_msg = "Stats Exporter: could not replace output file.";
+		std::remove(tmp_dir.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+std::string StatsExporter::format_json(const audio_playback_stats_t *stats, double cpu_load)
+{
+	char textbuf[1024];
+	double read_mean = 0.0;
+
+	if(stats->reads > 0u) read_mean = ((double) stats->read_ns_total)/((double) stats->reads)/1000.0;
+
+	std::snprintf(textbuf, sizeof(textbuf),
+		"{\n"
+		"  \"running\": %s,\n"
+		"  \"uptime_seconds\": %.3f,\n"
+		"  \"frames_written\": %llu,\n"
+		"  \"frames_played\": %llu,\n"
+		"  \"bytes_read\": %llu,\n"
+		"  \"reads\": %llu,\n"
+		"  \"read_latency_mean_us\": %.3f,\n"
+		"  \"read_latency_max_us\": %.3f,\n"
+		"  \"xruns\": %llu,\n"
+		"  \"recoveries\": %llu,\n"
+		"  \"ring_frames\": %lld,\n"
+		"  \"ring_capacity_frames\": %lld,\n"
+		"  \"cpu_seconds\": %.6f,\n"
+		"  \"cpu_seconds_per_second\": %.6f\n"
+		"}\n",
+		(stats->running ? "true" : "false"),
+		((double) stats->uptime_ns)/1000000000.0,
+		(unsigned long long) stats->frames_written,
+		(unsigned long long) stats->frames_played,
+		(unsigned long long) stats->bytes_read,
+		(unsigned long long) stats->reads,
+		read_mean,
+		((double) stats->read_ns_max)/1000.0,
+		(unsigned long long) stats->xruns,
+		(unsigned long long) stats->recoveries,
+		(long long) stats->ring_frames,
+		(long long) stats->ring_capacity,
+		((double) stats->cpu_ns)/1000000000.0,
+		cpu_load);
+
+	return std::string(textbuf);
+}
+
+std::string StatsExporter::format_prometheus(const audio_playback_stats_t *stats, double cpu_load)
+{
+	char textbuf[2048];
+
+	std::snprintf(textbuf, sizeof(textbuf),
+		"# HELP audio_playback_running Whether playback is running.\n"
+		"# TYPE audio_playback_running gauge\n"
+		"audio_playback_running %d\n"
+		"# HELP audio_playback_uptime_seconds Time since playback started.\n"
+		"# TYPE audio_playback_uptime_seconds gauge\n"
+		"audio_playback_uptime_seconds %.3f\n"
+		"# HELP audio_playback_frames_written_total Frames handed to the audio device.\n"
+		"# TYPE audio_playback_frames_written_total counter\n"
+		"audio_playback_frames_written_total %llu\n"
+		"# HELP audio_playback_frames_played_total Frames played by the audio device.\n"
+		"# TYPE audio_playback_frames_played_total counter\n"
+		"audio_playback_frames_played_total %llu\n"
+		"# HELP audio_playback_read_bytes_total Bytes read from the input files.\n"
+		"# TYPE audio_playback_read_bytes_total counter\n"
+		"audio_playback_read_bytes_total %llu\n"
+		"# HELP audio_playback_read_seconds Time spent in input file reads.\n"
+		"# TYPE audio_playback_read_seconds summary\n"
+		"audio_playback_read_seconds_sum %.9f\n"
+		"audio_playback_read_seconds_count %llu\n"
+		"# HELP audio_playback_read_max_seconds Slowest input file read.\n"
+		"# TYPE audio_playback_read_max_seconds gauge\n"
+		"audio_playback_read_max_seconds %.9f\n"
+		"# HELP audio_playback_xruns_total Underruns reported by the audio device.\n"
+		"# TYPE audio_playback_xruns_total counter\n"
+		"audio_playback_xruns_total %llu\n"
+		"# HELP audio_playback_recoveries_total Successful recoveries from an underrun.\n"
+		"# TYPE audio_playback_recoveries_total counter\n"
+		"audio_playback_recoveries_total %llu\n"
+		"# HELP audio_playback_ring_frames Frames queued in the audio device.\n"
+		"# TYPE audio_playback_ring_frames gauge\n"
+		"audio_playback_ring_frames %lld\n"
+		"# HELP audio_playback_ring_capacity_frames Audio device buffer size.\n"
+		"# TYPE audio_playback_ring_capacity_frames gauge\n"
+		"audio_playback_ring_capacity_frames %lld\n"
+		"# HELP audio_playback_cpu_seconds_total CPU time used by the playback thread.\n"
+		"# TYPE audio_playback_cpu_seconds_total counter\n"
+		"audio_playback_cpu_seconds_total %.6f\n"
+		"# HELP audio_playback_cpu_load CPU seconds per realtime second over the last export interval.\n"
+		"# TYPE audio_playback_cpu_load gauge\n"
+		"audio_playback_cpu_load %.6f\n",
+		(stats->running ? 1 : 0),
+		((double) stats->uptime_ns)/1000000000.0,
+		(unsigned long long) stats->frames_written,
+		(unsigned long long) stats->frames_played,
+		(unsigned long long) stats->bytes_read,
+		((double) stats->read_ns_total)/1000000000.0,
+		(unsigned long long) stats->reads,
+		((double) stats->read_ns_max)/1000000000.0,
+		(unsigned long long) stats->xruns,
+		(unsigned long long) stats->recoveries,
+		(long long) stats->ring_frames,
+		(long long) stats->ring_capacity,
+		((double) stats->cpu_ns)/1000000000.0,
+		cpu_load);
+
+	return std::string(textbuf);
+}
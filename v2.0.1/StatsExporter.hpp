@@ -0,0 +1,59 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef STATSEXPORTER_HPP
+#define STATSEXPORTER_HPP
+
+#include "AudioPlayback.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * Periodically writes the stats of an AudioPlayback object to a file, from a thread running at idle priority.
+ * The file is replaced atomically (written to <file>.tmp, then renamed), so it can be read at any time,
+ * e.g. by the Prometheus node_exporter textfile collector. A last update is written when the exporter stops.
+ */
+
+#define STATS_FORMAT_JSON 1
+#define STATS_FORMAT_PROMETHEUS 2
+
+class StatsExporter {
+	public:
+		//format is STATS_FORMAT_JSON or STATS_FORMAT_PROMETHEUS
+		StatsExporter(AudioPlayback *pb_obj, const char *fileout_dir, int format, int interval_ms);
+		~StatsExporter(void);
+
+		bool start(void);
+		void stop(void);
+
+		std::string getLastErrorMessage(void);
+
+	private:
+		AudioPlayback *pb_obj = nullptr;
+		std::string fileout_dir = "";
+		int format = STATS_FORMAT_JSON;
+		int interval_ms = 10000;
+
+		std::string error_msg = "";
+
+		std::thread export_thread;
+		std::mutex export_mutex;
+		std::condition_variable export_cond;
+		bool running = false;
+
+		//Previous sample, for CPU time per realtime second over the last interval
+		std::int64_t prev_cpu_ns = 0;
+		std::int64_t prev_uptime_ns = 0;
+
+		void export_proc(void);
+		bool export_write(void);
+		std::string format_json(const audio_playback_stats_t *stats, double cpu_load);
+		std::string format_prometheus(const audio_playback_stats_t *stats, double cpu_load);
+};
+
+#endif //STATSEXPORTER_HPP
@@ -0,0 +1,533 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "WaveHeader.hpp"
+#include <cerrno>
+
+#define BYTEBUF_SIZE 4096U
+#define FMT_CHUNK_SIZE 64U
+
+//"smpl": 36 byte header, then 24 byte loops. "cue ": point count, then 24 byte points.
+#define SMPL_HEADER_SIZE 36U
+#define SMPL_LOOP_SIZE 24U
+#define CUE_POINT_SIZE 24U
+//Larger "cue " and LIST chunks are only read this far
+#define LOOP_CHUNK_MAX 0x10000U
+
+/*
+ * Sony Wave64: chunks are identified by GUIDs and sized in 64 bits. The first 4 bytes of the GUIDs spell the
+ * RIFF names. A chunk header is a GUID and a size that counts the header itself (24 bytes), chunks are 8 byte aligned.
+ */
+#define W64_HEADER_SIZE 40U
+#define W64_CHUNK_HEADER_SIZE 24U
+
+static const std::uint8_t W64_GUID_RIFF[16] = {0x72, 0x69, 0x66, 0x66, 0x2e, 0x91, 0xcf, 0x11, 0xa5, 0xd6, 0x28, 0xdb, 0x04, 0xc1, 0x00, 0x00};
+static const std::uint8_t W64_GUID_WAVE[16] = {0x77, 0x61, 0x76, 0x65, 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a};
+static const std::uint8_t W64_GUID_FMT[16] = {0x66, 0x6d, 0x74, 0x20, 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a};
+static const std::uint8_t W64_GUID_DATA[16] = {0x64, 0x61, 0x74, 0x61, 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a};
+
+static int w64_get_params(int fd, audio_playback_params_t *params);
+static void riff_get_loop(int fd, bool big_endian, audio_playback_params_t *params);
+static std::uint32_t cue_find_offset(const char *cue_chunk, size_t cue_size, std::uint32_t cue_id, bool big_endian);
+static int fmt_get_params(const char *fmt_chunk, bool big_endian, audio_playback_params_t *params);
+
+//Header fields are little-endian in RIFF files and big-endian in RIFX files
+static inline std::uint16_t field_u16(const char *bytes, bool big_endian)
+{
+	std::uint16_t value = 0u;
+
+	memcpy(&value, bytes, 2u);
+	return big_endian ? __builtin_bswap16(value) : value;
+}
+
+static inline std::uint32_t field_u32(const char *bytes, bool big_endian)
+{
+	std::uint32_t value = 0u;
+
+	memcpy(&value, bytes, 4u);
+	return big_endian ? __builtin_bswap32(value) : value;
+}
+static bool stream_read(int fd, void *buf, size_t n_bytes);
+static bool stream_skip(int fd, std::uint64_t n_bytes);
+
+bool file_ext_check(const char *filein_dir)
+{
+	if(filein_dir == nullptr) return false;
+
+	size_t len = 0u;
+	while(filein_dir[len] != '\0') len++;
+
+	if(len < 5u) return false;
+
+	if(compare_signature(".wav", filein_dir, (len - 4u))) return true;
+	if(compare_signature(".WAV", filein_dir, (len - 4u))) return true;
+	if(compare_signature(".w64", filein_dir, (len - 4u))) return true;
+	if(compare_signature(".W64", filein_dir, (len - 4u))) return true;
+
+	return false;
+}
+
+int file_open(const char *filein_dir)
+{
+	if(filein_dir == nullptr) return -1;
+
+	return open(filein_dir, O_RDONLY);
+}
+
+void file_close(int fd)
+{
+	if(fd < 0) return;
+
+	close(fd);
+	return;
+}
+
+int file_get_params(int fd, audio_playback_params_t *params)
+{
+	char *header_info = nullptr;
+
+	size_t bytepos = 0u;
+	int format = -1;
+	bool big_endian = false;
+
+	if(fd < 0) return -1;
+	if(params == nullptr) return -1;
+
+	params->loop_begin_frame = 0u;
+	params->loop_end_frame = 0u;
+	params->loop_count = 0;
+
+	header_info = (char*) std::malloc(BYTEBUF_SIZE);
+	memset(header_info, 0, BYTEBUF_SIZE);
+
+	__LSEEK(fd, 0, SEEK_SET);
+	read(fd, header_info, BYTEBUF_SIZE);
+
+	//Wave64: chunks may be anywhere in the file, they are walked with reads rather than from this buffer
+	if((memcmp(header_info, W64_GUID_RIFF, 16u) == 0) && (memcmp(&header_info[24], W64_GUID_WAVE, 16u) == 0))
+	{
+		std::free(header_info);
+		return w64_get_params(fd, params);
+	}
+
+	//RIFX: same layout as RIFF, with every field and sample big-endian
+	if(compare_signature("RIFX", header_info, 0u)) big_endian = true;
+
+	//Error Check: Invalid Chunk Signature
+	else if(!compare_signature("RIFF", header_info, 0u))
+	{
+		std::free(header_info);
+		return -1;
+	}
+
+	//Error Check: Invalid Format Signature
+	if(!compare_signature("WAVE", header_info, 8u))
+	{
+		std::free(header_info);
+		return -1;
+	}
+
+	bytepos = 12u;
+
+	//Fetch "fmt " Subchunk
+	while(!compare_signature("fmt ", header_info, bytepos))
+	{
+		//Error: subchunk "fmt " not found
+		if(bytepos > (BYTEBUF_SIZE - 256u))
+		{
+			std::free(header_info);
+			return -1;
+		}
+
+		bytepos += (size_t) (field_u32(&header_info[bytepos + 4u], big_endian) + 8u);
+	}
+
+	format = fmt_get_params(&header_info[bytepos + 8u], big_endian, params);
+
+	bytepos += (size_t) (field_u32(&header_info[bytepos + 4u], big_endian) + 8u);
+
+	//Fetch "data" Subchunk
+	while(!compare_signature("data", header_info, bytepos))
+	{
+		//Error: subchunk "data" not found
+		if(bytepos > (BYTEBUF_SIZE - 256u))
+		{
+			std::free(header_info);
+			return -1;
+		}
+
+		bytepos += (size_t) (field_u32(&header_info[bytepos + 4u], big_endian) + 8u);
+	}
+
+	params->audio_data_begin = (__offset) (bytepos + 8u);
+	params->audio_data_end = params->audio_data_begin + ((__offset) field_u32(&header_info[bytepos + 4u], big_endian));
+
+	std::free(header_info);
+
+	if(format >= 0) riff_get_loop(fd, big_endian, params);
+	return format;
+}
+
+int stream_get_params(int fd, audio_playback_params_t *params)
+{
+	char chunk_header[12];
+	char fmt_chunk[FMT_CHUNK_SIZE];
+	std::uint32_t chunk_size = 0u;
+	__offset bytepos = 0;
+	int format = -1;
+	bool fmt_found = false;
+	bool big_endian = false;
+
+	if(fd < 0) return -1;
+	if(params == nullptr) return -1;
+
+	params->loop_begin_frame = 0u;
+	params->loop_end_frame = 0u;
+	params->loop_count = 0;
+
+	if(!stream_read(fd, chunk_header, 12u)) return -1;
+	if(compare_signature("RIFX", chunk_header, 0u)) big_endian = true;
+	else if(!compare_signature("RIFF", chunk_header, 0u)) return -1;
+	if(!compare_signature("WAVE", chunk_header, 8u)) return -1;
+
+	bytepos = 12;
+
+	while(true)
+	{
+		if(!stream_read(fd, chunk_header, 8u)) return -1;
+		bytepos += 8;
+
+		chunk_size = field_u32(&chunk_header[4], big_endian);
+		if(compare_signature("data", chunk_header, 0u)) break;
+
+		//Chunks are padded to an even size
+		if(chunk_size & 1u) chunk_size++;
+
+		if(compare_signature("fmt ", chunk_header, 0u) && (chunk_size >= 16u))
+		{
+			memset(fmt_chunk, 0, FMT_CHUNK_SIZE);
+			if(!stream_read(fd, fmt_chunk, (chunk_size < FMT_CHUNK_SIZE) ? chunk_size : FMT_CHUNK_SIZE)) return -1;
+			if((chunk_size > FMT_CHUNK_SIZE) && !stream_skip(fd, chunk_size - FMT_CHUNK_SIZE)) return -1;
+
+			format = fmt_get_params(fmt_chunk, big_endian, params);
+			fmt_found = true;
+		}
+		else if(!stream_skip(fd, chunk_size)) return -1;
+
+		bytepos += (__offset) chunk_size;
+	}
+
+	//Error: "data" before "fmt "
+	if(!fmt_found) return -1;
+
+	params->audio_data_begin = bytepos;
+
+	if((chunk_size == WAVE_DATA_SIZE_UNKNOWN) || (chunk_size == 0u)) params->audio_data_end = WAVE_STREAM_DATA_END;
+	else params->audio_data_end = params->audio_data_begin + ((__offset) chunk_size);
+
+	return format;
+}
+
+static int w64_get_params(int fd, audio_playback_params_t *params)
+{
+	std::uint8_t chunk_header[W64_CHUNK_HEADER_SIZE];
+	char fmt_chunk[FMT_CHUNK_SIZE];
+	std::uint64_t chunk_size = 0u;
+	std::uint64_t n_bytes = 0u;
+	__offset bytepos = W64_HEADER_SIZE;
+	int format = -1;
+	bool fmt_found = false;
+
+	while(true)
+	{
+		//Error: chunk "data" not found
+		if(__PREAD(fd, chunk_header, W64_CHUNK_HEADER_SIZE, bytepos) != ((ssize_t) W64_CHUNK_HEADER_SIZE)) return -1;
+
+		memcpy(&chunk_size, &chunk_header[16], 8u);
+
+		//Error: broken chunk size, the walk would never end
+		if(chunk_size < W64_CHUNK_HEADER_SIZE) return -1;
+
+		if(memcmp(chunk_header, W64_GUID_DATA, 16u) == 0) break;
+
+		if((memcmp(chunk_header, W64_GUID_FMT, 16u) == 0) && (chunk_size >= (W64_CHUNK_HEADER_SIZE + 16u)))
+		{
+			n_bytes = chunk_size - W64_CHUNK_HEADER_SIZE;
+			if(n_bytes > FMT_CHUNK_SIZE) n_bytes = FMT_CHUNK_SIZE;
+
+			memset(fmt_chunk, 0, FMT_CHUNK_SIZE);
+			if(__PREAD(fd, fmt_chunk, (size_t) n_bytes, bytepos + W64_CHUNK_HEADER_SIZE) != ((ssize_t) n_bytes)) return -1;
+
+			format = fmt_get_params(fmt_chunk, false, params);
+			fmt_found = true;
+		}
+
+		bytepos += (__offset) ((chunk_size + 7u) & ~((std::uint64_t) 7u));
+	}
+
+	//Error: chunk "data" before "fmt "
+	if(!fmt_found) return -1;
+
+	params->audio_data_begin = bytepos + W64_CHUNK_HEADER_SIZE;
+	params->audio_data_end = bytepos + ((__offset) chunk_size);
+
+	return format;
+}
+
+//Walks every chunk of a RIFF file for its loop. Leaves the loop fields as they are if the file has none.
+static void riff_get_loop(int fd, bool big_endian, audio_playback_params_t *params)
+{
+	char chunk_header[8];
+	char smpl_chunk[SMPL_HEADER_SIZE + SMPL_LOOP_SIZE];
+	char *cue_chunk = nullptr;
+	char *list_chunk = nullptr;
+	std::uint32_t chunk_size = 0u;
+	std::uint32_t cue_size = 0u;
+	std::uint32_t list_size = 0u;
+	std::uint32_t n_loops = 0u;
+	std::uint32_t loop_start = 0u;
+	std::uint32_t loop_end = 0u;
+	std::uint32_t play_count = 0u;
+	std::uint32_t cue_id = 0u;
+	std::uint32_t cue_offset = 0u;
+	std::uint32_t region_length = 0u;
+	std::uint32_t sub_size = 0u;
+	__offset bytepos = 12;
+	size_t listpos = 0u;
+	bool smpl_loop = false;
+
+	while(__PREAD(fd, chunk_header, 8u, bytepos) == 8)
+	{
+		chunk_size = field_u32(&chunk_header[4], big_endian);
+
+		//Nothing after a "data" chunk of unknown size can be found
+		if(compare_signature("data", chunk_header, 0u) && (chunk_size == WAVE_DATA_SIZE_UNKNOWN)) break;
+
+		if(compare_signature("smpl", chunk_header, 0u) && (chunk_size >= (SMPL_HEADER_SIZE + SMPL_LOOP_SIZE)))
+		{
+			if(__PREAD(fd, smpl_chunk, SMPL_HEADER_SIZE + SMPL_LOOP_SIZE, bytepos + 8) == ((ssize_t) (SMPL_HEADER_SIZE + SMPL_LOOP_SIZE)))
+			{
+				n_loops = field_u32(&smpl_chunk[28], big_endian);
+				loop_start = field_u32(&smpl_chunk[SMPL_HEADER_SIZE + 8u], big_endian);
+				loop_end = field_u32(&smpl_chunk[SMPL_HEADER_SIZE + 12u], big_endian);
+				play_count = field_u32(&smpl_chunk[SMPL_HEADER_SIZE + 20u], big_endian);
+
+				//dwEnd is the last frame played. dwPlayCount is how many times the loop plays in all (0 loops forever),
+				//loop_count how many times it repeats after the first: a play count of 1 plays it once, with no repeat.
+				if((n_loops > 0u) && (loop_end >= loop_start))
+				{
+					params->loop_begin_frame = (std::uint64_t) loop_start;
+					params->loop_end_frame = ((std::uint64_t) loop_end) + 1u;
+					params->loop_count = (play_count == 0u) ? -1 : (((play_count - 1u) > INT32_MAX) ? INT32_MAX : ((int) (play_count - 1u)));
+					smpl_loop = true;
+
+					//"smpl" takes precedence over cue regions
+					break;
+				}
+			}
+		}
+		else if(compare_signature("cue ", chunk_header, 0u) && (cue_chunk == nullptr) && (chunk_size >= 4u))
+		{
+			cue_size = (chunk_size < LOOP_CHUNK_MAX) ? chunk_size : LOOP_CHUNK_MAX;
+			cue_chunk = (char*) std::malloc(cue_size);
+			if(__PREAD(fd, cue_chunk, cue_size, bytepos + 8) != ((ssize_t) cue_size)) cue_size = 0u;
+		}
+		else if(compare_signature("LIST", chunk_header, 0u) && (list_chunk == nullptr) && (chunk_size >= 4u))
+		{
+			list_size = (chunk_size < LOOP_CHUNK_MAX) ? chunk_size : LOOP_CHUNK_MAX;
+			list_chunk = (char*) std::malloc(list_size);
+			if(__PREAD(fd, list_chunk, list_size, bytepos + 8) != ((ssize_t) list_size)) list_size = 0u;
+
+			//Other LIST chunks ("INFO") hold no cue regions
+			if((list_size == 0u) || !compare_signature("adtl", list_chunk, 0u))
+			{
+				std::free(list_chunk);
+				list_chunk = nullptr;
+			}
+		}
+
+		//Chunks are padded to an even size
+		bytepos += 8 + ((__offset) chunk_size) + ((__offset) (chunk_size & 1u));
+	}
+
+	//No "smpl" loop: the first labeled region ("ltxt" with a length) whose cue point exists
+	if(!smpl_loop && (cue_chunk != nullptr) && (list_chunk != nullptr))
+	{
+		listpos = 4u;
+
+		while((listpos + 16u) <= list_size)
+		{
+			sub_size = field_u32(&list_chunk[listpos + 4u], big_endian);
+
+			if(compare_signature("ltxt", list_chunk, listpos) && (sub_size >= 8u))
+			{
+				cue_id = field_u32(&list_chunk[listpos + 8u], big_endian);
+				region_length = field_u32(&list_chunk[listpos + 12u], big_endian);
+
+				cue_offset = cue_find_offset(cue_chunk, cue_size, cue_id, big_endian);
+
+				if((region_length > 0u) && (cue_offset != UINT32_MAX))
+				{
+					params->loop_begin_frame = (std::uint64_t) cue_offset;
+					params->loop_end_frame = ((std::uint64_t) cue_offset) + ((std::uint64_t) region_length);
+					params->loop_count = -1;
+					break;
+				}
+			}
+
+			listpos += 8u + ((size_t) sub_size) + ((size_t) (sub_size & 1u));
+		}
+	}
+
+	if(cue_chunk != nullptr) std::free(cue_chunk);
+	if(list_chunk != nullptr) std::free(list_chunk);
+	return;
+}
+
+//Returns the sample offset (dwSampleOffset) of the cue point cue_id, or UINT32_MAX if there is none
+static std::uint32_t cue_find_offset(const char *cue_chunk, size_t cue_size, std::uint32_t cue_id, bool big_endian)
+{
+	std::uint32_t n_points = 0u;
+	std::uint32_t point_id = 0u;
+	size_t bytepos = 4u;
+
+	if(cue_size < 4u) return UINT32_MAX;
+
+	n_points = field_u32(cue_chunk, big_endian);
+
+	while((n_points > 0u) && ((bytepos + CUE_POINT_SIZE) <= cue_size))
+	{
+		point_id = field_u32(&cue_chunk[bytepos], big_endian);
+
+		if(point_id == cue_id)
+		{
+			return field_u32(&cue_chunk[bytepos + 20u], big_endian);
+		}
+
+		bytepos += CUE_POINT_SIZE;
+		n_points--;
+	}
+
+	return UINT32_MAX;
+}
+
+//fmt_chunk: the "fmt " chunk body, at least FMT_CHUNK_SIZE bytes. Returns one of the PB_ format codes, or -1.
+static int fmt_get_params(const char *fmt_chunk, bool big_endian, audio_playback_params_t *params)
+{
+	std::uint16_t format_tag = 0u;
+	std::uint16_t n_channels = 0u;
+	std::uint32_t bit_depth = 0u;
+
+	format_tag = field_u16(&fmt_chunk[0u], big_endian);
+	n_channels = field_u16(&fmt_chunk[2u], big_endian);
+
+	//WAVE_FORMAT_EXTENSIBLE: the format tag is the first field of the SubFormat GUID. The channel mask is not used, channels are taken in WAVE order.
+	if(format_tag == WAVE_FORMAT_EXTENSIBLE) format_tag = field_u16(&fmt_chunk[24u], big_endian);
+
+	params->big_endian = big_endian;
+
+	//Error Check: Encoding Format Not Supported
+	switch(format_tag)
+	{
+		case WAVE_FORMAT_PCM:
+		case WAVE_FORMAT_ALAW:
+		case WAVE_FORMAT_MULAW:
+		case WAVE_FORMAT_IMA_ADPCM:
+			break;
+
+		default:
+			return -1;
+	}
+
+	params->sample_rate = field_u32(&fmt_chunk[4u], big_endian);
+
+	params->block_align = field_u16(&fmt_chunk[12u], big_endian);
+	bit_depth = field_u16(&fmt_chunk[14u], big_endian);
+
+	//IMA ADPCM "fmt " extension: cbSize, then samples per block
+	params->samples_per_block = field_u16(&fmt_chunk[18u], big_endian);
+
+	params->n_channels = n_channels;
+
+	//16bit PCM with more than 2 channels goes through a channel matrix
+	if((format_tag == WAVE_FORMAT_PCM) && (bit_depth == 16u) && (n_channels > 2u) && (n_channels <= CHANNEL_MATRIX_MAX_CHANNELS)) return PB_16BITNCH;
+
+	if((n_channels != 1u) && (n_channels != 2u)) return -1;
+
+	if(format_tag == WAVE_FORMAT_ALAW) return PB_G711ALAW;
+	if(format_tag == WAVE_FORMAT_MULAW) return PB_G711ULAW;
+
+	if(format_tag == WAVE_FORMAT_IMA_ADPCM)
+	{
+		//Error: IMA ADPCM blocks are only defined little-endian
+		if(big_endian) return -1;
+
+		//Every block carries a 4 byte header per channel, followed by 4 bit samples in groups of 4 bytes per channel
+		if(params->block_align <= (4u*n_channels)) return -1;
+		if((params->block_align % (4u*n_channels)) != 0u) return -1;
+		if(params->samples_per_block != (((params->block_align - 4u*n_channels)*2u)/n_channels + 1u)) return -1;
+
+		return PB_IMAADPCM;
+	}
+
+	if((bit_depth == 8u) && (n_channels == 1u)) return PB_8BIT1CH;
+	if((bit_depth == 8u) && (n_channels == 2u)) return PB_8BIT2CH;
+	if((bit_depth == 16u) && (n_channels == 1u)) return PB_16BIT1CH;
+	if((bit_depth == 16u) && (n_channels == 2u)) return PB_16BIT2CH;
+	if((bit_depth == 24u) && (n_channels == 1u)) return PB_24BIT1CH;
+	if((bit_depth == 24u) && (n_channels == 2u)) return PB_24BIT2CH;
+
+	return -1;
+}
+
+static bool stream_read(int fd, void *buf, size_t n_bytes)
+{
+	std::uint8_t *bytebuf = (std::uint8_t*) buf;
+	size_t n_done = 0u;
+	ssize_t n_read = 0;
+
+	//Pipes return whatever is there, not necessarily n_bytes
+	while(n_done < n_bytes)
+	{
+		n_read = read(fd, &bytebuf[n_done], n_bytes - n_done);
+		if((n_read < 0) && (errno == EINTR)) continue;
+		if(n_read <= 0) return false;
+
+		n_done += (size_t) n_read;
+	}
+
+	return true;
+}
+
+static bool stream_skip(int fd, std::uint64_t n_bytes)
+{
+	char bytebuf[BYTEBUF_SIZE];
+	size_t n_chunk = 0u;
+
+	while(n_bytes > 0u)
+	{
+		n_chunk = (n_bytes < BYTEBUF_SIZE) ? ((size_t) n_bytes) : BYTEBUF_SIZE;
+		if(!stream_read(fd, bytebuf, n_chunk)) return false;
+
+		n_bytes -= (std::uint64_t) n_chunk;
+	}
+
+	return true;
+}
+
+bool compare_signature(const char *auth, const char *bytebuf, size_t offset)
+{
+	if(auth == nullptr) return false;
+	if(bytebuf == nullptr) return false;
+
+	if(auth[0] != bytebuf[offset]) return false;
+	if(auth[1] != bytebuf[offset + 1u]) return false;
+	if(auth[2] != bytebuf[offset + 2u]) return false;
+	if(auth[3] != bytebuf[offset + 3u]) return false;
+
+	return true;
+}
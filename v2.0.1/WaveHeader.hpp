@@ -0,0 +1,61 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#ifndef WAVEHEADER_HPP
+#define WAVEHEADER_HPP
+
+#include "globaldef.h"
+#include "AudioPlayback.hpp"
+
+#define PB_16BIT1CH 1
+#define PB_16BIT2CH 2
+#define PB_24BIT1CH 3
+#define PB_24BIT2CH 4
+#define PB_G711ALAW 5
+#define PB_G711ULAW 6
+#define PB_IMAADPCM 7
+#define PB_8BIT1CH 8
+#define PB_8BIT2CH 9
+//16bit PCM with 3 to CHANNEL_MATRIX_MAX_CHANNELS channels, or any 16bit PCM file played through a channel matrix
+#define PB_16BITNCH 10
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_ALAW 0x0006
+#define WAVE_FORMAT_MULAW 0x0007
+#define WAVE_FORMAT_IMA_ADPCM 0x0011
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+//"data" size written by programs that do not know it yet (0 is taken the same way on a stream)
+#define WAVE_DATA_SIZE_UNKNOWN 0xFFFFFFFFu
+//audio_data_end of a stream of unknown size: the audio data ends where the stream does
+#define WAVE_STREAM_DATA_END ((__offset) INT64_MAX)
+
+//Accepts .wav and .w64 (Sony Wave64) files
+bool file_ext_check(const char *filein_dir);
+
+int file_open(const char *filein_dir);
+void file_close(int fd);
+
+/*
+ * Parses the header of an already open file, RIFF or Wave64. Returns one of the PB_ format codes, or -1 if the format is not supported.
+ * RIFX files (RIFF with every header field and sample big-endian) are parsed too, and set big_endian.
+ * The loop of a RIFF file comes from the first loop of its "smpl" chunk or, without one, from the first "cue " point
+ * given a length by a "ltxt" entry of a LIST "adtl" chunk. Both may come after the audio data.
+ */
+int file_get_params(int fd, audio_playback_params_t *params);
+
+/*
+ * Parses the header of a stream (pipe or socket) front to back, with no seek. Chunks before "data" are read and
+ * discarded. On return, fd is at the first byte of the audio data, audio_data_begin is the number of bytes read so
+ * far, and audio_data_end is WAVE_STREAM_DATA_END if the stream does not tell the data size. Streams have no loop.
+ * RIFX streams are parsed as in file_get_params.
+ */
+int stream_get_params(int fd, audio_playback_params_t *params);
+
+bool compare_signature(const char *auth, const char *bytebuf, size_t offset);
+
+#endif //WAVEHEADER_HPP
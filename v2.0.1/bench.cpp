@@ -0,0 +1,281 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Conversion kernel microbenchmark.
+ * Runs every buffer_load conversion kernel over synthetic buffers, for a range of period sizes,
+ * and compares it against a memcpy of the same output size.
+ * Build with different CXXFLAGS (e.g. make bench CXXFLAGS="-O2 -mssse3") to compare SIMD variants.
+ */
+
+#include "globaldef.h"
+#include "AudioConvert.hpp"
+#include "ChannelMatrix.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC
+#endif
+
+#define BENCH_MIN_TIME_NS 20000000
+#define BENCH_RUNS 5
+//Largest frame of any kernel: 8 channels of 16bit samples
+#define BENCH_MAX_FRAME_SIZE 16u
+
+struct bench_kernel {
+	const char *name;
+	size_t in_frame_size;
+	size_t out_frame_size;
+	unsigned int out_channels;
+	void (*run)(void *out, const void *in, size_t n_frames);
+};
+
+typedef struct bench_kernel bench_kernel_t;
+
+//Output frame size of the kernel the baseline is compared with
+static size_t memcpy_frame_size = 4u;
+
+static void run_memcpy(void *out, const void *in, size_t n_frames)
+{
+	//Baseline: copy as many bytes as the output period of the kernel measured
+	memcpy(out, in, memcpy_frame_size*n_frames);
+}
+
+static void run_8bit1ch(void *out, const void *in, size_t n_frames)
+{
+	convert_8bit1ch_s16_2ch((std::int16_t*) out, (const std::uint8_t*) in, n_frames);
+}
+
+static void run_8bit2ch(void *out, const void *in, size_t n_frames)
+{
+	convert_8bit2ch_s16_2ch((std::int16_t*) out, (const std::uint8_t*) in, n_frames);
+}
+
+static void run_16bit1ch(void *out, const void *in, size_t n_frames)
+{
+	convert_16bit1ch_s16_2ch((std::int16_t*) out, (const std::int16_t*) in, n_frames);
+}
+
+static void run_24bit1ch(void *out, const void *in, size_t n_frames)
+{
+	convert_24bit1ch_s24_2ch((std::int32_t*) out, (const std::uint8_t*) in, n_frames);
+}
+
+static void run_24bit2ch(void *out, const void *in, size_t n_frames)
+{
+	convert_24bit2ch_s24_2ch((std::int32_t*) out, (const std::uint8_t*) in, n_frames);
+}
+
+static void run_24bit1ch_s16(void *out, const void *in, size_t n_frames)
+{
+	convert_24bit1ch_s16_2ch((std::int16_t*) out, (const std::uint8_t*) in, n_frames);
+}
+
+static void run_24bit2ch_s16(void *out, const void *in, size_t n_frames)
+{
+	convert_24bit2ch_s16_2ch((std::int16_t*) out, (const std::uint8_t*) in, n_frames);
+}
+
+static void run_16bit2ch_be(void *out, const void *in, size_t n_frames)
+{
+	convert_16bit2ch_be_s16_2ch((std::int16_t*) out, (const std::uint8_t*) in, n_frames);
+}
+
+static void run_24bit2ch_be(void *out, const void *in, size_t n_frames)
+{
+	convert_24bit2ch_be_s24_2ch((std::int32_t*) out, (const std::uint8_t*) in, n_frames);
+}
+
+static void run_alaw1ch(void *out, const void *in, size_t n_frames)
+{
+	convert_g711_1ch_s16_2ch((std::int16_t*) out, (const std::uint8_t*) in, n_frames, true);
+}
+
+static void run_ulaw2ch(void *out, const void *in, size_t n_frames)
+{
+	convert_g711_2ch_s16_2ch((std::int16_t*) out, (const std::uint8_t*) in, n_frames, false);
+}
+
+//Channel matrices, built by main
+static channel_matrix_t matrix_downmix;
+static channel_matrix_t matrix_duplicate;
+static channel_matrix_t matrix_mix;
+
+static void run_matrix_downmix(void *out, const void *in, size_t n_frames)
+{
+	channel_matrix_apply((std::int16_t*) out, (const std::int16_t*) in, n_frames, &matrix_downmix);
+}
+
+static void run_matrix_duplicate(void *out, const void *in, size_t n_frames)
+{
+	channel_matrix_apply((std::int16_t*) out, (const std::int16_t*) in, n_frames, &matrix_duplicate);
+}
+
+static void run_matrix_mix(void *out, const void *in, size_t n_frames)
+{
+	channel_matrix_apply((std::int16_t*) out, (const std::int16_t*) in, n_frames, &matrix_mix);
+}
+
+static void run_mix_unity(void *out, const void *in, size_t n_frames)
+{
+	mix_s16_sat((std::int16_t*) out, (const std::int16_t*) in, 2u*n_frames, MIX_GAIN_UNITY);
+}
+
+static void run_mix_gain(void *out, const void *in, size_t n_frames)
+{
+	mix_s16_sat((std::int16_t*) out, (const std::int16_t*) in, 2u*n_frames, 0x4000);
+}
+
+static const bench_kernel_t BENCH_KERNELS[] = {
+	{"memcpy (baseline)", 4u, 4u, 2u, run_memcpy},
+	{"8bit1ch -> s16 2ch", 1u, 4u, 2u, run_8bit1ch},
+	{"8bit2ch -> s16 2ch", 2u, 4u, 2u, run_8bit2ch},
+	{"16bit1ch -> s16 2ch", 2u, 4u, 2u, run_16bit1ch},
+	{"24bit1ch -> s24 2ch", 3u, 8u, 2u, run_24bit1ch},
+	{"24bit2ch -> s24 2ch", 6u, 8u, 2u, run_24bit2ch},
+	{"24bit1ch -> s16 2ch", 3u, 4u, 2u, run_24bit1ch_s16},
+	{"24bit2ch -> s16 2ch", 6u, 4u, 2u, run_24bit2ch_s16},
+	{"16bit2ch BE -> s16 2ch", 4u, 4u, 2u, run_16bit2ch_be},
+	{"24bit2ch BE -> s24 2ch", 6u, 8u, 2u, run_24bit2ch_be},
+	{"alaw1ch -> s16 2ch", 1u, 4u, 2u, run_alaw1ch},
+	{"ulaw2ch -> s16 2ch", 2u, 4u, 2u, run_ulaw2ch},
+	{"matrix 6ch -> 2ch", 12u, 4u, 2u, run_matrix_downmix},
+	{"matrix 1ch -> 4ch", 2u, 8u, 4u, run_matrix_duplicate},
+	{"matrix 6ch -> 4ch", 12u, 8u, 4u, run_matrix_mix},
+	{"mix s16 2ch unity", 4u, 4u, 2u, run_mix_unity},
+	{"mix s16 2ch gain", 4u, 4u, 2u, run_mix_gain}
+};
+
+static const size_t BENCH_PERIODS[] = {64u, 256u, 1024u, 4096u, 16384u};
+
+static std::int64_t monotonic_ns(void)
+{
+	struct timespec tspec;
+
+	clock_gettime(CLOCK_MONOTONIC, &tspec);
+	return ((std::int64_t) tspec.tv_sec)*1000000000 + ((std::int64_t) tspec.tv_nsec);
+}
+
+static std::uint64_t cycle_count(void)
+{
+#ifdef BENCH_HAVE_TSC
+	return __rdtsc();
+#else
+	return 0u;
+#endif
+}
+
+//Returns the best of BENCH_RUNS runs, each one long enough to be measured reliably
+static void bench_run(const bench_kernel_t *kernel, void *out, const void *in, size_t n_frames, double *ns_per_frame, double *cycles_per_frame)
+{
+	size_t n_iter = 0u;
+	size_t n_iters = 1u;
+	int n_run = 0;
+	std::int64_t time_begin = 0;
+	std::int64_t time_elapsed = 0;
+	std::uint64_t cycles_begin = 0u;
+	std::uint64_t cycles_elapsed = 0u;
+	double ns = 0.0;
+
+	//Calibrate
+	while(true)
+	{
+		time_begin = monotonic_ns();
+		for(n_iter = 0u; n_iter < n_iters; n_iter++) kernel->run(out, in, n_frames);
+		time_elapsed = monotonic_ns() - time_begin;
+
+		if(time_elapsed >= (BENCH_MIN_TIME_NS/10)) break;
+		n_iters *= 2u;
+	}
+
+	*ns_per_frame = 0.0;
+	*cycles_per_frame = 0.0;
+
+	for(n_run = 0; n_run < BENCH_RUNS; n_run++)
+	{
+		time_begin = monotonic_ns();
+		cycles_begin = cycle_count();
+
+		for(n_iter = 0u; n_iter < n_iters; n_iter++) kernel->run(out, in, n_frames);
+
+		cycles_elapsed = cycle_count() - cycles_begin;
+		time_elapsed = monotonic_ns() - time_begin;
+
+		ns = ((double) time_elapsed)/((double) (n_iters*n_frames));
+		if((n_run == 0) || (ns < *ns_per_frame))
+		{
+			*ns_per_frame = ns;
+			*cycles_per_frame = ((double) cycles_elapsed)/((double) (n_iters*n_frames));
+		}
+	}
+
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	const size_t n_kernels = sizeof(BENCH_KERNELS)/sizeof(bench_kernel_t);
+	const size_t n_periods = sizeof(BENCH_PERIODS)/sizeof(size_t);
+	const size_t max_frames = BENCH_PERIODS[n_periods - 1u];
+	std::uint8_t *in = (std::uint8_t*) std::malloc(BENCH_MAX_FRAME_SIZE*max_frames);
+	std::uint8_t *out = (std::uint8_t*) std::malloc(BENCH_MAX_FRAME_SIZE*max_frames);
+	size_t n_kernel = 0u;
+	size_t n_period = 0u;
+	size_t n_byte = 0u;
+	double ns_per_frame = 0.0;
+	double cycles_per_frame = 0.0;
+	double gbps = 0.0;
+
+	(void) argc;
+	(void) argv;
+
+	//Synthetic noise, so table lookups and sign extension see every code path
+	srand(1);
+	for(n_byte = 0u; n_byte < BENCH_MAX_FRAME_SIZE*max_frames; n_byte++) in[n_byte] = (std::uint8_t) rand();
+	memset(out, 0, BENCH_MAX_FRAME_SIZE*max_frames);
+
+	//5.1 folded down to stereo, mono duplicated to 4 zone speakers, and 5.1 averaged onto 4 outputs
+	channel_matrix_default(&matrix_downmix, 6u, 2u);
+	channel_matrix_default(&matrix_duplicate, 1u, 4u);
+	channel_matrix_default(&matrix_mix, 6u, 4u);
+
+	std::printf("%-22s %8s %12s %12s %14s %10s\n", "kernel", "frames", "ns/frame", "GB/s", "cycles/sample", "vs memcpy");
+
+	for(n_kernel = 0u; n_kernel < n_kernels; n_kernel++)
+	{
+		for(n_period = 0u; n_period < n_periods; n_period++)
+		{
+			const bench_kernel_t *kernel = &BENCH_KERNELS[n_kernel];
+			size_t n_frames = BENCH_PERIODS[n_period];
+			double baseline_ns = 0.0;
+			double baseline_cycles = 0.0;
+
+			memcpy_frame_size = kernel->out_frame_size;
+
+			bench_run(kernel, out, in, n_frames, &ns_per_frame, &cycles_per_frame);
+			bench_run(&BENCH_KERNELS[0], out, in, n_frames, &baseline_ns, &baseline_cycles);
+
+			//Bytes read plus bytes written
+			gbps = ((double) ((kernel->in_frame_size + kernel->out_frame_size)*n_frames))/(ns_per_frame*((double) n_frames));
+
+#ifdef BENCH_HAVE_TSC
+			std::printf("%-22s %8zu %12.3f %12.2f %14.3f %9.2fx\n", kernel->name, n_frames, ns_per_frame, gbps, cycles_per_frame/((double) kernel->out_channels), ns_per_frame/baseline_ns);
+#else
+			std::printf("%-22s %8zu %12.3f %12.2f %14s %9.2fx\n", kernel->name, n_frames, ns_per_frame, gbps, "-", ns_per_frame/baseline_ns);
+#endif
+		}
+	}
+
+	std::free(in);
+	std::free(out);
+	return 0;
+}
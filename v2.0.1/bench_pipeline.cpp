@@ -0,0 +1,198 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * End-to-end pipeline throughput benchmark.
+ * Runs the full AudioPlayback::runPlayback pipeline against a PCM that does not pace the writer
+ * (ALSA "null" plugin, or a "file" plugin), opened in non-blocking mode, and reports how many times
+ * faster than realtime the engine runs, overall and per core of CPU time. The report is JSON on stdout.
+ *
+ * Usage: bench_pipeline.elf [-d <Audio Device>] [-r <Repeats per Run>] [-n <Runs>] [-j <Parallel Instances>] <Audio File Directory>
+ */
+
+#include "globaldef.h"
+#include "AudioPlayback.hpp"
+#include "AudioPlaybackFactory.hpp"
+#include "WaveHeader.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+
+struct bench_result {
+	bool ok;
+	std::uint64_t frames;
+	double wall_s;
+	double cpu_s;
+};
+
+typedef struct bench_result bench_result_t;
+
+static std::string audio_dev_desc = "null";
+static std::string filein_dir = "";
+static int n_repeats = 1;
+static int n_runs = 3;
+static int n_instances = 1;
+
+static audio_playback_params_t audio_params;
+static int audio_format = -1;
+
+static double clock_s(clockid_t clock_id)
+{
+	struct timespec tspec;
+
+	clock_gettime(clock_id, &tspec);
+	return ((double) tspec.tv_sec) + ((double) tspec.tv_nsec)*1e-9;
+}
+
+static void bench_instance(bench_result_t *result)
+{
+	audio_playback_params_t params = audio_params;
+	AudioPlayback *pb_obj = audio_playback_create(audio_format, &params);
+	double wall_begin = 0.0;
+	double cpu_begin = 0.0;
+	std::uint64_t data_frames = 0u;
+
+	result->ok = false;
+	if(pb_obj == nullptr) return;
+
+	pb_obj->setNonBlocking(true);
+	pb_obj->setVerbose(false);
+
+	//Repeats are played as a loop over the whole data, so they measure the pipeline and not process startup
+	if(n_repeats > 1)
+	{
+		data_frames = ((std::uint64_t) (params.audio_data_end - params.audio_data_begin));
+		if(params.block_align > 0u) data_frames /= params.block_align;
+
+		if(!pb_obj->setLoopRegion(0u, data_frames, n_repeats - 1))
+		{
+			std::cerr << "Warning: this format cannot loop, playing it once\n";
+		}
+	}
+
+	wall_begin = clock_s(CLOCK_MONOTONIC);
+	cpu_begin = clock_s(CLOCK_THREAD_CPUTIME_ID);
+
+	result->ok = pb_obj->runPlayback();
+
+	result->cpu_s = clock_s(CLOCK_THREAD_CPUTIME_ID) - cpu_begin;
+	result->wall_s = clock_s(CLOCK_MONOTONIC) - wall_begin;
+	result->frames = pb_obj->getFramesWritten();
+
+	if(!result->ok) std::cerr << "Error: " << pb_obj->getLastErrorMessage() << std::endl;
+
+	delete pb_obj;
+	return;
+}
+
+static bool parse_args(int argc, char **argv)
+{
+	int n_arg = 0;
+
+	for(n_arg = 1; n_arg < argc; n_arg++)
+	{
+		std::string arg = argv[n_arg];
+
+		if((arg == "-d") && ((n_arg + 1) < argc)) audio_dev_desc = argv[++n_arg];
+		else if((arg == "-r") && ((n_arg + 1) < argc)) n_repeats = std::atoi(argv[++n_arg]);
+		else if((arg == "-n") && ((n_arg + 1) < argc)) n_runs = std::atoi(argv[++n_arg]);
+		else if((arg == "-j") && ((n_arg + 1) < argc)) n_instances = std::atoi(argv[++n_arg]);
+		else filein_dir = arg;
+	}
+
+	if(filein_dir.empty()) return false;
+	if(n_repeats < 1) n_repeats = 1;
+	if(n_runs < 1) n_runs = 1;
+	if(n_instances < 1) n_instances = 1;
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<bench_result_t> results;
+	std::vector<std::thread> threads;
+	int n_run = 0;
+	int n_instance = 0;
+	int fd = -1;
+	double wall_s = 0.0;
+	double wall_begin = 0.0;
+	double cpu_s = 0.0;
+	double audio_s = 0.0;
+	double total_audio_s = 0.0;
+	double total_wall_s = 0.0;
+	double total_cpu_s = 0.0;
+	std::uint64_t frames = 0u;
+
+	if(!parse_args(argc, argv))
+	{
+		std::cout << "Usage: bench_pipeline.elf [-d <Audio Device>] [-r <Repeats per Run>] [-n <Runs>] [-j <Parallel Instances>] <Audio File Directory>\n";
+		return 0;
+	}
+
+	audio_params.audio_dev_desc = (char*) audio_dev_desc.c_str();
+	audio_params.filein_dir = (char*) filein_dir.c_str();
+
+	fd = file_open(filein_dir.c_str());
+	if(fd < 0)
+	{
+		std::cerr << "Error: could not open audio file\n";
+		return 1;
+	}
+
+	audio_format = file_get_params(fd, &audio_params);
+	file_close(fd);
+	audio_params.loop_count = 0; //Every run plays the file once
+
+	if(audio_format < 0)
+	{
+		std::cerr << "Error: audio format not supported\n";
+		return 1;
+	}
+
+	std::printf("{\"device\": \"%s\", \"file\": \"%s\", \"format\": %d, \"sample_rate\": %u, \"repeats\": %d, \"instances\": %d, \"runs\": [", audio_dev_desc.c_str(), filein_dir.c_str(), audio_format, audio_params.sample_rate, n_repeats, n_instances);
+
+	for(n_run = 0; n_run < n_runs; n_run++)
+	{
+		results.assign((size_t) n_instances, bench_result_t());
+		threads.clear();
+
+		wall_begin = clock_s(CLOCK_MONOTONIC);
+		for(n_instance = 0; n_instance < n_instances; n_instance++) threads.push_back(std::thread(bench_instance, &results[n_instance]));
+		for(n_instance = 0; n_instance < n_instances; n_instance++) threads[n_instance].join();
+		wall_s = clock_s(CLOCK_MONOTONIC) - wall_begin;
+
+		frames = 0u;
+		cpu_s = 0.0;
+		for(n_instance = 0; n_instance < n_instances; n_instance++)
+		{
+			if(!results[n_instance].ok)
+			{
+				std::printf("]}\n");
+				return 1;
+			}
+
+			frames += results[n_instance].frames;
+			cpu_s += results[n_instance].cpu_s;
+		}
+
+		audio_s = ((double) frames)/((double) audio_params.sample_rate);
+
+		std::printf("%s{\"frames\": %llu, \"audio_s\": %.6f, \"wall_s\": %.6f, \"cpu_s\": %.6f, \"realtime_x\": %.2f, \"realtime_x_per_core\": %.2f}", ((n_run > 0) ? ", " : ""), (unsigned long long) frames, audio_s, wall_s, cpu_s, audio_s/wall_s, audio_s/cpu_s);
+
+		total_audio_s += audio_s;
+		total_wall_s += wall_s;
+		total_cpu_s += cpu_s;
+	}
+
+	std::printf("], \"realtime_x\": %.2f, \"realtime_x_per_core\": %.2f}\n", total_audio_s/total_wall_s, total_audio_s/total_cpu_s);
+	return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Time-to-first-sample benchmark.
+ * Repeats the whole startup path (header parsing, file open, device setup, buffer allocation, preload and
+ * first write) N times and reports percentiles for every phase and for the total time to first sample.
+ * The clip is played to the end on every iteration, so short clips keep the benchmark fast.
+ *
+ * Usage: bench_startup.elf [-d <Audio Device>] [-n <Iterations>] [-b] <Audio File Directory>
+ * -b opens the device in blocking mode (default is non-blocking, so a real device does not pace the run).
+ */
+
+#include "globaldef.h"
+#include "AudioPlayback.hpp"
+#include "AudioPlaybackFactory.hpp"
+#include "StartupTrace.hpp"
+#include "WaveHeader.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define TOTAL_COLUMN STARTUP_PHASE_COUNT
+
+static std::string audio_dev_desc = "null";
+static std::string filein_dir = "";
+static int n_iterations = 100;
+static bool blocking = false;
+
+static bool parse_args(int argc, char **argv)
+{
+	int n_arg = 0;
+
+	for(n_arg = 1; n_arg < argc; n_arg++)
+	{
+		std::string arg = argv[n_arg];
+
+		if((arg == "-d") && ((n_arg + 1) < argc)) audio_dev_desc = argv[++n_arg];
+		else if((arg == "-n") && ((n_arg + 1) < argc)) n_iterations = std::atoi(argv[++n_arg]);
+		else if(arg == "-b") blocking = true;
+		else filein_dir = arg;
+	}
+
+	if(filein_dir.empty()) return false;
+	if(n_iterations < 1) n_iterations = 1;
+
+	return true;
+}
+
+//Runs the same steps as main.cpp, tracing each one
+static bool startup_run(startup_trace_t *trace)
+{
+	audio_playback_params_t params;
+	AudioPlayback *pb_obj = nullptr;
+	int fd = -1;
+	int format = -1;
+	bool ok = false;
+
+	startup_trace_reset(trace);
+	startup_trace_mark(trace, STARTUP_TRIGGER);
+
+	params.audio_dev_desc = (char*) audio_dev_desc.c_str();
+	params.filein_dir = (char*) filein_dir.c_str();
+
+	if(!file_ext_check(params.filein_dir)) return false;
+	startup_trace_mark(trace, STARTUP_FILE_EXT_CHECK);
+
+	fd = file_open(params.filein_dir);
+	if(fd < 0) return false;
+	startup_trace_mark(trace, STARTUP_FILE_OPEN);
+
+	format = file_get_params(fd, &params);
+	file_close(fd);
+	params.loop_count = 0; //Every run plays the file once
+	startup_trace_mark(trace, STARTUP_FILE_GET_PARAMS);
+
+	pb_obj = audio_playback_create(format, &params);
+	if(pb_obj == nullptr) return false;
+
+	pb_obj->setNonBlocking(!blocking);
+	pb_obj->setVerbose(false);
+	pb_obj->setStartupTrace(trace);
+
+	ok = pb_obj->runPlayback();
+	if(!ok) std::cerr << "Error: " << pb_obj->getLastErrorMessage() << std::endl;
+
+	delete pb_obj;
+	return ok;
+}
+
+static double percentile_us(std::vector<std::int64_t> &samples, double percent)
+{
+	size_t index = 0u;
+
+	if(samples.empty()) return 0.0;
+
+	index = (size_t) ((percent/100.0)*((double) (samples.size() - 1u)) + 0.5);
+	return ((double) samples[index])/1000.0;
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::vector<std::int64_t>> phase_ns(TOTAL_COLUMN + 1);
+	startup_trace_t trace;
+	int n_iteration = 0;
+	int n_phase = 0;
+	std::int64_t ns = 0;
+
+	if(!parse_args(argc, argv))
+	{
+		std::cout << "Usage: bench_startup.elf [-d <Audio Device>] [-n <Iterations>] [-b] <Audio File Directory>\n";
+		return 0;
+	}
+
+	for(n_iteration = 0; n_iteration < n_iterations; n_iteration++)
+	{
+		if(!startup_run(&trace)) return 1;
+
+		for(n_phase = 1; n_phase < STARTUP_PHASE_COUNT; n_phase++)
+		{
+			ns = startup_trace_phase_ns(&trace, n_phase);
+			if(ns >= 0) phase_ns[n_phase].push_back(ns);
+		}
+
+		if(trace.tstamp_ns[STARTUP_FIRST_WRITE] >= 0) phase_ns[TOTAL_COLUMN].push_back(trace.tstamp_ns[STARTUP_FIRST_WRITE] - trace.tstamp_ns[STARTUP_TRIGGER]);
+	}
+
+	std::printf("%d iterations, device \"%s\", %s mode (microseconds)\n", n_iterations, audio_dev_desc.c_str(), (blocking ? "blocking" : "non-blocking"));
+	std::printf("%-22s %10s %10s %10s %10s %10s\n", "phase", "p50", "p90", "p99", "max", "mean");
+
+	for(n_phase = 1; n_phase <= TOTAL_COLUMN; n_phase++)
+	{
+		std::vector<std::int64_t> &samples = phase_ns[n_phase];
+		double mean = 0.0;
+		size_t n_sample = 0u;
+
+		if(samples.empty()) continue;
+
+		std::sort(samples.begin(), samples.end());
+		for(n_sample = 0u; n_sample < samples.size(); n_sample++) mean += (double) samples[n_sample];
+		mean /= 1000.0*((double) samples.size());
+
+		std::printf("%-22s %10.1f %10.1f %10.1f %10.1f %10.1f\n", ((n_phase == TOTAL_COLUMN) ? "time to first sample" : startup_phase_name(n_phase)), percentile_us(samples, 50.0), percentile_us(samples, 90.0), percentile_us(samples, 99.0), percentile_us(samples, 100.0), mean);
+	}
+
+	return 0;
+}
@@ -1,4 +1,7 @@
 #!/bin/bash
 
-g++ main.cpp AudioPlayback.cpp AudioPlayback_16bit1ch.cpp AudioPlayback_16bit2ch.cpp AudioPlayback_24bit1ch.cpp AudioPlayback_24bit2ch.cpp -lasound -o playback.elf
-
+g++ -O2 main.cpp AudioPlayback.cpp AudioPlayback_8bit1ch.cpp AudioPlayback_8bit2ch.cpp AudioPlayback_16bit1ch.cpp AudioPlayback_16bit2ch.cpp AudioPlayback_16bitNch.cpp AudioPlayback_24bit1ch.cpp AudioPlayback_24bit2ch.cpp AudioPlayback_g711.cpp AudioPlayback_imaadpcm.cpp AudioMixer.cpp AudioConvert.cpp WaveHeader.cpp AudioPlaybackFactory.cpp StartupTrace.cpp PeriodStats.cpp StatsExporter.cpp ClipCache.cpp AudioVerify.cpp PlayoutEngine.cpp BufferArena.cpp DirectReader.cpp AudioCatalog.cpp ChannelMatrix.cpp -pthread -lasound -o playback.elf
+g++ -O2 playbackd.cpp AudioPlayback.cpp AudioPlayback_8bit1ch.cpp AudioPlayback_8bit2ch.cpp AudioPlayback_16bit1ch.cpp AudioPlayback_16bit2ch.cpp AudioPlayback_16bitNch.cpp AudioPlayback_24bit1ch.cpp AudioPlayback_24bit2ch.cpp AudioPlayback_g711.cpp AudioPlayback_imaadpcm.cpp AudioMixer.cpp AudioConvert.cpp WaveHeader.cpp AudioPlaybackFactory.cpp StartupTrace.cpp PeriodStats.cpp StatsExporter.cpp ClipCache.cpp AudioVerify.cpp PlayoutEngine.cpp BufferArena.cpp DirectReader.cpp AudioCatalog.cpp ChannelMatrix.cpp -pthread -lasound -o playbackd.elf
+g++ -O2 render.cpp AudioPlayback.cpp AudioPlayback_8bit1ch.cpp AudioPlayback_8bit2ch.cpp AudioPlayback_16bit1ch.cpp AudioPlayback_16bit2ch.cpp AudioPlayback_16bitNch.cpp AudioPlayback_24bit1ch.cpp AudioPlayback_24bit2ch.cpp AudioPlayback_g711.cpp AudioPlayback_imaadpcm.cpp AudioMixer.cpp AudioConvert.cpp WaveHeader.cpp AudioPlaybackFactory.cpp StartupTrace.cpp PeriodStats.cpp StatsExporter.cpp ClipCache.cpp AudioVerify.cpp PlayoutEngine.cpp BufferArena.cpp DirectReader.cpp AudioCatalog.cpp ChannelMatrix.cpp -pthread -lasound -o render.elf
+g++ -O2 playout.cpp AudioPlayback.cpp AudioPlayback_8bit1ch.cpp AudioPlayback_8bit2ch.cpp AudioPlayback_16bit1ch.cpp AudioPlayback_16bit2ch.cpp AudioPlayback_16bitNch.cpp AudioPlayback_24bit1ch.cpp AudioPlayback_24bit2ch.cpp AudioPlayback_g711.cpp AudioPlayback_imaadpcm.cpp AudioMixer.cpp AudioConvert.cpp WaveHeader.cpp AudioPlaybackFactory.cpp StartupTrace.cpp PeriodStats.cpp StatsExporter.cpp ClipCache.cpp AudioVerify.cpp PlayoutEngine.cpp BufferArena.cpp DirectReader.cpp AudioCatalog.cpp ChannelMatrix.cpp -pthread -lasound -o playout.elf
+g++ -O2 catalog.cpp AudioPlayback.cpp AudioPlayback_8bit1ch.cpp AudioPlayback_8bit2ch.cpp AudioPlayback_16bit1ch.cpp AudioPlayback_16bit2ch.cpp AudioPlayback_16bitNch.cpp AudioPlayback_24bit1ch.cpp AudioPlayback_24bit2ch.cpp AudioPlayback_g711.cpp AudioPlayback_imaadpcm.cpp AudioMixer.cpp AudioConvert.cpp WaveHeader.cpp AudioPlaybackFactory.cpp StartupTrace.cpp PeriodStats.cpp StatsExporter.cpp ClipCache.cpp AudioVerify.cpp PlayoutEngine.cpp BufferArena.cpp DirectReader.cpp AudioCatalog.cpp ChannelMatrix.cpp -pthread -lasound -o catalog.elf
@@ -0,0 +1,65 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Library indexer.
+ * Walks directories for .wav and .w64 files, parses their headers in parallel and writes a binary catalog
+ * (see AudioCatalog) that playback.elf -C and playbackd.elf -C use instead of parsing each header at startup.
+ * Files with a data size past the end of the file are indexed up to the end of the file.
+ *
+ * Usage: catalog.elf [-j <Threads>] <Catalog File> <Directory | File> [<Directory | File> ...]
+ */
+
+#include "globaldef.h"
+#include "AudioCatalog.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <time.h>
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> roots;
+	audio_catalog_build_result_t result;
+	const char *catalog_dir = nullptr;
+	unsigned int n_threads = 0u;
+	struct timespec tstart;
+	struct timespec tend;
+	double elapsed = 0.0;
+	int n_arg = 0;
+
+	for(n_arg = 1; n_arg < argc; n_arg++)
+	{
+		std::string arg = argv[n_arg];
+
+		if((arg == "-j") && ((n_arg + 1) < argc)) n_threads = (unsigned int) std::strtoul(argv[++n_arg], nullptr, 10);
+		else if(catalog_dir == nullptr) catalog_dir = argv[n_arg];
+		else roots.push_back(arg);
+	}
+
+	if((catalog_dir == nullptr) || roots.empty())
+	{
+		std::cout << "Usage: catalog.elf [-j <Threads>] <Catalog File> <Directory | File> [<Directory | File> ...]\n";
+		return 0;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &tstart);
+
+	if(!audio_catalog_build(roots, catalog_dir, n_threads, &result))
+	{
+		std::cout << "Error: could not write catalog file\n";
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &tend);
+	elapsed = ((double) (tend.tv_sec - tstart.tv_sec)) + ((double) (tend.tv_nsec - tstart.tv_nsec))/1000000000.0;
+
+	std::cout << "Indexed " << result.n_indexed << " of " << result.n_files << " files in " << elapsed << " s";
+	std::cout << " (" << result.n_rejected << " rejected, " << result.n_truncated << " truncated)\n";
+	return 0;
+}
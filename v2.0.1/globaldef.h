@@ -21,9 +21,13 @@
 #ifdef _LARGEFILE64_SOURCE
 typedef off64_t __offset;
 #define __LSEEK(fd, offset, whence) lseek64(fd, offset, whence)
+#define __PREAD(fd, buf, nbytes, offset) pread64(fd, buf, nbytes, offset)
+#define __PWRITE(fd, buf, nbytes, offset) pwrite64(fd, buf, nbytes, offset)
 #else
 typedef off_t __offset;
 #define __LSEEK(fd, offset, whence) lseek(fd, offset, whence)
+#define __PREAD(fd, buf, nbytes, offset) pread(fd, buf, nbytes, offset)
+#define __PWRITE(fd, buf, nbytes, offset) pwrite(fd, buf, nbytes, offset)
 #endif
 
 #endif //GLOBALDEF_H
@@ -8,227 +8,548 @@
 #include "globaldef.h"
 #include <iostream>
 #include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <signal.h>
 
 #include "AudioPlayback.hpp"
-#include "AudioPlayback_16bit1ch.hpp"
-#include "AudioPlayback_16bit2ch.hpp"
-#include "AudioPlayback_24bit1ch.hpp"
-#include "AudioPlayback_24bit2ch.hpp"
-
-#define PB_16BIT1CH 1
-#define PB_16BIT2CH 2
-#define PB_24BIT1CH 3
-#define PB_24BIT2CH 4
-
-#define BYTEBUF_SIZE 4096U
+#include "AudioPlaybackFactory.hpp"
+#include "AudioMixer.hpp"
+#include "StatsExporter.hpp"
+#include "AudioVerify.hpp"
+#include "WaveHeader.hpp"
+#include "AudioCatalog.hpp"
 
 AudioPlayback *pb_obj = nullptr;
 audio_playback_params_t audio_params;
 
-int fd = -1;
-__offset fsize = 0;
+std::uint64_t start_frame = 0u;
+std::uint64_t loop_begin_frame = 0u;
+std::uint64_t loop_end_frame = 0u;
+int loop_count = 0;
+//-N: loop points stored in the file ("smpl" or "cue " chunk) are not played
+bool file_loop_ignore = false;
+
+startup_trace_t startup_trace;
+bool startup_trace_print = false;
+
+period_stats_t period_stats;
+bool period_stats_enable = false;
+
+const char *stats_fileout_dir = nullptr;
+int stats_interval_ms = 10000;
+
+size_t readahead_window = 0u;
+bool direct_io = false;
+
+AudioCatalog catalog;
+bool catalog_enable = false;
+
+//Standard input ("-") is a pipe: its header has been read and it can not be seeked
+bool stdin_stream = false;
+
+audio_verify_t verify;
+bool verify_enable = false;
+
+//-c: channels opened on the device (0: stereo), -M: channel matrix given by hand
+unsigned int device_channels = 0u;
+const char *channel_matrix_arg = nullptr;
+channel_matrix_t channel_matrix;
+
+//-s, -l, -c or -M given: they only apply to single file playback
+bool single_file_option = false;
 
-bool file_ext_check(void);
+//Files to mix, each with the gain of the -g before it (1.0 without one)
+struct mixer_input {
+	const char *filein_dir;
+	float gain;
+};
 
-bool file_open(void);
-void file_close(void);
+typedef struct mixer_input mixer_input_t;
 
-int file_get_params(void);
-bool compare_signature(const char *auth, const char *bytebuf, size_t offset);
+std::vector<mixer_input_t> mixer_inputs;
+
+int load_params(const char *filein_dir, audio_playback_params_t *params);
+bool parse_loop_region(const char *arg);
+int channel_matrix_resolve(int format, const audio_playback_params_t *params);
+AudioPlayback *mixer_create(const char *audio_dev_desc);
+void print_startup_trace(void);
+void period_stats_start(void);
+int stats_file_format(const char *fileout_dir);
 
 int main(int argc, char **argv)
 {
+	int n_arg = 0;
+	int n_files = 0;
+	int format = -1;
+	float gain = 1.0f;
+	bool use_mixer = false;
+	bool use_stdin = false;
+	const char *filein_dir = nullptr;
+
+	startup_trace_reset(&startup_trace);
+	startup_trace_mark(&startup_trace, STARTUP_TRIGGER);
+
 	if(argc < 3)
 	{
 		std::cout << "Error: missing arguments\nThis executable requires two arguments: <Audio Device> <Audio File Directory>\nThey must be in this order\n";
+		std::cout << "Options before the file: -s <Start Frame> -l <Loop Begin Frame>:<Loop End Frame>[:<Loop Count>]\n";
+		std::cout << "-T prints the time spent in each startup phase, up to the first sample written to the device\n";
+		std::cout << "-H prints per-period timing histograms at the end of playback, or at any time on SIGUSR1\n";
+		std::cout << "-S <Stats File> [-I <Seconds>] writes playback stats periodically, as JSON or as a Prometheus textfile (.prom)\n";
+		std::cout << "-N ignores loop points stored in the file (\"smpl\" or \"cue \" chunk), -l replaces them\n";
+		std::cout << "-V checks that the audio written to the device matches a reference conversion of the file bit for bit\n";
+		std::cout << "-R <MiB> reads the file that far ahead and drops played data from the page cache\n";
+		std::cout << "-D reads the file with O_DIRECT, bypassing the page cache\n";
+		std::cout << "-C <Catalog File> takes file headers from a catalog written by catalog.elf\n";
+		std::cout << "-c <Device Channels> mixes a 16bit PCM file to that many device channels through the default channel matrix\n";
+		std::cout << "-M <Gain>,<Gain>,...;<Gain>,<Gain>,... mixes a 16bit PCM file through this channel matrix, one row of gains per device channel\n";
+		std::cout << "\"-\" as the file plays the standard input, which may be a pipe\n";
+		std::cout << "To mix several files: <Audio Device> [-g <Gain>] <Audio File Directory> [-g <Gain>] <Audio File Directory> ...\n";
 		return 0;
 	}
 
-	audio_params.audio_dev_desc = argv[1];
-	audio_params.filein_dir = argv[2];
+	for(n_arg = 2; n_arg < argc; n_arg++)
+	{
+		std::string arg = argv[n_arg];
 
-	if(!file_ext_check())
+		if(arg == "-g")
+		{
+			if(++n_arg >= argc) break;
+			gain = std::strtof(argv[n_arg], nullptr);
+			use_mixer = true;
+		}
+		else if(arg == "-T")
+		{
+			startup_trace_print = true;
+		}
+		else if(arg == "-H")
+		{
+			period_stats_enable = true;
+		}
+		else if(arg == "-V")
+		{
+			verify_enable = true;
+		}
+		else if(arg == "-D")
+		{
+			direct_io = true;
+		}
+		else if(arg == "-N")
+		{
+			file_loop_ignore = true;
+		}
+		else if(arg == "-S")
+		{
+			if(++n_arg >= argc) break;
+			stats_fileout_dir = argv[n_arg];
+		}
+		else if(arg == "-C")
+		{
+			if(++n_arg >= argc) break;
+			if(!catalog.open(argv[n_arg]))
+			{
+				std::cout << "Error: " << catalog.getLastErrorMessage() << std::endl;
+				return 1;
+			}
+
+			catalog_enable = true;
+		}
+		else if(arg == "-R")
+		{
+			if(++n_arg >= argc) break;
+			readahead_window = ((size_t) std::strtoul(argv[n_arg], nullptr, 10)) << 20;
+		}
+		else if(arg == "-c")
+		{
+			if(++n_arg >= argc) break;
+			single_file_option = true;
+			device_channels = (unsigned int) std::strtoul(argv[n_arg], nullptr, 10);
+			if((device_channels == 0u) || (device_channels > CHANNEL_MATRIX_MAX_CHANNELS))
+			{
+				std::cout << "Error: device channels must be 1 to " << CHANNEL_MATRIX_MAX_CHANNELS << std::endl;
+				return 1;
+			}
+		}
+		else if(arg == "-M")
+		{
+			if(++n_arg >= argc) break;
+			single_file_option = true;
+			channel_matrix_arg = argv[n_arg];
+		}
+		else if(arg == "-I")
+		{
+			if(++n_arg >= argc) break;
+			stats_interval_ms = (int) (std::strtod(argv[n_arg], nullptr)*1000.0);
+		}
+		else if(arg == "-s")
+		{
+			if(++n_arg >= argc) break;
+			single_file_option = true;
+			start_frame = std::strtoull(argv[n_arg], nullptr, 10);
+		}
+		else if(arg == "-l")
+		{
+			if(++n_arg >= argc) break;
+			single_file_option = true;
+			if(!parse_loop_region(argv[n_arg]))
+			{
+				std::cout << "Error: invalid loop region\n";
+				return 1;
+			}
+		}
+		else
+		{
+			filein_dir = argv[n_arg];
+			if(arg == "-") use_stdin = true;
+			n_files++;
+
+			mixer_inputs.push_back({filein_dir, gain});
+			gain = 1.0f;
+		}
+	}
+
+	if(n_files == 0)
 	{
-		std::cout << "Error: file format is not supported\n";
+		std::cout << "Error: no audio file to play\n";
 		return 1;
 	}
 
-	if(!file_open())
+	//The reference conversion reads the file again
+	if(use_stdin && (use_mixer || (n_files > 1) || verify_enable))
 	{
-		std::cout << "Error: could not open audio file\n";
+		std::cout << "Error: standard input can only be played on its own, without -V\n";
 		return 1;
 	}
 
-	int n_ret = file_get_params();
+	//The mixer plays every stream from the start, looping none, to the stereo device
+	if(single_file_option && (use_mixer || (n_files > 1)))
+	{
+		std::cout << "Error: -s, -l, -c and -M only apply to a single file, not to a mix\n";
+		return 1;
+	}
 
-	if(n_ret < 0)
+	//The reference is the file played once from start to end
+	if(verify_enable && (use_mixer || (n_files > 1) || (start_frame > 0u) || (loop_count != 0)))
 	{
-		std::cout << "Error: audio format not supported\n";
+		std::cout << "Error: -V only applies to a single file played from the start, without loop\n";
 		return 1;
 	}
 
-	switch(n_ret)
+	//More than one file, or an explicit gain, selects the mixer.
+	if(use_mixer || (n_files > 1))
 	{
-		case PB_16BIT1CH:
-			pb_obj = new AudioPlayback_16bit1ch(&audio_params);
-			break;
+		pb_obj = mixer_create(argv[1]);
+		if(pb_obj == nullptr) return 1;
+	}
+	else
+	{
+		audio_params.audio_dev_desc = argv[1];
+
+		format = load_params(filein_dir, &audio_params);
+		if(format < 0) return 1;
 
-		case PB_16BIT2CH:
-			pb_obj = new AudioPlayback_16bit2ch(&audio_params);
-			break;
+		if(stdin_stream && ((start_frame > 0u) || (loop_count != 0)))
+		{
+			std::cout << "Error: a pipe can not be seeked or looped\n";
+			return 1;
+		}
+
+		format = channel_matrix_resolve(format, &audio_params);
+		if(format < 0) return 1;
 
-		case PB_24BIT1CH:
-			pb_obj = new AudioPlayback_24bit1ch(&audio_params);
-			break;
+		//The reference is played once, with no loop
+		if(file_loop_ignore || verify_enable) audio_params.loop_count = 0;
 
-		case PB_24BIT2CH:
-			pb_obj = new AudioPlayback_24bit2ch(&audio_params);
-			break;
+		pb_obj = audio_playback_create(format, &audio_params);
+		if(format == PB_16BITNCH) pb_obj->setChannelMatrix(&channel_matrix);
+
+		if((start_frame > 0u) && !pb_obj->seekFrame(start_frame))
+		{
+			std::cout << "Error: start frame is beyond the end of the audio data\n";
+			delete pb_obj;
+			return 1;
+		}
+
+		if((loop_count != 0) && !pb_obj->setLoopRegion(loop_begin_frame, loop_end_frame, loop_count))
+		{
+			std::cout << "Error: loop region is outside the audio data\n";
+			delete pb_obj;
+			return 1;
+		}
+	}
+
+	pb_obj->setStartupTrace(&startup_trace);
+	pb_obj->setReadahead(readahead_window);
+	pb_obj->setDirectIO(direct_io);
+
+	if(period_stats_enable)
+	{
+		period_stats_start();
+		pb_obj->setPeriodStats(&period_stats);
+	}
+
+	if(verify_enable)
+	{
+		audio_verify_init(&verify, audio_data_frames(&audio_params, format));
+		pb_obj->setVerify(&verify);
+	}
+
+	StatsExporter stats_exporter(pb_obj, stats_fileout_dir, stats_file_format(stats_fileout_dir), stats_interval_ms);
+
+	if((stats_fileout_dir != nullptr) && !stats_exporter.start())
+	{
+		std::cout << "Error: " << stats_exporter.getLastErrorMessage() << std::endl;
+		delete pb_obj;
+		return 1;
 	}
 
 	if(!pb_obj->runPlayback())
 	{
 		std::cout << "Error: " << pb_obj->getLastErrorMessage() << std::endl;
+		stats_exporter.stop();
 		delete pb_obj;
 		return 1;
 	}
 
+	stats_exporter.stop();
+
+	if(startup_trace_print) print_startup_trace();
+	if(period_stats_enable) period_stats_print(&period_stats, stderr);
+
 	delete pb_obj;
+
+	if(verify_enable)
+	{
+		audio_verify_reference_t reference;
+
+		if(!audio_verify_reference(&audio_params, format, ((format == PB_16BITNCH) ? &channel_matrix : nullptr), verify.period_frames, &reference))
+		{
+			std::cout << "Error: could not build the reference conversion\n";
+			return 1;
+		}
+
+		if(!audio_verify_report(&verify, &reference, stderr)) return 1;
+	}
+
 	return 0;
 }
 
-bool file_ext_check(void)
+int load_params(const char *filein_dir, audio_playback_params_t *params)
 {
-	if(audio_params.filein_dir == nullptr) return false;
+	int fd = -1;
+	int n_ret = 0;
 
-	size_t len = 0u;
-	while(audio_params.filein_dir[len] != '\0') len++;
+	params->filein_dir = (char*) filein_dir;
 
-	if(len < 5u) return false;
+	if(std::string(filein_dir) == "-")
+	{
+		//A file redirected to stdin is parsed like any file. A pipe is parsed front to back and left at the audio data.
+		stdin_stream = (__LSEEK(STDIN_FILENO, 0, SEEK_CUR) < 0);
 
-	if(compare_signature(".wav", audio_params.filein_dir, (len - 4u))) return true;
-	if(compare_signature(".WAV", audio_params.filein_dir, (len - 4u))) return true;
+		if(stdin_stream) n_ret = stream_get_params(STDIN_FILENO, params);
+		else n_ret = file_get_params(STDIN_FILENO, params);
 
-	return false;
-}
+		startup_trace_mark(&startup_trace, STARTUP_FILE_GET_PARAMS);
 
-bool file_open(void)
-{
-	if(audio_params.filein_dir == nullptr) return false;
+		if(n_ret < 0)
+		{
+			std::cout << "Error: audio format not supported\n";
+			return -1;
+		}
 
-	fd = open(audio_params.filein_dir, O_RDONLY);
-	if(fd < 0) return false;
+		return n_ret;
+	}
 
-	fsize = __LSEEK(fd, 0, SEEK_END);
-	return true;
-}
+	//An unchanged file listed in the catalog is neither opened nor parsed
+	if(catalog_enable)
+	{
+		n_ret = catalog.getParams(filein_dir, params);
+		if(n_ret >= 0)
+		{
+			startup_trace_mark(&startup_trace, STARTUP_FILE_GET_PARAMS);
+			return n_ret;
+		}
+	}
 
-void file_close(void)
-{
-	if(fd < 0) return;
+	if(!file_ext_check(filein_dir))
+	{
+		std::cout << "Error: file format is not supported\n";
+		return -1;
+	}
 
-	close(fd);
-	fd = -1;
-	fsize = 0;
-	return;
+	startup_trace_mark(&startup_trace, STARTUP_FILE_EXT_CHECK);
+
+	fd = file_open(filein_dir);
+	if(fd < 0)
+	{
+		std::cout << "Error: could not open audio file\n";
+		return -1;
+	}
+
+	startup_trace_mark(&startup_trace, STARTUP_FILE_OPEN);
+
+	n_ret = file_get_params(fd, params);
+	file_close(fd);
+
+	startup_trace_mark(&startup_trace, STARTUP_FILE_GET_PARAMS);
+
+	if(n_ret < 0)
+	{
+		std::cout << "Error: audio format not supported\n";
+		return -1;
+	}
+
+	return n_ret;
 }
 
-int file_get_params(void)
+bool parse_loop_region(const char *arg)
 {
-	char *header_info = (char*) std::malloc(BYTEBUF_SIZE);
-	std::uint16_t *pu16 = NULL;
-	std::uint32_t *pu32 = NULL;
+	char *endptr = nullptr;
 
-	size_t bytepos = 0u;
+	loop_begin_frame = std::strtoull(arg, &endptr, 10);
+	if(*endptr != ':') return false;
 
-	std::uint16_t n_channels = 0u;
-	std::uint32_t bit_depth = 0u;
+	loop_end_frame = std::strtoull(endptr + 1, &endptr, 10);
+	if(loop_end_frame <= loop_begin_frame) return false;
 
-	__LSEEK(fd, 0, SEEK_SET);
-	read(fd, header_info, BYTEBUF_SIZE);
-	file_close();
+	//Loop forever unless a count is given
+	loop_count = -1;
+	if(*endptr == ':') loop_count = (int) std::strtol(endptr + 1, &endptr, 10);
 
-	//Error Check: Invalid Chunk Signature
-	if(!compare_signature("RIFF", header_info, 0u)) return -1;
+	return (*endptr == '\0');
+}
 
-	//Error Check: Invalid Format Signature
-	if(!compare_signature("WAVE", header_info, 8u)) return -1;
+//Files with more than 2 channels, and 16bit PCM files given -c or -M, play through a channel matrix. Returns the format to play, or -1.
+int channel_matrix_resolve(int format, const audio_playback_params_t *params)
+{
+	if((device_channels == 0u) && (channel_matrix_arg == nullptr) && (format != PB_16BITNCH)) return format;
 
-	bytepos = 12u;
+	if((format != PB_16BIT1CH) && (format != PB_16BIT2CH) && (format != PB_16BITNCH))
+	{
+		std::cout << "Error: a channel matrix only applies to 16bit PCM files\n";
+		return -1;
+	}
 
-	//Fetch "fmt " Subchunk
-	while(!compare_signature("fmt ", header_info, bytepos))
+	if(channel_matrix_arg != nullptr)
 	{
-		//Error: subchunk "fmt " not found
-		if(bytepos > (BYTEBUF_SIZE - 256u))
+		if(!channel_matrix_parse(&channel_matrix, channel_matrix_arg))
 		{
-			std::free(header_info);
+			std::cout << "Error: invalid channel matrix\n";
 			return -1;
 		}
 
-		pu32 = (std::uint32_t*) &header_info[bytepos + 4u];
-		bytepos += (size_t) (*pu32 + 8u);
-	}
-
-	pu16 = (std::uint16_t*) &header_info[bytepos + 8u];
+		if(channel_matrix.in_channels != params->n_channels)
+		{
+			std::cout << "Error: every channel matrix row must have one gain per channel of the file (" << params->n_channels << ")\n";
+			return -1;
+		}
 
-	//Error Check: Encoding Format Not Supported
-	if(pu16[0] != 1u)
+		if((device_channels != 0u) && (channel_matrix.out_channels != device_channels))
+		{
+			std::cout << "Error: the channel matrix must have one row per device channel (" << device_channels << ")\n";
+			return -1;
+		}
+	}
+	else if(!channel_matrix_default(&channel_matrix, params->n_channels, (device_channels != 0u) ? device_channels : 2u))
 	{
-		std::free(header_info);
+		std::cout << "Error: unsupported number of channels\n";
 		return -1;
 	}
 
-	n_channels = pu16[1];
-
-	pu32 = (std::uint32_t*) &header_info[bytepos + 12u];
-	audio_params.sample_rate = *pu32;
-
-	pu16 = (std::uint16_t*) &header_info[bytepos + 22u];
-	bit_depth = *pu16;
+	return PB_16BITNCH;
+}
 
-	pu32 = (std::uint32_t*) &header_info[bytepos + 4u];
-	bytepos += (size_t) (*pu32 + 8u);
+AudioPlayback *mixer_create(const char *audio_dev_desc)
+{
+	AudioMixer *mixer = new AudioMixer(audio_dev_desc);
+	audio_playback_params_t params;
+	size_t n_input = 0u;
+	int n_ret = 0;
 
-	//Fetch "data" Subchunk
-	while(!compare_signature("data", header_info, bytepos))
+	for(n_input = 0u; n_input < mixer_inputs.size(); n_input++)
 	{
-		//Error: subchunk "data" not found
-		if(bytepos > (BYTEBUF_SIZE - 256u))
+		n_ret = load_params(mixer_inputs[n_input].filein_dir, &params);
+		if(n_ret < 0)
 		{
-			std::free(header_info);
-			return -1;
+			delete mixer;
+			return nullptr;
 		}
 
-		pu32 = (std::uint32_t*) &header_info[bytepos + 4u];
-		bytepos += (size_t) (*pu32 + 8u);
+		if(!mixer->addStream(&params, n_ret, mixer_inputs[n_input].gain))
+		{
+			std::cout << "Error: " << mixer->getLastErrorMessage() << std::endl;
+			delete mixer;
+			return nullptr;
+		}
 	}
 
-	pu32 = (std::uint32_t*) &header_info[bytepos + 4u];
+	if(mixer->getStreamCount() == 0u)
+	{
+		std::cout << "Error: no audio file to play\n";
+		delete mixer;
+		return nullptr;
+	}
 
-	audio_params.audio_data_begin = (__offset) (bytepos + 8u);
-	audio_params.audio_data_end = audio_params.audio_data_begin + ((__offset) *pu32);
+	return mixer;
+}
+
+void print_startup_trace(void)
+{
+	int n_phase = 0;
+	std::int64_t phase_ns = 0;
+
+	std::cerr << "Startup trace (microseconds):\n";
+
+	for(n_phase = 1; n_phase < STARTUP_PHASE_COUNT; n_phase++)
+	{
+		phase_ns = startup_trace_phase_ns(&startup_trace, n_phase);
+		if(phase_ns < 0) continue;
 
-	std::free(header_info);
+		std::cerr << "  " << startup_phase_name(n_phase) << ": " << (phase_ns/1000) << "." << ((phase_ns/100)%10) << "\n";
+	}
 
-	if((bit_depth == 16u) && (n_channels == 1u)) return PB_16BIT1CH;
-	if((bit_depth == 16u) && (n_channels == 2u)) return PB_16BIT2CH;
-	if((bit_depth == 24u) && (n_channels == 1u)) return PB_24BIT1CH;
-	if((bit_depth == 24u) && (n_channels == 2u)) return PB_24BIT2CH;
+	if(startup_trace.tstamp_ns[STARTUP_FIRST_WRITE] >= 0)
+	{
+		phase_ns = startup_trace.tstamp_ns[STARTUP_FIRST_WRITE] - startup_trace.tstamp_ns[STARTUP_TRIGGER];
+		std::cerr << "  time to first sample: " << (phase_ns/1000) << "." << ((phase_ns/100)%10) << "\n";
+	}
 
-	return -1;
+	return;
 }
 
-bool compare_signature(const char *auth, const char *bytebuf, size_t offset)
+//SIGUSR1 is blocked in every thread and taken synchronously by a dump thread, so printing never runs in signal context
+void period_stats_start(void)
 {
-	if(auth == nullptr) return false;
-	if(bytebuf == nullptr) return false;
+	sigset_t sigset;
 
-	if(auth[0] != bytebuf[offset]) return false;
-	if(auth[1] != bytebuf[offset + 1u]) return false;
-	if(auth[2] != bytebuf[offset + 2u]) return false;
-	if(auth[3] != bytebuf[offset + 3u]) return false;
+	period_stats_reset(&period_stats);
 
-	return true;
+	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &sigset, nullptr);
+
+	std::thread dump_thread([sigset]()
+	{
+		int signum = 0;
+
+		while(sigwait(&sigset, &signum) == 0) period_stats_print(&period_stats, stderr);
+	});
+
+	dump_thread.detach();
+	return;
 }
 
+int stats_file_format(const char *fileout_dir)
+{
+	std::string fileout = "";
+
+	if(fileout_dir == nullptr) return STATS_FORMAT_JSON;
+
+	fileout = fileout_dir;
+	if((fileout.size() > 5u) && (fileout.compare(fileout.size() - 5u, 5u, ".prom") == 0)) return STATS_FORMAT_PROMETHEUS;
+
+	return STATS_FORMAT_JSON;
+}
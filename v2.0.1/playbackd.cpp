@@ -0,0 +1,406 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Playback daemon.
+ * Keeps the audio device open and configured, and plays files on request. Requests are text lines sent over
+ * a Unix domain stream socket, every request gets one reply line starting with "OK" or "ERROR".
+ *
+ * play [-g <Gain>] <File>    stops everything playing or queued, then plays the file
+ * queue [-g <Gain>] <File>   plays the file after the ones already playing or queued
+ * stop                       stops everything playing or queued
+ * seek <Frame>               seeks the file that is playing
+ * load <File>                decodes the file into the clip cache ahead of time
+ * status                     replies with: OK active <Files Playing> queued <Files Queued> frames_played <Frames>
+ * quit                       closes the device and ends the daemon
+ *
+ * Usage: playbackd.elf <Audio Device> <Socket Path> [-r <Sample Rate>] [-c <Clip Cache Size in MiB>] [-R <Readahead Window in MiB>] [-C <Catalog File>]
+ * Every file must have the device sample rate (48000 by default). Files are 16bit or 24bit PCM, mono or stereo.
+ * With a clip cache, files are decoded into memory on first use and played from there, any supported format
+ * works, and files too large for the cache are streamed from disk as usual.
+ * With a readahead window, files streamed from disk are read ahead by that much and dropped from the page cache
+ * once played, so long files do not push everything else out of it.
+ * With a catalog (written by catalog.elf), files listed in it and unchanged since are played without parsing their header.
+ */
+
+#include "globaldef.h"
+#include "AudioMixer.hpp"
+#include "ClipCache.hpp"
+#include "WaveHeader.hpp"
+#include "AudioCatalog.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <thread>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define CLIENT_LINE_MAX 4096u
+
+struct daemon_client {
+	int fd;
+	std::string linebuf;
+};
+
+typedef struct daemon_client daemon_client_t;
+
+static AudioMixer *mixer = nullptr;
+static ClipCache *clip_cache = nullptr;
+static AudioCatalog catalog;
+static int playback_pipe[2] = {-1, -1};
+static bool playback_ok = false;
+
+static int socket_open(const char *socket_dir);
+static void playback_thread_proc(void);
+static bool client_read(daemon_client_t *client, bool *quit);
+static std::string request_proc(const std::string &request, bool *quit);
+static std::string request_stream(const std::string &args, bool queue);
+static int load_params(const char *filein_dir, audio_playback_params_t *params);
+
+int main(int argc, char **argv)
+{
+	std::vector<struct pollfd> pollfds;
+	std::vector<daemon_client_t> clients;
+	sigset_t sigset;
+	std::uint32_t sample_rate = 48000u;
+	size_t cache_size = 0u;
+	size_t readahead_window = 0u;
+	int listen_fd = -1;
+	int signal_fd = -1;
+	int n_arg = 0;
+	size_t n_client = 0u;
+	bool quit = false;
+	std::thread playback_thread;
+
+	if(argc < 3)
+	{
+		std::cout << "Error: missing arguments\nThis executable requires two arguments: <Audio Device> <Socket Path>\n";
+		std::cout << "Options: -r <Sample Rate> (default 48000), -c <Clip Cache Size in MiB>, -R <Readahead Window in MiB>, -C <Catalog File>\n";
+		return 0;
+	}
+
+	for(n_arg = 3; n_arg < argc; n_arg++)
+	{
+		if((std::string(argv[n_arg]) == "-r") && ((n_arg + 1) < argc)) sample_rate = (std::uint32_t) std::strtoul(argv[++n_arg], nullptr, 10);
+		else if((std::string(argv[n_arg]) == "-c") && ((n_arg + 1) < argc)) cache_size = ((size_t) std::strtoul(argv[++n_arg], nullptr, 10)) << 20;
+		else if((std::string(argv[n_arg]) == "-R") && ((n_arg + 1) < argc)) readahead_window = ((size_t) std::strtoul(argv[++n_arg], nullptr, 10)) << 20;
+		else if((std::string(argv[n_arg]) == "-C") && ((n_arg + 1) < argc))
+		{
+			if(!catalog.open(argv[++n_arg]))
+			{
+				std::cout << "Error: " << catalog.getLastErrorMessage() << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	//Signals are taken through a signalfd, so they only interrupt the poll loop
+	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGINT);
+	sigaddset(&sigset, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &sigset, nullptr);
+	signal(SIGPIPE, SIG_IGN);
+
+	signal_fd = signalfd(-1, &sigset, SFD_CLOEXEC);
+
+	listen_fd = socket_open(argv[2]);
+	if(listen_fd < 0)
+	{
+		std::cout << "Error: could not open control socket\n";
+		return 1;
+	}
+
+	if(pipe(playback_pipe) < 0)
+	{
+		std::cout << "Error: could not create pipe\n";
+		close(listen_fd);
+		return 1;
+	}
+
+	if(cache_size > 0u) clip_cache = new ClipCache(cache_size);
+
+	mixer = new AudioMixer(argv[1]);
+	mixer->setContinuous(true);
+	mixer->setVerbose(false);
+	mixer->setReadahead(readahead_window);
+
+	if(!mixer->setSampleRate(sample_rate))
+	{
+		std::cout << "Error: invalid sample rate\n";
+		delete mixer;
+		close(listen_fd);
+		return 1;
+	}
+
+	//The device is opened and configured right away, and stays that way until quit
+	playback_thread = std::thread(playback_thread_proc);
+
+	while(!quit)
+	{
+		pollfds.clear();
+		pollfds.push_back({listen_fd, POLLIN, 0});
+		pollfds.push_back({playback_pipe[0], POLLIN, 0});
+		pollfds.push_back({signal_fd, POLLIN, 0});
+
+		for(n_client = 0u; n_client < clients.size(); n_client++) pollfds.push_back({clients[n_client].fd, POLLIN, 0});
+
+		if(poll(pollfds.data(), pollfds.size(), -1) < 0)
+		{
+			if(errno == EINTR) continue;
+			break;
+		}
+
+		//Playback ended on its own: the device failed
+		if(pollfds[1].revents) break;
+
+		if(pollfds[2].revents)
+		{
+			quit = true;
+			break;
+		}
+
+		if(pollfds[0].revents & POLLIN)
+		{
+			int client_fd = accept(listen_fd, nullptr, nullptr);
+			if(client_fd >= 0) clients.push_back({client_fd, ""});
+		}
+
+		//Clients accepted in this pass are not in pollfds yet
+		for(n_client = pollfds.size() - 3u; n_client > 0u; n_client--)
+		{
+			if(!pollfds[n_client + 2u].revents) continue;
+
+			if(!client_read(&clients[n_client - 1u], &quit))
+			{
+				close(clients[n_client - 1u].fd);
+				clients.erase(clients.begin() + (n_client - 1u));
+			}
+		}
+	}
+
+	mixer->shutdown();
+	playback_thread.join();
+
+	for(n_client = 0u; n_client < clients.size(); n_client++) close(clients[n_client].fd);
+
+	close(listen_fd);
+	unlink(argv[2]);
+	if(signal_fd >= 0) close(signal_fd);
+	close(playback_pipe[0]);
+	close(playback_pipe[1]);
+
+	if(!playback_ok)
+	{
+		std::cout << "Error: " << mixer->getLastErrorMessage() << std::endl;
+		delete mixer;
+		if(clip_cache != nullptr) delete clip_cache;
+		return 1;
+	}
+
+	delete mixer;
+	if(clip_cache != nullptr) delete clip_cache;
+	return 0;
+}
+
+static int socket_open(const char *socket_dir)
+{
+	struct sockaddr_un addr;
+	int fd = -1;
+
+	if(std::string(socket_dir).size() >= sizeof(addr.sun_path)) return -1;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(fd < 0) return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_dir);
+
+	//A socket file left behind by a previous run would make bind fail
+	unlink(socket_dir);
+
+	if((bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) || (listen(fd, 8) < 0))
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void playback_thread_proc(void)
+{
+	char byte = 0;
+
+	playback_ok = mixer->runPlayback();
+	write(playback_pipe[1], &byte, 1);
+	return;
+}
+
+//Returns false when the client has to be dropped
+static bool client_read(daemon_client_t *client, bool *quit)
+{
+	char readbuf[1024];
+	ssize_t n_read = 0;
+	size_t line_end = 0u;
+	std::string reply = "";
+
+	n_read = read(client->fd, readbuf, sizeof(readbuf));
+	if(n_read <= 0) return false;
+
+	client->linebuf.append(readbuf, (size_t) n_read);
+
+	while((line_end = client->linebuf.find('\n')) != std::string::npos)
+	{
+		std::string request = client->linebuf.substr(0u, line_end);
+		client->linebuf.erase(0u, line_end + 1u);
+
+		if(!request.empty() && (request.back() == '\r')) request.pop_back();
+
+		reply = request_proc(request, quit) + "\n";
+		if(send(client->fd, reply.c_str(), reply.size(), MSG_NOSIGNAL) < 0) return false;
+
+		if(*quit) return true;
+	}
+
+	if(client->linebuf.size() > CLIENT_LINE_MAX) return false;
+
+	return true;
+}
+
+static std::string request_proc(const std::string &request, bool *quit)
+{
+	audio_playback_position_t position;
+	std::string command = request;
+	std::string args = "";
+	size_t n_char = request.find(' ');
+
+	if(n_char != std::string::npos)
+	{
+		command = request.substr(0u, n_char);
+		args = request.substr(n_char + 1u);
+	}
+
+	if(command == "play") return request_stream(args, false);
+	if(command == "queue") return request_stream(args, true);
+
+	if(command == "load")
+	{
+		std::shared_ptr<const audio_clip_t> clip = nullptr;
+
+		if(clip_cache == nullptr) return "ERROR no clip cache";
+		if(args.empty()) return "ERROR missing file";
+
+		clip = clip_cache->getClip(args.c_str());
+		if(clip == nullptr) return "ERROR " + clip_cache->getLastErrorMessage();
+
+		return "OK frames " + std::to_string(clip->n_frames);
+	}
+
+	if(command == "stop")
+	{
+		mixer->stopStreams();
+		return "OK";
+	}
+
+	if(command == "seek")
+	{
+		if(args.empty()) return "ERROR missing frame";
+
+		mixer->seekStream(std::strtoull(args.c_str(), nullptr, 10));
+		return "OK";
+	}
+
+	if(command == "status")
+	{
+		if(!mixer->getPlaybackPosition(&position)) position.frames_played = 0u;
+
+		return "OK active " + std::to_string(mixer->getActiveStreamCount()) + " queued " + std::to_string(mixer->getQueuedStreamCount()) + " frames_played " + std::to_string(position.frames_played);
+	}
+
+	if(command == "quit")
+	{
+		*quit = true;
+		return "OK";
+	}
+
+	return "ERROR unknown request";
+}
+
+static std::string request_stream(const std::string &args, bool queue)
+{
+	audio_playback_params_t params;
+	std::string filein_dir = args;
+	float gain = 1.0f;
+	int format = 0;
+	bool ok = false;
+
+	if(filein_dir.compare(0u, 3u, "-g ") == 0)
+	{
+		char *gain_end = nullptr;
+
+		gain = std::strtof(filein_dir.c_str() + 3, &gain_end);
+		filein_dir = gain_end;
+
+		while(!filein_dir.empty() && (filein_dir.front() == ' ')) filein_dir.erase(0u, 1u);
+	}
+
+	if(filein_dir.empty()) return "ERROR missing file";
+
+	if(clip_cache != nullptr)
+	{
+		std::shared_ptr<const audio_clip_t> clip = clip_cache->getClip(filein_dir.c_str());
+
+		if(clip != nullptr)
+		{
+			if(queue) ok = mixer->queueClip(clip, gain);
+			else ok = mixer->playClip(clip, gain);
+
+			if(!ok) return "ERROR " + mixer->getLastErrorMessage();
+			return "OK";
+		}
+	}
+
+	format = load_params(filein_dir.c_str(), &params);
+	if(format < 0) return "ERROR could not read file";
+
+	if(queue) ok = mixer->queueStream(&params, format, gain);
+	else ok = mixer->playStream(&params, format, gain);
+
+	if(!ok) return "ERROR " + mixer->getLastErrorMessage();
+
+	return "OK";
+}
+
+static int load_params(const char *filein_dir, audio_playback_params_t *params)
+{
+	int fd = -1;
+	int n_ret = 0;
+
+	params->audio_dev_desc = nullptr;
+	params->filein_dir = (char*) filein_dir;
+
+	n_ret = catalog.getParams(filein_dir, params);
+	if(n_ret >= 0) return n_ret;
+
+	if(!file_ext_check(filein_dir)) return -1;
+
+	fd = file_open(filein_dir);
+	if(fd < 0) return -1;
+
+	n_ret = file_get_params(fd, params);
+	file_close(fd);
+
+	return n_ret;
+}
@@ -0,0 +1,168 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Multi-device playout.
+ * Plays one file on each of several audio devices from a single process. Devices share a small pool of I/O worker
+ * threads for file reads and conversion, and are written by one poll-based writer thread per core (see PlayoutEngine).
+ * Every file plays at its own sample rate and format. SIGINT or SIGTERM stops all devices.
+ * -D reads every file with O_DIRECT, bypassing the page cache (see DirectReader).
+ *
+ * Usage: playout.elf [-j <I/O Threads>] [-w <Writer Threads>] [-r <Ring Periods>] [-D] <Audio Device> <File> [<Audio Device> <File> ...]
+ */
+
+#include "globaldef.h"
+#include "AudioPlayback.hpp"
+#include "AudioPlaybackFactory.hpp"
+#include "PlayoutEngine.hpp"
+#include "WaveHeader.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+
+struct playout_arg {
+	std::string audio_dev_desc;
+	std::string filein_dir;
+};
+
+typedef struct playout_arg playout_arg_t;
+
+static std::vector<playout_arg_t> playout_args;
+static unsigned int n_io_workers = 0u;
+static unsigned int n_writers = 0u;
+static size_t ring_periods = PLAYOUT_RING_PERIODS;
+static bool direct_io = false;
+
+static bool parse_args(int argc, char **argv);
+static int load_params(playout_arg_t *arg, audio_playback_params_t *params);
+
+int main(int argc, char **argv)
+{
+	std::vector<AudioPlayback*> pb_objs;
+	audio_playback_params_t params;
+	audio_playback_stats_t stats;
+	sigset_t sigset;
+	size_t n_output = 0u;
+	int format = 0;
+	bool ok = true;
+
+	if(!parse_args(argc, argv))
+	{
+		std::cout << "Usage: playout.elf [-j <I/O Threads>] [-w <Writer Threads>] [-r <Ring Periods>] [-D] <Audio Device> <File> [<Audio Device> <File> ...]\n";
+		return 0;
+	}
+
+	PlayoutEngine engine(n_io_workers, n_writers, ring_periods);
+
+	for(n_output = 0u; n_output < playout_args.size(); n_output++)
+	{
+		format = load_params(&playout_args[n_output], &params);
+		if(format < 0)
+		{
+			std::cout << "Error: could not read audio file " << playout_args[n_output].filein_dir << std::endl;
+			ok = false;
+			break;
+		}
+
+		pb_objs.push_back(audio_playback_create(format, &params));
+		if(pb_objs.back() == nullptr)
+		{
+			std::cout << "Error: could not create playback object\n";
+			pb_objs.pop_back();
+			ok = false;
+			break;
+		}
+
+		pb_objs.back()->setVerbose(false);
+		pb_objs.back()->setDirectIO(direct_io);
+		engine.addOutput(pb_objs.back());
+	}
+
+	if(ok)
+	{
+		//Blocked before any thread starts, so only the signal thread takes them
+		sigemptyset(&sigset);
+		sigaddset(&sigset, SIGINT);
+		sigaddset(&sigset, SIGTERM);
+		pthread_sigmask(SIG_BLOCK, &sigset, nullptr);
+
+		std::thread signal_thread([sigset, &engine]()
+		{
+			int signum = 0;
+
+			if(sigwait(&sigset, &signum) == 0) engine.stop();
+		});
+
+		if(!engine.run())
+		{
+			std::cout << "Error: " << engine.getLastErrorMessage() << std::endl;
+			ok = false;
+		}
+
+		//Playback ended on its own: wake the signal thread (it still takes SIGTERM) so it is gone before the engine
+		pthread_kill(signal_thread.native_handle(), SIGTERM);
+		signal_thread.join();
+
+		for(n_output = 0u; n_output < pb_objs.size(); n_output++)
+		{
+			if(!pb_objs[n_output]->getStats(&stats)) continue;
+
+			std::fprintf(stderr, "%s: %llu frames, %llu xruns\n", playout_args[n_output].audio_dev_desc.c_str(), (unsigned long long) stats.frames_written, (unsigned long long) stats.xruns);
+		}
+	}
+
+	for(n_output = 0u; n_output < pb_objs.size(); n_output++) delete pb_objs[n_output];
+
+	return ok ? 0 : 1;
+}
+
+static bool parse_args(int argc, char **argv)
+{
+	std::vector<std::string> args;
+	size_t n_pair = 0u;
+	int n_arg = 0;
+
+	for(n_arg = 1; n_arg < argc; n_arg++)
+	{
+		std::string arg = argv[n_arg];
+
+		if((arg == "-j") && ((n_arg + 1) < argc)) n_io_workers = (unsigned int) std::strtoul(argv[++n_arg], nullptr, 10);
+		else if((arg == "-w") && ((n_arg + 1) < argc)) n_writers = (unsigned int) std::strtoul(argv[++n_arg], nullptr, 10);
+		else if((arg == "-r") && ((n_arg + 1) < argc)) ring_periods = (size_t) std::strtoul(argv[++n_arg], nullptr, 10);
+		else if(arg == "-D") direct_io = true;
+		else args.push_back(arg);
+	}
+
+	if(args.empty() || (args.size()%2u)) return false;
+
+	for(n_pair = 0u; n_pair < args.size(); n_pair += 2u) playout_args.push_back({args[n_pair], args[n_pair + 1u]});
+
+	return true;
+}
+
+static int load_params(playout_arg_t *arg, audio_playback_params_t *params)
+{
+	int fd = -1;
+	int n_ret = 0;
+
+	if(!file_ext_check(arg->filein_dir.c_str())) return -1;
+
+	fd = file_open(arg->filein_dir.c_str());
+	if(fd < 0) return -1;
+
+	params->audio_dev_desc = (char*) arg->audio_dev_desc.c_str();
+	params->filein_dir = (char*) arg->filein_dir.c_str();
+
+	n_ret = file_get_params(fd, params);
+	file_close(fd);
+
+	return n_ret;
+}
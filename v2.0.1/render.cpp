@@ -0,0 +1,315 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Offline renderer.
+ * Runs the playback pipeline (decoding and conversion of every supported format) with the output going to a file
+ * instead of an audio device, as fast as possible. The audio data is split in block aligned chunks, one per worker
+ * thread, and every worker writes its own part of the output file.
+ * Output is the device format: 16bit stereo, or 24bit stereo (S24_LE in 4 bytes for raw output, packed 3 bytes in a WAV file).
+ * Non-seekable outputs (stdout, pipes) are written by a single worker.
+ *
+ * Usage: render.elf [-j <Threads>] [-f raw|wav] <Audio File Directory> <Output File | ->
+ */
+
+#include "globaldef.h"
+#include "AudioPlayback.hpp"
+#include "AudioPlaybackFactory.hpp"
+#include "WaveHeader.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include <sys/stat.h>
+
+#define WAVE_HEADER_SIZE 44u
+
+struct render_chunk {
+	audio_playback_params_t params;
+	__offset fileout_pos;
+	std::uint64_t n_frames;
+	bool ok;
+	std::string error_msg;
+};
+
+typedef struct render_chunk render_chunk_t;
+
+static std::string filein_dir = "";
+static std::string fileout_dir = "";
+static unsigned int n_threads = 0u;
+static bool wave_output = false;
+static bool wave_output_set = false;
+
+static int audio_format = -1;
+static int fileout = -1;
+
+static bool parse_args(int argc, char **argv);
+static int load_params(audio_playback_params_t *params);
+static bool write_wave_header(std::uint32_t sample_rate, unsigned int bit_depth, std::uint64_t n_frames);
+static void render_chunk_proc(render_chunk_t *chunk);
+
+int main(int argc, char **argv)
+{
+	audio_playback_params_t params;
+	std::vector<render_chunk_t> chunks;
+	std::vector<std::thread> workers;
+	struct timespec tspec_begin;
+	struct timespec tspec_end;
+	struct stat filein_stat;
+	size_t block_size = 0u;
+	size_t block_frames = 0u;
+	size_t fileout_frame_size = 0u;
+	std::uint64_t n_blocks = 0u;
+	std::uint64_t blocks_per_chunk = 0u;
+	std::uint64_t n_frames = 0u;
+	std::uint64_t n_block = 0u;
+	__offset data_size = 0;
+	__offset tail_size = 0;
+	__offset fileout_begin = 0;
+	unsigned int n_chunk = 0u;
+	bool seekable = false;
+	bool ok = true;
+	double elapsed = 0.0;
+
+	if(!parse_args(argc, argv))
+	{
+		std::cout << "Usage: render.elf [-j <Threads>] [-f raw|wav] <Audio File Directory> <Output File | ->\n";
+		return 0;
+	}
+
+	audio_format = load_params(&params);
+	if(audio_format < 0)
+	{
+		std::cout << "Error: could not read audio file\n";
+		return 1;
+	}
+
+	//Files shorter than their header claims end where the file ends
+	if((stat(filein_dir.c_str(), &filein_stat) == 0) && (params.audio_data_end > (__offset) filein_stat.st_size)) params.audio_data_end = (__offset) filein_stat.st_size;
+
+	//Chunks are split on block boundaries: one frame for PCM and G.711, one compressed block for IMA ADPCM
+	block_size = (size_t) params.block_align;
+	block_frames = (audio_format == PB_IMAADPCM) ? (size_t) params.samples_per_block : 1u;
+
+	if(block_size == 0u)
+	{
+		std::cout << "Error: invalid block size\n";
+		return 1;
+	}
+
+	data_size = params.audio_data_end - params.audio_data_begin;
+	n_blocks = (std::uint64_t) (data_size/((__offset) block_size));
+	tail_size = data_size%((__offset) block_size);
+	n_frames = n_blocks*block_frames;
+
+	//A truncated last ADPCM block still decodes its header sample plus every complete group of 8 samples
+	if((audio_format == PB_IMAADPCM) && (tail_size >= (__offset) (4u*params.n_channels)))
+	{
+		n_frames += 8u*((std::uint64_t) ((tail_size - 4*params.n_channels)/(4*params.n_channels))) + 1u;
+		n_blocks++;
+	}
+
+	if((audio_format == PB_24BIT1CH) || (audio_format == PB_24BIT2CH)) fileout_frame_size = wave_output ? 6u : 8u;
+	else fileout_frame_size = 4u;
+
+	if(fileout_dir == "-") fileout = STDOUT_FILENO;
+	else fileout = open(fileout_dir.c_str(), (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+
+	if(fileout < 0)
+	{
+		std::cout << "Error: could not open output file\n";
+		return 1;
+	}
+
+	seekable = (__LSEEK(fileout, 0, SEEK_CUR) >= 0);
+
+	if(wave_output)
+	{
+		if(!write_wave_header(params.sample_rate, (fileout_frame_size == 6u) ? 24u : 16u, n_frames))
+		{
+			std::cout << "Error: could not write output file\n";
+			if(fileout != STDOUT_FILENO) close(fileout);
+			return 1;
+		}
+
+		fileout_begin = WAVE_HEADER_SIZE;
+	}
+
+	if(!seekable) n_threads = 1u;
+	if(n_threads == 0u) n_threads = std::thread::hardware_concurrency();
+	if(n_threads == 0u) n_threads = 1u;
+
+	//Chunks shorter than a few periods are not worth a thread
+	if((n_blocks*block_frames) < (((std::uint64_t) n_threads)*4u*RENDER_PERIOD_FRAMES)) n_threads = (unsigned int) ((n_blocks*block_frames)/(4u*RENDER_PERIOD_FRAMES)) + 1u;
+
+	blocks_per_chunk = (n_blocks + n_threads - 1u)/n_threads;
+
+	if(seekable && (ftruncate(fileout, fileout_begin + (__offset) (n_frames*fileout_frame_size)) < 0))
+	{
+		std::cout << "Error: could not allocate output file\n";
+		if(fileout != STDOUT_FILENO) close(fileout);
+		return 1;
+	}
+
+	for(n_chunk = 0u; n_chunk < n_threads; n_chunk++)
+	{
+		render_chunk_t chunk;
+
+		n_block = ((std::uint64_t) n_chunk)*blocks_per_chunk;
+		if(n_block >= n_blocks) break;
+
+		chunk.params = params;
+		chunk.params.loop_count = 0; //Rendered straight through, the loop points are not expanded
+		chunk.params.audio_data_begin = params.audio_data_begin + (__offset) (n_block*block_size);
+		chunk.params.audio_data_end = chunk.params.audio_data_begin + (__offset) (blocks_per_chunk*block_size);
+		if(chunk.params.audio_data_end > params.audio_data_end) chunk.params.audio_data_end = params.audio_data_end;
+
+		chunk.fileout_pos = seekable ? (fileout_begin + (__offset) (n_block*block_frames*fileout_frame_size)) : -1;
+		chunk.n_frames = blocks_per_chunk*block_frames;
+		if((n_block*block_frames + chunk.n_frames) > n_frames) chunk.n_frames = n_frames - n_block*block_frames;
+
+		chunk.ok = false;
+		chunks.push_back(chunk);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &tspec_begin);
+
+	for(n_chunk = 0u; n_chunk < chunks.size(); n_chunk++) workers.push_back(std::thread(render_chunk_proc, &chunks[n_chunk]));
+	for(n_chunk = 0u; n_chunk < workers.size(); n_chunk++) workers[n_chunk].join();
+
+	clock_gettime(CLOCK_MONOTONIC, &tspec_end);
+
+	if(fileout != STDOUT_FILENO) close(fileout);
+
+	for(n_chunk = 0u; n_chunk < chunks.size(); n_chunk++)
+	{
+		if(chunks[n_chunk].ok) continue;
+
+		std::cerr << "Error: " << chunks[n_chunk].error_msg << std::endl;
+		ok = false;
+	}
+
+	if(!ok) return 1;
+
+	elapsed = ((double) (tspec_end.tv_sec - tspec_begin.tv_sec)) + ((double) (tspec_end.tv_nsec - tspec_begin.tv_nsec))*1e-9;
+
+	std::fprintf(stderr, "Rendered %llu frames with %u threads in %.3f s (%.1fx realtime)\n", (unsigned long long) n_frames, (unsigned int) chunks.size(), elapsed,
+		(elapsed > 0.0) ? (((double) n_frames)/((double) params.sample_rate)/elapsed) : 0.0);
+
+	return 0;
+}
+
+static bool parse_args(int argc, char **argv)
+{
+	std::vector<std::string> files;
+	int n_arg = 0;
+
+	for(n_arg = 1; n_arg < argc; n_arg++)
+	{
+		std::string arg = argv[n_arg];
+
+		if((arg == "-j") && ((n_arg + 1) < argc)) n_threads = (unsigned int) std::strtoul(argv[++n_arg], nullptr, 10);
+		else if((arg == "-f") && ((n_arg + 1) < argc))
+		{
+			wave_output = (std::string(argv[++n_arg]) == "wav");
+			wave_output_set = true;
+		}
+		else files.push_back(arg);
+	}
+
+	if(files.size() != 2u) return false;
+
+	filein_dir = files[0];
+	fileout_dir = files[1];
+
+	if(!wave_output_set) wave_output = (fileout_dir.size() > 4u) && (fileout_dir.compare(fileout_dir.size() - 4u, 4u, ".wav") == 0);
+
+	return true;
+}
+
+static int load_params(audio_playback_params_t *params)
+{
+	int fd = -1;
+	int n_ret = 0;
+
+	if(!file_ext_check(filein_dir.c_str())) return -1;
+
+	fd = file_open(filein_dir.c_str());
+	if(fd < 0) return -1;
+
+	//No audio device is opened when rendering
+	params->audio_dev_desc = (char*) "render";
+	params->filein_dir = (char*) filein_dir.c_str();
+
+	n_ret = file_get_params(fd, params);
+	file_close(fd);
+
+	return n_ret;
+}
+
+static bool write_wave_header(std::uint32_t sample_rate, unsigned int bit_depth, std::uint64_t n_frames)
+{
+	std::uint8_t header[WAVE_HEADER_SIZE];
+	std::uint64_t data_size = n_frames*2u*(bit_depth/8u);
+	std::uint32_t block_align = 2u*(bit_depth/8u);
+	std::uint32_t byte_rate = sample_rate*block_align;
+	std::uint32_t chunk_size = 0u;
+
+	//Sizes that don't fit in 32 bits are saturated, as most readers then read up to the end of the file
+	if(data_size > 0xffffffffu - (WAVE_HEADER_SIZE - 8u)) data_size = 0xffffffffu - (WAVE_HEADER_SIZE - 8u);
+	chunk_size = (std::uint32_t) data_size + (WAVE_HEADER_SIZE - 8u);
+
+	memcpy(&header[0], "RIFF", 4);
+	memcpy(&header[4], &chunk_size, 4);
+	memcpy(&header[8], "WAVEfmt ", 8);
+
+	header[16] = 16u;
+	header[17] = 0u;
+	header[18] = 0u;
+	header[19] = 0u;
+	header[20] = (std::uint8_t) WAVE_FORMAT_PCM;
+	header[21] = 0u;
+	header[22] = 2u;
+	header[23] = 0u;
+
+	memcpy(&header[24], &sample_rate, 4);
+	memcpy(&header[28], &byte_rate, 4);
+
+	header[32] = (std::uint8_t) block_align;
+	header[33] = 0u;
+	header[34] = (std::uint8_t) bit_depth;
+	header[35] = 0u;
+
+	memcpy(&header[36], "data", 4);
+	chunk_size = (std::uint32_t) data_size;
+	memcpy(&header[40], &chunk_size, 4);
+
+	return (write(fileout, header, WAVE_HEADER_SIZE) == (ssize_t) WAVE_HEADER_SIZE);
+}
+
+static void render_chunk_proc(render_chunk_t *chunk)
+{
+	AudioPlayback *pb_obj = audio_playback_create(audio_format, &chunk->params);
+
+	if(pb_obj == nullptr)
+	{
+		chunk->error_msg = "could not create playback object";
+		return;
+	}
+
+	pb_obj->setVerbose(false);
+	pb_obj->setRenderOutput(fileout, chunk->fileout_pos, chunk->n_frames, wave_output);
+
+	chunk->ok = pb_obj->runPlayback();
+	if(!chunk->ok) chunk->error_msg = pb_obj->getLastErrorMessage();
+
+	delete pb_obj;
+	return;
+}
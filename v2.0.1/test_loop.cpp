@@ -0,0 +1,314 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Loop playback test.
+ * Writes short 16bit stereo WAV files with a known ramp, renders them looped (render mode, no audio device) and
+ * checks that every output frame is the source frame it should be, and that playback ends where the loop count says.
+ * Loops are set by hand, or stored in a "smpl" chunk after the audio data and read the way playback.elf reads them.
+ * The render output is the device format, which for 16bit stereo is the source format, so frames compare as they are.
+ *
+ * Usage: test_loop.elf
+ */
+
+#include "globaldef.h"
+#include "AudioPlayback.hpp"
+#include "AudioPlaybackFactory.hpp"
+#include "WaveHeader.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#define WAVE_HEADER_SIZE 44u
+#define TEST_FRAME_SIZE 4u
+#define SMPL_CHUNK_SIZE 60u
+
+struct loop_test {
+	const char *name;
+	std::uint32_t file_frames;
+	std::uint32_t loop_begin;
+	int loop_count; //Repeats after the first pass, -1 endless. A "smpl" chunk stores it as dwPlayCount, the plays in all.
+	bool smpl; //Loop stored in the file rather than set on the parameters
+	std::uint64_t render_frames;
+	std::uint64_t expect_frames;
+	std::uint32_t cut_frames; //The file ends after this many frames, whatever its header says. 0: no cut.
+};
+
+typedef struct loop_test loop_test_t;
+
+static std::uint32_t test_frame(std::uint32_t n_frame)
+{
+	//Left and right differ, so swapped or shifted channels show up too
+	return (n_frame & 0xffffu) | ((n_frame ^ 0x5a5au) << 16);
+}
+
+static void put_u32(std::vector<std::uint8_t> &buf, std::uint32_t value)
+{
+	buf.push_back((std::uint8_t) value);
+	buf.push_back((std::uint8_t) (value >> 8));
+	buf.push_back((std::uint8_t) (value >> 16));
+	buf.push_back((std::uint8_t) (value >> 24));
+	return;
+}
+
+static void put_u16(std::vector<std::uint8_t> &buf, std::uint16_t value)
+{
+	buf.push_back((std::uint8_t) value);
+	buf.push_back((std::uint8_t) (value >> 8));
+	return;
+}
+
+static void put_tag(std::vector<std::uint8_t> &buf, const char *tag)
+{
+	buf.insert(buf.end(), tag, tag + 4);
+	return;
+}
+
+//16bit stereo 44100Hz file of n_frames ramp frames. With smpl, a "smpl" chunk after the data loops from loop_begin to the last frame.
+//cut_frames > 0 truncates the file there, the header still claims n_frames.
+static std::vector<std::uint8_t> wave_build(std::uint32_t n_frames, bool smpl, std::uint32_t loop_begin, int loop_count, std::uint32_t cut_frames)
+{
+	std::vector<std::uint8_t> buf;
+	std::uint32_t data_size = n_frames*TEST_FRAME_SIZE;
+	std::uint32_t n_frame = 0u;
+	std::uint32_t n_field = 0u;
+
+	put_tag(buf, "RIFF");
+	put_u32(buf, data_size + (WAVE_HEADER_SIZE - 8u) + (smpl ? (8u + SMPL_CHUNK_SIZE) : 0u));
+	put_tag(buf, "WAVE");
+	put_tag(buf, "fmt ");
+	put_u32(buf, 16u);
+	put_u16(buf, 1u);
+	put_u16(buf, 2u);
+	put_u32(buf, 44100u);
+	put_u32(buf, 44100u*TEST_FRAME_SIZE);
+	put_u16(buf, TEST_FRAME_SIZE);
+	put_u16(buf, 16u);
+	put_tag(buf, "data");
+	put_u32(buf, data_size);
+
+	for(n_frame = 0u; n_frame < n_frames; n_frame++) put_u32(buf, test_frame(n_frame));
+
+	if(!smpl)
+	{
+		if(cut_frames > 0u) buf.resize(WAVE_HEADER_SIZE + cut_frames*TEST_FRAME_SIZE);
+		return buf;
+	}
+
+	//Header: 7 fields nobody here reads, one loop, no sampler data. Loop: id, type, dwStart, dwEnd (last frame), fraction, dwPlayCount.
+	put_tag(buf, "smpl");
+	put_u32(buf, SMPL_CHUNK_SIZE);
+	for(n_field = 0u; n_field < 7u; n_field++) put_u32(buf, 0u);
+	put_u32(buf, 1u);
+	put_u32(buf, 0u);
+	put_u32(buf, 0u);
+	put_u32(buf, 0u);
+	put_u32(buf, loop_begin);
+	put_u32(buf, n_frames - 1u);
+	put_u32(buf, 0u);
+	put_u32(buf, (loop_count < 0) ? 0u : ((std::uint32_t) loop_count + 1u));
+
+	if(cut_frames > 0u) buf.resize(WAVE_HEADER_SIZE + cut_frames*TEST_FRAME_SIZE);
+
+	return buf;
+}
+
+static bool file_write(const std::string &dir, const std::vector<std::uint8_t> &buf)
+{
+	int fd = open(dir.c_str(), (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+	bool ok = false;
+
+	if(fd < 0) return false;
+	ok = (write(fd, buf.data(), buf.size()) == (ssize_t) buf.size());
+	close(fd);
+	return ok;
+}
+
+//Renders filein_dir with its loop (params as given) and checks the output against the ramp
+static bool loop_render_check(const std::string &filein_dir, audio_playback_params_t *params, int format, std::uint32_t file_frames, std::uint32_t loop_begin, std::uint64_t render_frames, std::uint64_t expect_frames, std::string *error_msg)
+{
+	std::string fileout_dir = filein_dir + ".raw";
+	std::vector<std::uint8_t> out;
+	AudioPlayback *pb_obj = nullptr;
+	struct stat fileout_stat;
+	std::uint64_t n_frame = 0u;
+	std::uint32_t frame = 0u;
+	std::uint32_t expect = 0u;
+	int fileout = -1;
+	bool ok = false;
+
+	fileout = open(fileout_dir.c_str(), (O_RDWR | O_CREAT | O_TRUNC), 0644);
+	if(fileout < 0)
+	{
+		*error_msg = "could not open output file";
+		return false;
+	}
+
+	pb_obj = audio_playback_create(format, params);
+	if(pb_obj == nullptr)
+	{
+		*error_msg = "could not create playback object";
+		close(fileout);
+		unlink(fileout_dir.c_str());
+		return false;
+	}
+
+	pb_obj->setVerbose(false);
+	pb_obj->setRenderOutput(fileout, 0, render_frames, false);
+	ok = pb_obj->runPlayback();
+	if(!ok) *error_msg = pb_obj->getLastErrorMessage();
+	delete pb_obj;
+
+	if(ok && (fstat(fileout, &fileout_stat) < 0))
+	{
+		*error_msg = "could not stat output file";
+		ok = false;
+	}
+
+	//Periods are written whole, the last one padded with silence
+	if(ok && ((std::uint64_t) fileout_stat.st_size < expect_frames*TEST_FRAME_SIZE))
+	{
+		*error_msg = "playback stopped after " + std::to_string(fileout_stat.st_size/TEST_FRAME_SIZE) + " of " + std::to_string(expect_frames) + " frames";
+		ok = false;
+	}
+
+	if(ok && ((std::uint64_t) fileout_stat.st_size > ((expect_frames + RENDER_PERIOD_FRAMES - 1u)/RENDER_PERIOD_FRAMES)*RENDER_PERIOD_FRAMES*TEST_FRAME_SIZE))
+	{
+		*error_msg = "playback went on past " + std::to_string(expect_frames) + " frames";
+		ok = false;
+	}
+
+	if(ok)
+	{
+		out.resize((size_t) fileout_stat.st_size);
+		if(__PREAD(fileout, out.data(), out.size(), 0) != (ssize_t) out.size())
+		{
+			*error_msg = "could not read output file";
+			ok = false;
+		}
+	}
+
+	for(n_frame = 0u; ok && (n_frame < (std::uint64_t) (out.size()/TEST_FRAME_SIZE)); n_frame++)
+	{
+		memcpy(&frame, &out[n_frame*TEST_FRAME_SIZE], TEST_FRAME_SIZE);
+
+		//The file once through, then the loop region (which ends with the file) over and over. Past the end, silence.
+		if(n_frame >= expect_frames) expect = 0u;
+		else if(n_frame < file_frames) expect = test_frame((std::uint32_t) n_frame);
+		else expect = test_frame(loop_begin + (std::uint32_t) ((n_frame - file_frames)%(file_frames - loop_begin)));
+
+		if(frame == expect) continue;
+
+		*error_msg = "wrong sample at output frame " + std::to_string(n_frame);
+		ok = false;
+	}
+
+	close(fileout);
+	unlink(fileout_dir.c_str());
+	return ok;
+}
+
+static bool loop_test_run(const loop_test_t *test, const std::string &filein_dir, std::string *error_msg)
+{
+	audio_playback_params_t params;
+	int fd = -1;
+	int format = -1;
+
+	if(!file_write(filein_dir, wave_build(test->file_frames, test->smpl, test->loop_begin, test->loop_count, test->cut_frames)))
+	{
+		*error_msg = "could not write test file";
+		return false;
+	}
+
+	fd = file_open(filein_dir.c_str());
+	if(fd < 0)
+	{
+		*error_msg = "could not open test file";
+		return false;
+	}
+
+	params.audio_dev_desc = (char*) "render";
+	params.filein_dir = (char*) filein_dir.c_str();
+	format = file_get_params(fd, &params);
+	file_close(fd);
+
+	if(format != PB_16BIT2CH)
+	{
+		*error_msg = "test file not parsed as 16bit stereo";
+		return false;
+	}
+
+	if(test->smpl)
+	{
+		//dwEnd is the last frame, so the loop ends where the audio data does
+		if((params.loop_begin_frame != test->loop_begin) || (params.loop_end_frame != test->file_frames) || (params.loop_count != test->loop_count))
+		{
+			*error_msg = "smpl loop not read from the file";
+			return false;
+		}
+	}
+	else
+	{
+		params.loop_begin_frame = test->loop_begin;
+		params.loop_end_frame = test->file_frames;
+		params.loop_count = test->loop_count;
+	}
+
+	return loop_render_check(filein_dir, &params, format, test->file_frames, test->loop_begin, test->render_frames, test->expect_frames, error_msg);
+}
+
+int main(void)
+{
+	const loop_test_t tests[] = {
+		{"whole file, one period, endless", RENDER_PERIOD_FRAMES, 0u, -1, false, 5u*RENDER_PERIOD_FRAMES, 5u*RENDER_PERIOD_FRAMES, 0u},
+		{"whole file, two periods, endless", 2u*RENDER_PERIOD_FRAMES, 0u, -1, false, 6u*RENDER_PERIOD_FRAMES, 6u*RENDER_PERIOD_FRAMES, 0u},
+		{"whole file, one period, 2 repeats", RENDER_PERIOD_FRAMES, 0u, 2, false, 10u*RENDER_PERIOD_FRAMES, 3u*RENDER_PERIOD_FRAMES, 0u},
+		{"whole file, 16000 frames, endless", 16000u, 0u, -1, false, 130u*RENDER_PERIOD_FRAMES, 130u*RENDER_PERIOD_FRAMES, 0u},
+		{"smpl loop to the last frame, endless", RENDER_PERIOD_FRAMES, 4096u, -1, true, 8u*RENDER_PERIOD_FRAMES, 8u*RENDER_PERIOD_FRAMES, 0u},
+		{"smpl loop to the last frame, played 5 times", 2u*RENDER_PERIOD_FRAMES, RENDER_PERIOD_FRAMES, 4, true, 20u*RENDER_PERIOD_FRAMES, 6u*RENDER_PERIOD_FRAMES, 0u},
+		{"smpl whole file loop, played 4 times", 3000u, 0u, 3, true, 10u*RENDER_PERIOD_FRAMES, 12000u, 0u},
+		{"smpl whole file loop, played once", 3000u, 0u, 0, true, 10u*RENDER_PERIOD_FRAMES, 3000u, 0u},
+		{"endless loop in a file cut short", 2u*RENDER_PERIOD_FRAMES, 0u, -1, false, 10u*RENDER_PERIOD_FRAMES, RENDER_PERIOD_FRAMES + 1000u, RENDER_PERIOD_FRAMES + 1000u}
+	};
+	char filein_template[] = "/tmp/test_loop_XXXXXX";
+	std::string filein_dir = "";
+	std::string error_msg = "";
+	size_t n_test = 0u;
+	int fd = -1;
+	int n_failed = 0;
+
+	fd = mkstemp(filein_template);
+	if(fd < 0)
+	{
+		std::cout << "Error: could not create test file\n";
+		return 1;
+	}
+
+	close(fd);
+	filein_dir = filein_template;
+
+	for(n_test = 0u; n_test < (sizeof(tests)/sizeof(loop_test_t)); n_test++)
+	{
+		error_msg = "";
+
+		if(loop_test_run(&tests[n_test], filein_dir, &error_msg)) std::cout << "PASS " << tests[n_test].name << "\n";
+		else
+		{
+			std::cout << "FAIL " << tests[n_test].name << ": " << error_msg << "\n";
+			n_failed++;
+		}
+	}
+
+	unlink(filein_dir.c_str());
+
+	if(n_failed > 0) return 1;
+	return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * WAVE audio file playback app v2.0.1 for GNU-Linux
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Channel matrix test.
+ * Runs channel_matrix_apply for matrices of every kind (identity, duplicate, downmix, mix) over frame counts that
+ * hit the SIMD loops and their scalar tails, with noise and full scale inputs that saturate, and compares every output
+ * sample with the formula of ChannelMatrix.hpp computed one sample at a time. Inputs are sized to the frame exactly,
+ * and the output is followed by guard samples that must be left alone. Also checks channel_matrix_parse rejections.
+ *
+ * Usage: test_matrix.elf
+ */
+
+#include "globaldef.h"
+#include "ChannelMatrix.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define GUARD_SAMPLES 16u
+#define GUARD_VALUE 0x5a5a
+
+struct matrix_test {
+	const char *name;
+	unsigned int in_channels;
+	unsigned int out_channels;
+	const char *gains; //Parsed with channel_matrix_parse, or nullptr for channel_matrix_default
+	int kind;
+};
+
+typedef struct matrix_test matrix_test_t;
+
+static const matrix_test_t MATRIX_TESTS[] = {
+	{"identity 2ch", 2u, 2u, nullptr, CHANNEL_MATRIX_IDENTITY},
+	{"identity 6ch", 6u, 6u, nullptr, CHANNEL_MATRIX_IDENTITY},
+	{"duplicate 1ch -> 2ch", 1u, 2u, nullptr, CHANNEL_MATRIX_DUPLICATE},
+	{"duplicate 1ch -> 4ch", 1u, 4u, nullptr, CHANNEL_MATRIX_DUPLICATE},
+	{"duplicate 2ch -> 4ch", 2u, 4u, nullptr, CHANNEL_MATRIX_DUPLICATE},
+	{"duplicate 2ch -> 3ch", 2u, 3u, "0,1;1,0;1,0", CHANNEL_MATRIX_DUPLICATE},
+	{"downmix 6ch -> 2ch", 6u, 2u, nullptr, CHANNEL_MATRIX_DOWNMIX},
+	{"downmix 8ch -> 2ch", 8u, 2u, nullptr, CHANNEL_MATRIX_DOWNMIX},
+	{"downmix 3ch -> 2ch, saturating", 3u, 2u, "2,1.5,0.25;-2,-1.5,0.25", CHANNEL_MATRIX_DOWNMIX},
+	{"downmix 1ch -> 2ch, gain 2", 1u, 2u, "2;-2", CHANNEL_MATRIX_DOWNMIX},
+	{"mix 6ch -> 4ch", 6u, 4u, nullptr, CHANNEL_MATRIX_MIX},
+	{"mix 8ch -> 3ch", 8u, 3u, nullptr, CHANNEL_MATRIX_MIX},
+	{"mix 2ch -> 6ch, saturating", 2u, 6u, "2,1;1,2;-2,-1;0.5,0.5;1.25,-1.75;0,-2", CHANNEL_MATRIX_MIX},
+	{"mix 4ch -> 8ch", 4u, 8u, "1,0,0,0;0,1,0,0;0,0,1,0;0,0,0,1;0.5,0.5,0,0;0,0,0.5,0.5;1,1,1,0.9;-1,-1,-1,-0.9", CHANNEL_MATRIX_MIX}
+};
+
+static const size_t FRAME_COUNTS[] = {0u, 1u, 7u, 9u, 17u, 1001u};
+
+//saturate((sum of in[c]*gain[c] + 0x2000) >> 14)
+static std::int16_t reference_sample(const std::int16_t *frame, const std::int16_t *gain, unsigned int in_channels)
+{
+	std::int64_t sum = 0;
+	unsigned int n_in = 0u;
+
+	for(n_in = 0u; n_in < in_channels; n_in++) sum += ((std::int64_t) frame[n_in])*((std::int64_t) gain[n_in]);
+
+	sum = (sum + 0x2000) >> 14;
+	if(sum > 32767) return 32767;
+	if(sum < -32768) return -32768;
+	return (std::int16_t) sum;
+}
+
+//Noise for the first half of the frames, full scale (both signs, every channel alike) for the rest
+static void input_fill(std::vector<std::int16_t> &in, unsigned int in_channels)
+{
+	size_t n_sample = 0u;
+
+	for(n_sample = 0u; n_sample < in.size(); n_sample++)
+	{
+		if(n_sample < (in.size()/2u)) in[n_sample] = (std::int16_t) (rand() & 0xffff);
+		else in[n_sample] = (((n_sample/in_channels) & 1u) ? -32768 : 32767);
+	}
+
+	return;
+}
+
+static bool matrix_test_run(const matrix_test_t *test, std::string *error_msg)
+{
+	channel_matrix_t matrix;
+	std::vector<std::int16_t> in;
+	std::vector<std::int16_t> out;
+	size_t n_count = 0u;
+	size_t n_frames = 0u;
+	size_t n_frame = 0u;
+	size_t n_sample = 0u;
+	unsigned int n_out = 0u;
+	std::int16_t expect = 0;
+
+	if(test->gains != nullptr)
+	{
+		if(!channel_matrix_parse(&matrix, test->gains))
+		{
+			*error_msg = "matrix not parsed";
+			return false;
+		}
+	}
+	else if(!channel_matrix_default(&matrix, test->in_channels, test->out_channels))
+	{
+		*error_msg = "no default matrix";
+		return false;
+	}
+
+	if((matrix.in_channels != test->in_channels) || (matrix.out_channels != test->out_channels) || (matrix.kind != test->kind))
+	{
+		*error_msg = "matrix is not of the kind tested";
+		return false;
+	}
+
+	for(n_count = 0u; n_count < (sizeof(FRAME_COUNTS)/sizeof(size_t)); n_count++)
+	{
+		n_frames = FRAME_COUNTS[n_count];
+
+		//0 frames still passes real (empty) buffers, as playback does
+		in.reserve(1u);
+		in.assign(n_frames*test->in_channels, 0);
+		out.assign(n_frames*test->out_channels + GUARD_SAMPLES, GUARD_VALUE);
+		input_fill(in, test->in_channels);
+
+		channel_matrix_apply(out.data(), in.data(), n_frames, &matrix);
+
+		for(n_frame = 0u; n_frame < n_frames; n_frame++)
+		{
+			for(n_out = 0u; n_out < test->out_channels; n_out++)
+			{
+				expect = reference_sample(&in[n_frame*test->in_channels], matrix.gain[n_out], test->in_channels);
+				if(out[n_frame*test->out_channels + n_out] == expect) continue;
+
+				*error_msg = std::to_string(n_frames) + " frames: wrong sample at frame " + std::to_string(n_frame) + ", output " + std::to_string(n_out);
+				return false;
+			}
+		}
+
+		for(n_sample = n_frames*test->out_channels; n_sample < out.size(); n_sample++)
+		{
+			if(out[n_sample] == GUARD_VALUE) continue;
+
+			*error_msg = std::to_string(n_frames) + " frames: written past the last frame";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(void)
+{
+	//Malformed, or gains the header says are rejected
+	const char *rejected[] = {"", "1,", "1;1,1", "nan,0", "inf", "-inf,0", "2.5", "2,2", "1,1,1,1", "-2,-2"};
+	channel_matrix_t matrix;
+	std::string error_msg = "";
+	size_t n_test = 0u;
+	int n_failed = 0;
+
+	srand(1);
+
+	for(n_test = 0u; n_test < (sizeof(MATRIX_TESTS)/sizeof(matrix_test_t)); n_test++)
+	{
+		error_msg = "";
+
+		if(matrix_test_run(&MATRIX_TESTS[n_test], &error_msg)) std::cout << "PASS " << MATRIX_TESTS[n_test].name << "\n";
+		else
+		{
+			std::cout << "FAIL " << MATRIX_TESTS[n_test].name << ": " << error_msg << "\n";
+			n_failed++;
+		}
+	}
+
+	for(n_test = 0u; n_test < (sizeof(rejected)/sizeof(const char*)); n_test++)
+	{
+		if(!channel_matrix_parse(&matrix, rejected[n_test])) continue;
+
+		std::cout << "FAIL parse accepts \"" << rejected[n_test] << "\"\n";
+		n_failed++;
+	}
+
+	if(n_failed == 0) std::cout << "PASS parse rejections\n";
+
+	if(n_failed > 0) return 1;
+	return 0;
+}